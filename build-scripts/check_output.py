@@ -8,7 +8,10 @@ import glob
 import subprocess
 import multiprocessing
 import os
+import queue
+import shutil
 import tempfile
+import threading
 
 parser = argparse.ArgumentParser()
 parser.add_argument('--binary', type=str)
@@ -69,6 +72,55 @@ def check_with_input(out_path):
     output, expected_output = sanitize(output), sanitize(expected_output)
     assert(output == expected_output)
 
+PROMPT_TIMEOUT = 10
+
+def check_with_prompt(out_path):
+    global out_extension, out_extension_len
+    program_path = out_path[:-out_extension_len] + '.au'
+    input_path = out_path[:-out_extension_len] + '.in'
+    print(f"Checking {program_path}")
+    with open(out_path, "rb") as fout:
+        expected_output = fout.read()
+    with open(input_path, "rb") as finp:
+        input_lines = finp.read().splitlines(keepends=True)
+    proc = subprocess.Popen([
+        args.binary,
+        'run',
+        program_path
+    ], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    chunks = queue.Queue()
+    def read_stdout():
+        while True:
+            chunk = proc.stdout.read1(4096)
+            chunks.put(chunk)
+            if not chunk:
+                break
+    reader = threading.Thread(target=read_stdout, daemon=True)
+    reader.start()
+    output = b''
+    try:
+        # Each line of input is only written once the program has printed
+        # its prompt, which fails if the prompt is left in the buffer
+        for line in input_lines:
+            try:
+                output += chunks.get(timeout=PROMPT_TIMEOUT)
+            except queue.Empty:
+                print(f"No prompt in {program_path} before reading input")
+                assert(False)
+            proc.stdin.write(line)
+            proc.stdin.flush()
+        proc.stdin.close()
+        while True:
+            chunk = chunks.get(timeout=PROMPT_TIMEOUT)
+            if not chunk:
+                break
+            output += chunk
+    finally:
+        proc.kill()
+        proc.wait()
+    output, expected_output = sanitize(output), sanitize(expected_output)
+    assert(output == expected_output)
+
 def check_comp(out_path):
     global out_extension, out_extension_len
     program_path = out_path[:-out_extension_len] + '.au'
@@ -126,11 +178,150 @@ def check_errors(out_path):
         output, expected_output = sanitize(e.output), sanitize(expected_output)
         assert(output == expected_output)
 
+def check_comp_errors(out_path):
+    global out_extension, out_extension_len
+    program_path = out_path[:-out_extension_len] + '.au'
+    print(f"Checking {program_path}")
+    with open(out_path, "rb") as fout:
+        expected_output = fout.read()
+    exe_out = tempfile.NamedTemporaryFile(mode='r', delete=False)
+    exe_name = exe_out.name
+    exe_out.close()
+    subprocess.check_output([
+        args.binary,
+        'build',
+        program_path,
+        exe_name,
+    ])
+    try:
+        subprocess.check_output([ exe_name ], stderr=subprocess.STDOUT)
+        print(f"File {program_path} succeeded")
+        exit(1)
+    except subprocess.CalledProcessError as e:
+        output, expected_output = sanitize(e.output), sanitize(expected_output)
+        assert(output == expected_output)
+    finally:
+        try:
+            os.remove(exe_name)
+        except:
+            pass
+
+def check_snapshot(out_path):
+    global out_extension, out_extension_len
+    program_path = out_path[:-out_extension_len] + '.au'
+    print(f"Checking {program_path} (image)")
+    with open(out_path, "rb") as fout:
+        expected_output = fout.read()
+    # Images are run without their sources, so the sources are copied
+    # and removed once the image is made
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        program_dir = os.path.dirname(os.path.abspath(program_path))
+        src_dir = os.path.join(tmp_dir, os.path.basename(program_dir))
+        shutil.copytree(program_dir, src_dir)
+        image_path = os.path.join(tmp_dir, 'program.img')
+        subprocess.check_output([
+            args.binary,
+            'snapshot',
+            os.path.join(src_dir, os.path.basename(program_path)),
+            image_path,
+        ])
+        shutil.rmtree(src_dir)
+        output = subprocess.check_output([
+            args.binary,
+            'run',
+            image_path,
+        ], cwd=tmp_dir)
+    output, expected_output = sanitize(output), sanitize(expected_output)
+    assert(output == expected_output)
+
+def check_snapshot_corrupt(out_path):
+    global out_extension, out_extension_len, args
+    program_path = out_path[:-out_extension_len] + '.au'
+    print(f"Checking {program_path} (image, {args.param})")
+    with open(out_path, "rb") as fout:
+        expected_output = fout.read()
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        image_path = os.path.join(tmp_dir, 'program.img')
+        subprocess.check_output([
+            args.binary,
+            'snapshot',
+            program_path,
+            image_path,
+        ])
+        with open(image_path, "rb") as f:
+            image = bytearray(f.read())
+        if args.param == 'flip':
+            image[len(image) // 2] ^= 0x10
+        elif args.param == 'truncate':
+            image = image[:len(image) // 2]
+        else:
+            raise ValueError(args.param)
+        with open(image_path, "wb") as f:
+            f.write(image)
+        try:
+            subprocess.check_output([
+                args.binary,
+                'run',
+                image_path
+            ], stderr=subprocess.STDOUT)
+            print(f"Image of {program_path} succeeded")
+            exit(1)
+        except subprocess.CalledProcessError as e:
+            output = e.output.replace(image_path.encode('utf-8'), b'-')
+            output, expected_output = sanitize(output), sanitize(expected_output)
+            assert(output == expected_output)
+
+def check_cache(out_path):
+    global out_extension, out_extension_len, args
+    program_path = out_path[:-out_extension_len] + '.au'
+    print(f"Checking {program_path} (object cache)")
+    with open(out_path, "rb") as fout:
+        expected_output = fout.read()
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        program_dir = os.path.dirname(os.path.abspath(program_path))
+        src_dir = os.path.join(tmp_dir, 'src')
+        shutil.copytree(program_dir, src_dir)
+        cache_dir = os.path.join(tmp_dir, 'cache')
+        env = dict(os.environ, AU_CACHE_DIR=cache_dir)
+        exe_name = os.path.join(tmp_dir, 'program')
+        # Builds the program and returns the object files in the cache
+        def build(flags=[]):
+            subprocess.check_output([
+                args.binary,
+                'build',
+                *flags,
+                os.path.join(src_dir, os.path.basename(program_path)),
+                exe_name,
+            ], env=env)
+            output = subprocess.check_output([ exe_name ])
+            assert(sanitize(output) == sanitize(expected_output))
+            return set(os.listdir(cache_dir))
+
+        objects = build()
+        num_units = len(objects)
+        assert(num_units > 1)
+        # Nothing is compiled again if nothing changed
+        assert(build() == objects)
+        # Editing a module (args.param) only compiles its own unit again
+        with open(os.path.join(src_dir, args.param), "a") as f:
+            f.write("\nfunc unused() {\n    return 1;\n}\n")
+        edited_objects = build()
+        assert(len(edited_objects - objects) == 1)
+        assert(objects <= edited_objects)
+        # Every unit is compiled again if the compiler flags change
+        no_opt_objects = build(['--no-opt'])
+        assert(len(no_opt_objects - edited_objects) == num_units)
+
 check_fn = {
     "output": check_output,
     "with_input": check_with_input,
+    "with_prompt": check_with_prompt,
     "comp": check_comp,
     "errors": check_errors,
+    "comp_errors": check_comp_errors,
+    "snapshot": check_snapshot,
+    "snapshot_corrupt": check_snapshot_corrupt,
+    "cache": check_cache,
     "comp_to_path": check_comp_to_path,
     "output_stderr": check_output_stderr,
 }[args.check]
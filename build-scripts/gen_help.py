@@ -30,6 +30,13 @@ Passing `-b` will make aument output bytecode before it is compiled to C.
 Passing `-c` will make aument write C code into *output-file* instead
 of outputting a compiled binary.
 
+Every module is compiled into its own object file. Up to *N* C compilers
+are run in parallel if `-jN` is passed, defaulting to the number of
+processors. Object files are cached in the directory named by the
+`AU_CACHE_DIR` environment variable, or in `aument` inside the user's
+cache directory, and are reused by later builds of the same module
+with the same compiler flags. Passing `--no-cache` disables the cache.
+
 Passing `-g` will add the `-g` flag to the C compiler call.\
 """,
     ),
@@ -41,6 +48,31 @@ Passing `-g` will add the `-g` flag to the C compiler call.\
 Runs *input-file* through an interpreter.
 
 Passing `-b` will make aument output bytecode before it is interpreted.\
+""",
+    ),
+    (
+        "snapshot",
+        "stores a parsed program into an image",
+        "input-file output-file",
+        """\
+Parses *input-file* and every source module it imports, and stores the
+parsed programs into an image file named *output-file*.
+
+Running the image with `aument run output-file` skips parsing, and runs
+the program as if *input-file* was run. The image holds the parsed
+source modules, so it runs without their source files, and changes to
+the source files only take effect once a new image is made. Modules
+that weren't parsed when the image was made, such as native libraries,
+are loaded when they are imported. Images can only be run by the
+version of aument that made them.
+
+Images hold parsed modules only, not initialized globals or the
+heap. The top-level code of the program and of its modules runs each
+time the image is run. Images that are corrupted or truncated are
+rejected.
+
+If *input-file* or a source module it imports can't be parsed, no
+image is written.\
 """,
     ),
     (
@@ -12,6 +12,7 @@ parser = argparse.ArgumentParser()
 parser.add_argument('--global-file', type=str)
 parser.add_argument('--output', type=str)
 parser.add_argument('--ident', type=str)
+parser.add_argument('--decl-ident', type=str)
 parser.add_argument('--files', type=str, nargs='*')
 parser.add_argument('--cpp', type=str, nargs='*')
 args = parser.parse_args()
@@ -20,12 +21,6 @@ global_file = args.global_file
 output = args.output
 ident = args.ident
 files = args.files
-total = ""
-for fn in files:
-    with open(fn, "r") as f:
-        total += f.read()
-        total += '\n'
-
 cpp_args = [
     'cpp',
     '-P'
@@ -34,17 +29,32 @@ if args.cpp:
     for i in args.cpp:
         cpp_args.append('-' + i)
 
-cpp_output = subprocess.check_output(cpp_args, input=total.encode('utf-8'))
-total = cpp_output.decode('utf-8')
-total = re.sub(r'^\s+', '', total)
-total = re.sub(r'\s+', ' ', total)
-if global_file:
-    with open(global_file, "r") as f:
-        total = f.read() + '\n' + total
+def gen_source(files):
+    total = ""
+    for fn in files:
+        with open(fn, "r") as f:
+            total += f.read()
+            total += '\n'
 
-total_bytes = total.encode('ascii')
-values = ','.join(map(str, total_bytes))
-with open(output, "w") as f:
-    f.write("#include <stdlib.h>\n")
+    cpp_output = subprocess.check_output(cpp_args, input=total.encode('utf-8'))
+    total = cpp_output.decode('utf-8')
+    total = re.sub(r'^\s+', '', total)
+    total = re.sub(r'\s+', ' ', total)
+    if global_file:
+        with open(global_file, "r") as f:
+            total = f.read() + '\n' + total
+    return total.encode('ascii')
+
+def write_source(f, ident, total_bytes):
+    values = ','.join(map(str, total_bytes))
     f.write("const char %s[] = {%s};\n" % (ident, values))
     f.write("const size_t %s_LEN = %d;\n" % (ident, len(total_bytes)))
+
+with open(output, "w") as f:
+    f.write("#include <stdlib.h>\n")
+    write_source(f, ident, gen_source(files))
+    if args.decl_ident:
+        # Declarations only, for translation units that are linked
+        # together with the one containing the runtime's definitions
+        decl_files = [fn for fn in files if not fn.endswith('.c')]
+        write_source(f, args.decl_ident, gen_source(decl_files))
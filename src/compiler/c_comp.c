@@ -5,8 +5,10 @@
 // See LICENSE.txt for license information
 #include <assert.h>
 #include <libgen.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "os/mmap.h"
 #include "os/path.h"
@@ -20,9 +22,11 @@
 #include "core/rt/exception.h"
 #include "core/rt/malloc.h"
 #include "core/vm/module.h"
+#include "platform/fmt.h"
 #include "stdlib/au_stdlib.h"
 
 #include "c_comp.h"
+#include "c_types.h"
 
 #define INDENT "    "
 
@@ -38,20 +42,35 @@ AU_ARRAY_STRUCT(struct line_info, line_info_array, 1)
 static void create_line_info_array(struct line_info_array *array,
                                    const char *source, size_t source_len) {
     int line = 1;
-    size_t line_start = 0;
+    line_info_array_add(array, (struct line_info){
+                                   .line = line,
+                                   .source_start = 0,
+                               });
     for (size_t source_idx = 0; source_idx < source_len; source_idx++) {
         if (source[source_idx] == '\n') {
-            // printf("line %d, from %d\n", line, line_start);
+            line++;
             line_info_array_add(array, (struct line_info){
                                            .line = line,
-                                           .source_start = line_start,
+                                           .source_start = source_idx + 1,
                                        });
-            line++;
-            line_start = source_idx;
         }
     }
 }
 
+static int find_line(const struct line_info_array *array,
+                     size_t source_start) {
+    // Find the last line that starts at or before source_start
+    size_t lo = 0, hi = array->len;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (array->data[mid].source_start <= source_start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo == 0 ? 1 : array->data[lo - 1].line;
+}
+
 struct au_c_comp_module {
     struct au_hm_vars fn_map;
     struct au_fn_array fns;
@@ -71,7 +90,11 @@ struct au_c_comp_global_state {
     struct au_c_comp_module_array modules;
     struct line_info_array main_line_info;
     struct au_c_comp_options options;
+    /// Declarations shared by every translation unit
     struct au_c_comp_state header_file;
+    /// Definitions private to the module being compiled, which are
+    ///     written in front of its code
+    struct au_c_comp_state *module_header;
     struct au_hm_vars declared_externs;
     struct au_program_data_array stdlib_modules;
     const char *error_file;
@@ -85,6 +108,9 @@ au_c_comp_module(struct au_c_comp_state *state,
 
 void au_c_comp_state_del(struct au_c_comp_state *state) {
     au_data_free(state->str.data);
+    for (size_t i = 0; i < state->units.len; i++)
+        au_data_free(state->units.data[i].data);
+    au_data_free(state->units.data);
 }
 
 // ** Compiler output functions **
@@ -103,7 +129,7 @@ static void comp_putc(struct au_c_comp_state *state, int byte) {
 __attribute__((format(printf, 2, 3)))
 #endif
 static void
-comp_printf(struct au_c_comp_state *state, char *fmt, ...) {
+comp_printf(struct au_c_comp_state *state, const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
     int dot_star_flag = 0;
@@ -150,18 +176,44 @@ try_continue:;
             continue;
         }
         case 'd': {
-            char buf[32];
-            int len = snprintf(buf, sizeof(buf), "%d", va_arg(args, int));
+            char buf[AU_FMT_INT_MAX_LEN];
+            const size_t len = au_fmt_int(va_arg(args, int), buf);
             comp_write(state, buf, len);
             continue;
         }
-        case 'f': {
-            char buf[32];
-            int len =
-                snprintf(buf, sizeof(buf), "%f", va_arg(args, double));
+        case 'l': {
+            if (*(fmt + 1) != 'l' || *(fmt + 2) != 'd')
+                au_fatal("comp_printf doesn't support this flag: %%l%c",
+                         *(fmt + 1));
+            fmt += 2;
+            char buf[AU_FMT_INT_MAX_LEN];
+            const size_t len = au_fmt_int(va_arg(args, long long), buf);
             comp_write(state, buf, len);
             continue;
         }
+        case 'f': {
+            // Doubles are written with enough digits to be parsed back
+            // into the same value
+            const double num = va_arg(args, double);
+            if (isnan(num)) {
+                comp_write(state, "(0.0/0.0)", 9);
+            } else if (isinf(num)) {
+                if (num < 0)
+                    comp_write(state, "(-1.0/0.0)", 10);
+                else
+                    comp_write(state, "(1.0/0.0)", 9);
+            } else {
+                char buf[AU_FMT_DOUBLE_MAX_LEN];
+                const size_t len = au_fmt_double(num, buf);
+                comp_write(state, buf, len);
+                // Integral values are written without a fractional part,
+                // which C would parse as an integer literal
+                if (memchr(buf, '.', len) == 0 &&
+                    memchr(buf, 'e', len) == 0)
+                    comp_write(state, ".0", 2);
+            }
+            continue;
+        }
         default: {
             au_fatal("unknown format character %c\n", ch);
         }
@@ -186,6 +238,357 @@ static void comp_cleanup(struct au_c_comp_state *state,
     }
 }
 
+/// Compiles a call to the current function in tail position. The
+/// arguments are moved into the function's locals, and execution jumps
+/// back to the start of the function.
+/// @param pos offset of the first AU_OP_PUSH_ARG instruction
+/// @return offset of the instruction after the call
+static size_t comp_self_tail_call(struct au_c_comp_state *state,
+                                  const struct au_bc_storage *bcs,
+                                  size_t pos) {
+    const int num_args = bcs->num_args;
+    comp_printf(state, "{");
+    if (num_args > 0) {
+        comp_printf(state, "au_value_t _args[]={");
+        for (int i = 0; i < num_args; i++) {
+            const uint8_t reg =
+                au_bc_buf_at(&bcs->bc, pos + (i / 3) * 4 + 1 + i % 3);
+            comp_printf(state, "r%d,", reg);
+        }
+        comp_printf(state, "};");
+        for (int i = 0; i < num_args; i++)
+            comp_printf(state, "au_value_ref(_args[%d]);", i);
+    }
+    comp_cleanup(state, bcs, -1, -1, 0);
+    for (int i = 0; i < bcs->num_registers; i++)
+        comp_printf(state, "r%d=au_value_none();", i);
+    for (int i = 0; i < bcs->num_locals; i++) {
+        if (i < num_args)
+            comp_printf(state, "l%d=_args[%d];", i, i);
+        else
+            comp_printf(state, "l%d=au_value_none();", i);
+    }
+    comp_printf(state, "goto tail_call;}\n");
+    return pos + ((num_args + 2) / 3) * 4;
+}
+
+// ** Unboxed values **
+
+/// Writes the C variable name of a value into buf. Unboxed values are
+/// prefixed with their type.
+static void value_name(char *buf, size_t len,
+                       const struct au_bc_storage *bcs, int value,
+                       uint8_t type) {
+    const char *prefix = "";
+    switch (type) {
+    case AU_C_TYPE_INT:
+        prefix = "i";
+        break;
+    case AU_C_TYPE_DOUBLE:
+        prefix = "d";
+        break;
+    case AU_C_TYPE_BOOL:
+        prefix = "b";
+        break;
+    default:
+        break;
+    }
+    if (value < bcs->num_registers)
+        snprintf(buf, len, "%sr%d", prefix, value);
+    else
+        snprintf(buf, len, "%sl%d", prefix,
+                 value - bcs->num_registers);
+}
+
+/// Updates the au_value_t of an unboxed value
+/// @return 1 if the value needed to be boxed
+static int comp_box(struct au_c_comp_state *state,
+                    const struct au_bc_storage *bcs,
+                    struct au_c_value_state *vals, int value) {
+    if (!au_c_type_is_native(vals[value].type) || vals[value].boxed)
+        return 0;
+    char boxed[16], unboxed[16];
+    value_name(boxed, sizeof(boxed), bcs, value, AU_C_TYPE_ANY);
+    value_name(unboxed, sizeof(unboxed), bcs, value, vals[value].type);
+    const char *box_fn = "au_value_int";
+    if (vals[value].type == AU_C_TYPE_DOUBLE)
+        box_fn = "au_value_double";
+    else if (vals[value].type == AU_C_TYPE_BOOL)
+        box_fn = "au_value_bool";
+    comp_printf(state, "MOVE_VALUE(%s,%s(%s));", boxed, box_fn, unboxed);
+    vals[value].boxed = 1;
+    return 1;
+}
+
+/// Boxes the unboxed values that the basic block starting at target
+/// expects to be boxed
+/// @param own_line if set, the code is written on its own line
+static void comp_edge(struct au_c_comp_state *state,
+                      const struct au_c_types *types,
+                      struct au_c_value_state *vals, size_t target,
+                      int own_line) {
+    const struct au_c_value_state *target_vals =
+        au_c_types_block_state(types, target);
+    if (target_vals == 0)
+        return;
+    int has_boxed = 0;
+    for (int i = 0; i < types->num_values; i++) {
+        if (target_vals[i].type != AU_C_TYPE_ANY ||
+            !au_c_type_is_native(vals[i].type) || vals[i].boxed)
+            continue;
+        if (own_line && !has_boxed)
+            comp_printf(state, INDENT);
+        has_boxed |= comp_box(state, types->bcs, vals, i);
+    }
+    if (own_line && has_boxed)
+        comp_printf(state, "\n");
+}
+
+/// Declares the typed fast path of a native function
+static void comp_fast_fn_decl(struct au_c_comp_global_state *g_state,
+                              const struct au_lib_func *lib_func) {
+    if (lib_func->fast_symbol == 0)
+        return;
+    const au_hm_var_value_t *old = au_hm_vars_add(
+        &g_state->declared_externs, lib_func->fast_symbol,
+        strlen(lib_func->fast_symbol), 0);
+    if (old != 0)
+        return;
+    const char *decl = 0;
+    switch (lib_func->fast_sig) {
+    case AU_LIB_FUNC_SIG_D_D:
+        decl = "extern double %s(double);\n";
+        break;
+    case AU_LIB_FUNC_SIG_D_DD:
+        decl = "extern double %s(double,double);\n";
+        break;
+    case AU_LIB_FUNC_SIG_I_I:
+        decl = "extern int64_t %s(int64_t);\n";
+        break;
+    case AU_LIB_FUNC_SIG_I_II:
+        decl = "extern int64_t %s(int64_t,int64_t);\n";
+        break;
+    default:
+        return;
+    }
+    comp_printf(&g_state->header_file, decl, lib_func->fast_symbol);
+}
+
+/// Compiles an instruction operating on unboxed values
+static void comp_native_insn(struct au_c_comp_state *state,
+                             const struct au_c_types *types,
+                             const struct au_c_value_state *vals,
+                             const struct au_c_insn *insn,
+                             enum au_c_type native, size_t module_idx) {
+    const struct au_bc_storage *bcs = types->bcs;
+    char dest[16] = {0}, lhs[16] = {0}, rhs[16] = {0};
+    uint8_t lhs_type = AU_C_TYPE_UNDEF;
+    if (insn->dest >= 0)
+        value_name(dest, sizeof(dest), bcs, insn->dest, native);
+    if (insn->reads.len > 0) {
+        lhs_type = vals[insn->reads.data[0]].type;
+        value_name(lhs, sizeof(lhs), bcs, insn->reads.data[0], lhs_type);
+    }
+    if (insn->reads.len > 1)
+        value_name(rhs, sizeof(rhs), bcs, insn->reads.data[1],
+                   vals[insn->reads.data[1]].type);
+    const uint8_t *bc = &bcs->bc.data[insn->pos];
+    const uint16_t u16 = *((uint16_t *)(&bc[2]));
+
+#define BIN_OP(OP)                                                        \
+    comp_printf(state, "%s=%s" OP "%s;\n", dest, lhs, rhs);               \
+    break;
+#define ARITH_OP(OP, INT_FN)                                              \
+    if (native == AU_C_TYPE_INT)                                          \
+        comp_printf(state,                                                \
+                    "if(" INT_FN "(%s,%s,&%s))"                           \
+                    "au_fatal(\"integer overflow\\n\");\n",              \
+                    lhs, rhs, dest);                                      \
+    else                                                                  \
+        comp_printf(state, "%s=(double)%s" OP "(double)%s;\n", dest, lhs, \
+                    rhs);                                                 \
+    break;
+    switch (insn->op) {
+    case AU_OP_MOV_U16: {
+        comp_printf(state, "%s=%d;\n", dest, u16);
+        break;
+    }
+    case AU_OP_MOV_BOOL: {
+        comp_printf(state, "%s=%d;\n", dest, bc[1]);
+        break;
+    }
+    case AU_OP_LOAD_CONST: {
+        comp_printf(state, "%s=au_value_get_%s(_M%d_c%d());\n", dest,
+                    native == AU_C_TYPE_INT ? "int" : "double",
+                    (int)module_idx, u16);
+        break;
+    }
+    case AU_OP_MOV_REG_LOCAL:
+    case AU_OP_MOV_LOCAL_REG: {
+        comp_printf(state, "%s=%s;\n", dest, lhs);
+        break;
+    }
+    case AU_OP_ADD:
+    case AU_OP_ADD_INT:
+        ARITH_OP("+", "au_platform_iadd_overflow")
+    case AU_OP_SUB:
+    case AU_OP_SUB_INT:
+        ARITH_OP("-", "au_platform_isub_overflow")
+    case AU_OP_MUL:
+    case AU_OP_MUL_INT:
+        ARITH_OP("*", "au_platform_imul_overflow")
+    case AU_OP_DIV: {
+        comp_printf(state, "%s=(double)%s/(double)%s;\n", dest, lhs, rhs);
+        break;
+    }
+    case AU_OP_MOD:
+        BIN_OP("%%")
+    case AU_OP_BAND:
+        BIN_OP("&")
+    case AU_OP_BOR:
+        BIN_OP("|")
+    case AU_OP_BXOR:
+        BIN_OP("^")
+    case AU_OP_BSHL: {
+        comp_printf(state,
+                    "if(au_platform_ishl_overflow(%s,%s,&%s))"
+                    "au_fatal(\"integer overflow\\n\");\n",
+                    lhs, rhs, dest);
+        break;
+    }
+    case AU_OP_BSHR:
+        BIN_OP(">>")
+    case AU_OP_EQ:
+    case AU_OP_EQ_INT:
+        BIN_OP("==")
+    case AU_OP_NEQ:
+    case AU_OP_NEQ_INT:
+        BIN_OP("!=")
+    case AU_OP_LT:
+    case AU_OP_LT_INT:
+        BIN_OP("<")
+    case AU_OP_GT:
+    case AU_OP_GT_INT:
+        BIN_OP(">")
+    case AU_OP_LEQ:
+    case AU_OP_LEQ_INT:
+        BIN_OP("<=")
+    case AU_OP_GEQ:
+    case AU_OP_GEQ_INT:
+        BIN_OP(">=")
+    case AU_OP_NOT: {
+        if (lhs_type == AU_C_TYPE_BOOL)
+            comp_printf(state, "%s=!%s;\n", dest, lhs);
+        else
+            comp_printf(state, "%s=!(%s>0);\n", dest, lhs);
+        break;
+    }
+    case AU_OP_NEG: {
+        if (native == AU_C_TYPE_INT)
+            comp_printf(state,
+                        "if(au_platform_isub_overflow(0,%s,&%s))"
+                        "au_fatal(\"integer overflow\\n\");\n",
+                        lhs, dest);
+        else
+            comp_printf(state, "%s=-%s;\n", dest, lhs);
+        break;
+    }
+    case AU_OP_BNOT: {
+        comp_printf(state, "%s=~%s;\n", dest, lhs);
+        break;
+    }
+    case AU_OP_CALL: {
+        const struct au_lib_func *lib_func =
+            au_c_types_fast_call(types, insn);
+        if (insn->reads.len > 1)
+            comp_printf(state, "%s=%s(%s,%s);\n", dest,
+                        lib_func->fast_symbol, lhs, rhs);
+        else
+            comp_printf(state, "%s=%s(%s);\n", dest,
+                        lib_func->fast_symbol, lhs);
+        if (native == AU_C_TYPE_INT)
+            comp_printf(state,
+                        "if(!au_platform_ifits(%s))"
+                        "au_fatal(\"integer overflow\\n\");\n",
+                        dest);
+        break;
+    }
+    case AU_OP_JIF:
+    case AU_OP_JNIF: {
+        comp_printf(state, "if(%s%s%s%s) goto L%d;\n",
+                    insn->op == AU_OP_JNIF ? "!(" : "", lhs,
+                    lhs_type == AU_C_TYPE_BOOL ? "" : ">0",
+                    insn->op == AU_OP_JNIF ? ")" : "", (int)insn->target);
+        break;
+    }
+    default:
+        au_fatal("unexpected unboxed instruction");
+    }
+#undef BIN_OP
+#undef ARITH_OP
+}
+
+/// Returns types if the type inference of a function succeeded, or NULL
+/// otherwise
+static const struct au_c_types *
+enabled_types(const struct au_c_types *types) {
+    return types->block_states != 0 ? types : 0;
+}
+
+/// Declares the unboxed variables of a function
+static void comp_native_decls(struct au_c_comp_state *state,
+                              const struct au_c_types *types) {
+    const uint8_t c_types[] = {AU_C_TYPE_INT, AU_C_TYPE_DOUBLE,
+                               AU_C_TYPE_BOOL};
+    const char *c_type_names[] = {"int64_t", "double", "int32_t"};
+    for (int i = 0; i < 3; i++) {
+        int has_value = 0;
+        for (int value = 0; value < types->num_values; value++) {
+            if ((types->native_types[value] & (1 << c_types[i])) == 0)
+                continue;
+            char name[16];
+            value_name(name, sizeof(name), types->bcs, value,
+                       c_types[i]);
+            if (has_value)
+                comp_printf(state, ", %s=0", name);
+            else
+                comp_printf(state, INDENT "%s %s=0", c_type_names[i],
+                            name);
+            has_value = 1;
+        }
+        if (has_value)
+            comp_printf(state, ";\n");
+    }
+}
+
+/// Checks the types of the arguments that a function speculates on. If
+/// the check fails, the generic version of the function is called
+/// instead.
+static void comp_arg_guard(struct au_c_comp_state *state,
+                           const struct au_c_types *types,
+                           size_t module_idx, size_t func_idx) {
+    const struct au_bc_storage *bcs = types->bcs;
+    comp_printf(state, INDENT "if(");
+    int is_first = 1;
+    for (int i = 0; i < bcs->num_args; i++) {
+        if (!types->int_args[i])
+            continue;
+        comp_printf(state, "%sau_value_get_type(l%d)!=AU_VALUE_INT",
+                    is_first ? "" : "||", i);
+        is_first = 0;
+    }
+    comp_printf(state, "){au_value_t _a[]={");
+    for (int i = 0; i < bcs->num_args; i++)
+        comp_printf(state, "l%d,", i);
+    comp_printf(state, "};return _M%d_f%d_g(_a);}\n", (int)module_idx,
+                (int)func_idx);
+    for (int i = 0; i < bcs->num_args; i++) {
+        if (types->int_args[i])
+            comp_printf(state, INDENT "il%d=au_value_get_int(l%d);\n", i,
+                        i);
+    }
+}
+
 // ** Linkage **
 
 static struct au_interpreter_result link_to_imported(
@@ -226,12 +629,14 @@ static struct au_interpreter_result link_to_imported(
         if (module_type == AU_MODULE_SOURCE) {
             if (imported_func->num_args == 0) {
                 comp_printf(state, INDENT "extern au_value_t _M%d_f%d();",
-                            (int)imported_module_idx_in_source, *fn_idx);
+                            (int)imported_module_idx_in_source,
+                            (int)*fn_idx);
             } else {
                 comp_printf(state,
                             INDENT "extern au_value_t _M%d_f%d"
-                                   "(au_value_t *args);",
-                            (int)imported_module_idx_in_source, *fn_idx);
+                                   "(const au_value_t *args);",
+                            (int)imported_module_idx_in_source,
+                            (int)*fn_idx);
             }
         } else {
             comp_printf(state, INDENT);
@@ -278,18 +683,20 @@ end:
 static void
 write_imported_module_main_start(size_t imported_module_idx_in_source,
                                  struct au_c_comp_global_state *g_state,
+                                 struct au_c_comp_state *state,
                                  const char *abspath,
                                  const char *subpath) {
-    comp_printf(&g_state->header_file, "static int _M%d_main_init=0;\n",
+    comp_printf(&g_state->header_file, "void _M%d_main();\n",
+                (int)imported_module_idx_in_source);
+    comp_printf(state, "static int _M%d_main_init=0;\n",
                 (int)imported_module_idx_in_source);
-    comp_printf(&g_state->header_file, "static void _M%d_main() {\n",
+    comp_printf(state, "void _M%d_main() {\n",
                 (int)imported_module_idx_in_source);
-    comp_printf(&g_state->header_file,
-                INDENT "if(_M%d_main_init){return;}\n",
+    comp_printf(state, INDENT "if(_M%d_main_init){return;}\n",
                 (int)imported_module_idx_in_source);
-    comp_printf(&g_state->header_file, INDENT "_M%d_main_init=1;\n",
+    comp_printf(state, INDENT "_M%d_main_init=1;\n",
                 (int)imported_module_idx_in_source);
-    comp_printf(&g_state->header_file,
+    comp_printf(state,
                 INDENT "struct au_module m;\n"
 
                 INDENT "struct au_module_resolve_result r="
@@ -297,10 +704,9 @@ write_imported_module_main_start(size_t imported_module_idx_in_source,
                        "r.abspath=\"%s\";\n",
                 abspath);
     if (subpath != 0) {
-        comp_printf(&g_state->header_file, INDENT "r.subpath=\"%s\";\n",
-                    subpath);
+        comp_printf(state, INDENT "r.subpath=\"%s\";\n", subpath);
     }
-    comp_printf(&g_state->header_file,
+    comp_printf(state,
                 INDENT "switch(au_module_import(&m,&r)){\n"
 
                 INDENT "case AU_MODULE_IMPORT_SUCCESS:"
@@ -318,10 +724,11 @@ write_imported_module_main_start(size_t imported_module_idx_in_source,
 static void
 write_imported_module_main(size_t imported_module_idx_in_source,
                            struct au_c_comp_global_state *g_state,
+                           struct au_c_comp_state *state,
                            const char *abspath, const char *subpath) {
     write_imported_module_main_start(imported_module_idx_in_source,
-                                     g_state, abspath, subpath);
-    comp_printf(&g_state->header_file, "}\n");
+                                     g_state, state, abspath, subpath);
+    comp_printf(state, "}\n");
 }
 
 // ** Main Aument to C compiler **
@@ -329,7 +736,8 @@ write_imported_module_main(size_t imported_module_idx_in_source,
 static struct au_interpreter_result au_c_comp_func(
     struct au_c_comp_state *state, const struct au_bc_storage *bcs,
     const struct au_program_data *p_data, const size_t module_idx,
-    const size_t func_idx, struct au_c_comp_global_state *g_state) {
+    const size_t func_idx, struct au_c_comp_global_state *g_state,
+    const struct au_c_types *types) {
     comp_printf(state, INDENT "au_value_t t;\n");
     if (bcs->num_registers > 0) {
         comp_printf(state, INDENT "au_value_t r0 = au_value_none()");
@@ -351,6 +759,8 @@ static struct au_interpreter_result au_c_comp_func(
             }
         }
     }
+    if (types != 0)
+        comp_native_decls(state, types);
 
 #define bc(x) au_bc_buf_at(&bcs->bc, x)
 #define DEF_BC16(VAR, OFFSET)                                             \
@@ -363,12 +773,20 @@ static struct au_interpreter_result au_c_comp_func(
     au_bit_array labelled_lines =
         au_data_malloc(AU_BA_LEN(bcs->bc.len / 4));
     memset(labelled_lines, 0, AU_BA_LEN(bcs->bc.len / 4));
+    int has_self_tail_call = 0;
 
     for (size_t pos = 0; pos < bcs->bc.len;) {
         uint8_t opcode = bc(pos);
         pos++;
 
         switch (opcode) {
+        case AU_OP_TAIL_CALL: {
+            DEF_BC16(func_id, 1);
+            if (au_c_types_is_self_tail_call(p_data, func_idx, opcode,
+                                             func_id))
+                has_self_tail_call = 1;
+            break;
+        }
         case AU_OP_JIF:
         case AU_OP_JNIF:
         case AU_OP_JREL: {
@@ -391,33 +809,28 @@ static struct au_interpreter_result au_c_comp_func(
         pos += 3;
     }
 
-    const struct au_program_source_map *current_source_map = 0;
-    size_t current_source_map_idx = bcs->source_map_start;
+    if (has_self_tail_call)
+        comp_printf(state, INDENT "tail_call:;\n");
+    if (types != 0 && types->num_int_args > 0)
+        comp_arg_guard(state, types, module_idx, func_idx);
+
+    // States of the values at the current instruction, if the function
+    // has unboxed values
+    struct au_c_value_state *vals = 0;
+    struct au_c_insn insn = (struct au_c_insn){0};
+    int falls_through = 0;
+    if (types != 0)
+        vals = au_data_calloc(types->num_values + 1,
+                              sizeof(struct au_c_value_state));
+
+    // Source map entries of the function are sorted by bc_from, so the
+    // #line directives are emitted while walking through them
+    size_t source_map_idx = bcs->source_map_start;
+    const size_t source_map_end =
+        bcs->source_map_start + bcs->source_map_len;
     const struct line_info_array *line_info_array = 0;
-    const struct line_info *current_line_info = 0;
-    size_t current_line_info_idx = 0;
 
     if (g_state->options.with_debug) {
-        if (p_data->source_map.len >= current_source_map_idx) {
-            if (func_idx == AU_SM_FUNC_ID_MAIN) {
-                while (current_source_map_idx < p_data->source_map.len) {
-                    if (p_data->source_map.data[current_source_map_idx]
-                            .func_idx == AU_SM_FUNC_ID_MAIN) {
-                        current_source_map =
-                            &p_data->source_map
-                                 .data[current_source_map_idx];
-                        break;
-                    }
-                    current_source_map_idx++;
-                }
-            } else {
-                current_source_map =
-                    &p_data->source_map.data[current_source_map_idx];
-                assert(current_source_map->func_idx == func_idx);
-                current_source_map_idx++;
-            }
-        }
-
         if (module_idx == 0) {
             line_info_array = &g_state->main_line_info;
         } else {
@@ -425,27 +838,6 @@ static struct au_interpreter_result au_c_comp_func(
                                    &g_state->modules, module_idx - 1)
                                    ->line_info;
         }
-
-        if (current_source_map) {
-            for (size_t i = 0; i < line_info_array->len; i++) {
-                if (line_info_array->data[i].source_start >=
-                    current_source_map->source_start) {
-                    if (line_info_array->data[i].source_start >
-                        current_source_map->source_start) {
-                        i--;
-                    }
-                    current_line_info_idx = i;
-                    current_line_info =
-                        line_info_array_at_ptr(line_info_array, i);
-                    // printf("start from # %d\n", i);
-                    break;
-                }
-            }
-            if (!current_line_info && line_info_array->len > 0) {
-                current_line_info =
-                    &line_info_array->data[line_info_array->len - 1];
-            }
-        }
     }
 
     int has_self = 0;
@@ -459,62 +851,56 @@ static struct au_interpreter_result au_c_comp_func(
     } while (0)
 
     for (size_t pos = 0; pos < bcs->bc.len;) {
-        if (current_source_map && current_line_info) {
-            if (pos == current_source_map->bc_to - 4) {
-                comp_printf(state, INDENT "#line %d \"%s\"\n",
-                            current_line_info->line, p_data->file);
-            } else if (pos > current_source_map->bc_to) {
-                if (current_source_map_idx == p_data->source_map.len) {
-                    current_source_map = 0;
-                } else {
-                    current_source_map =
-                        au_program_source_map_array_at_ptr(
-                            &p_data->source_map, current_source_map_idx++);
-                    if (module_idx == AU_SM_FUNC_ID_MAIN &&
-                        current_source_map->func_idx !=
-                            AU_SM_FUNC_ID_MAIN) {
-                        while (current_source_map_idx <
-                               p_data->source_map.len) {
-                            if (p_data->source_map
-                                    .data[current_source_map_idx]
-                                    .func_idx == AU_SM_FUNC_ID_MAIN) {
-                                break;
-                            }
-                            current_source_map_idx++;
-                        }
-                    }
-                    if (current_line_info) {
-                        while (current_source_map->source_start <
-                               current_line_info->source_start) {
-                            if (current_line_info->source_start >
-                                current_source_map->source_start) {
-                                int old_line = current_line_info->line;
-                                current_line_info = line_info_array_at_ptr(
-                                    line_info_array,
-                                    ++current_line_info_idx);
-                                assert(current_line_info->line >=
-                                       old_line);
-                                break;
-                            }
-                            if (current_line_info_idx ==
-                                line_info_array->len) {
-                                current_source_map = 0;
-                                break;
-                            }
-                            current_line_info = line_info_array_at_ptr(
-                                line_info_array, current_line_info_idx++);
-                        }
-                    }
-                }
+        if (vals != 0) {
+            const struct au_c_value_state *block_vals =
+                au_c_types_block_state(types, pos);
+            if (block_vals != 0) {
+                if (falls_through)
+                    comp_edge(state, types, vals, pos, 1);
+                memcpy(vals, block_vals,
+                       types->num_values *
+                           sizeof(struct au_c_value_state));
             }
         }
 
+        if (line_info_array != 0) {
+            // Use the innermost statement starting at this instruction
+            const struct au_program_source_map *map = 0;
+            while (source_map_idx < source_map_end &&
+                   p_data->source_map.data[source_map_idx].bc_from <= pos)
+                map = &p_data->source_map.data[source_map_idx++];
+            if (map != 0)
+                comp_printf(state, INDENT "#line %d \"%s\"\n",
+                            find_line(line_info_array, map->source_start),
+                            p_data->file);
+        }
+
         if (AU_BA_GET_BIT(labelled_lines, pos / 4)) {
             comp_printf(state, INDENT "L%d: ", (int)pos);
         } else {
             comp_printf(state, INDENT);
         }
 
+        if (vals != 0) {
+            au_c_types_decode(types, &insn, pos);
+            const enum au_c_type native =
+                au_c_types_native(types, vals, &insn);
+            if (insn.op == AU_OP_JIF || insn.op == AU_OP_JNIF ||
+                insn.op == AU_OP_JREL || insn.op == AU_OP_JRELB)
+                comp_edge(state, types, vals, insn.target, 0);
+            falls_through = au_c_types_falls_through(types, &insn);
+            if (native != AU_C_TYPE_UNDEF) {
+                comp_native_insn(state, types, vals, &insn, native,
+                                 module_idx);
+                au_c_types_transfer(types, vals, &insn, native);
+                pos += insn.size;
+                continue;
+            }
+            for (size_t i = 0; i < insn.reads.len; i++)
+                comp_box(state, bcs, vals, insn.reads.data[i]);
+            au_c_types_transfer(types, vals, &insn, native);
+        }
+
         const uint8_t opcode = bc(pos++);
 
         switch (opcode) {
@@ -581,24 +967,24 @@ static struct au_interpreter_result au_c_comp_func(
             uint8_t reg = bc(pos);
             DEF_BC16(c, 1);
 
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         "static au_value_t _M%d_c%d_val;\n",
                         (int)module_idx, c);
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         "static int _M%d_c%d_val_init=0;\n",
                         (int)module_idx, c);
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         "static inline au_value_t _M%d_c%d() {\n",
                         (int)module_idx, c);
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         INDENT "if(!_M%d_c%d_val_init)abort();\n",
                         (int)module_idx, c);
             comp_printf(
-                &g_state->header_file,
+                g_state->module_header,
                 INDENT
                 "au_value_ref(_M%d_c%d_val); return _M%d_c%d_val;\n",
                 (int)module_idx, c, (int)module_idx, c);
-            comp_printf(&g_state->header_file, "}");
+            comp_printf(g_state->module_header, "}");
 
             comp_printf(state, "MOVE_VALUE(_M%d_c%d_val,r%d);",
                         (int)module_idx, c, reg);
@@ -619,14 +1005,8 @@ static struct au_interpreter_result au_c_comp_func(
         pos += 3;                                                         \
         break;                                                            \
     }
-        case AU_OP_MUL:
-            BIN_OP("mul")
         case AU_OP_DIV:
             BIN_OP("div")
-        case AU_OP_ADD:
-            BIN_OP("add")
-        case AU_OP_SUB:
-            BIN_OP("sub")
         case AU_OP_MOD:
             BIN_OP("mod")
         case AU_OP_EQ:
@@ -647,7 +1027,77 @@ static struct au_interpreter_result au_c_comp_func(
             BIN_OP("bor")
         case AU_OP_BXOR:
             BIN_OP("bxor")
+        case AU_OP_BSHR:
+            BIN_OP("bshr")
 #undef BIN_OP
+        // Binary operations on integers. These fall back to the generic
+        // operations if one of the operands isn't an integer.
+#define INT_BIN_OP(NAME, EXPR)                                            \
+    {                                                                     \
+        uint8_t lhs = bc(pos);                                            \
+        uint8_t rhs = bc(pos + 1);                                        \
+        uint8_t res = bc(pos + 2);                                        \
+        comp_printf(state,                                                \
+                    "if(au_value_get_type(r%d)==AU_VALUE_INT&&"           \
+                    "au_value_get_type(r%d)==AU_VALUE_INT){"              \
+                    "const int64_t li=au_value_get_int(r%d),"             \
+                    "ri=au_value_get_int(r%d);"                           \
+                    "MOVE_VALUE(r%d," EXPR ");"                           \
+                    "}else{"                                              \
+                    "MOVE_VALUE(r%d,au_value_" NAME "(r%d,r%d));"         \
+                    "}\n",                                                \
+                    lhs, rhs, lhs, rhs, res, res, lhs, rhs);              \
+        pos += 3;                                                         \
+        break;                                                            \
+    }
+        // Integer arithmetic aborts the program if the result doesn't
+        // fit in a value. The generic operations are checked as well,
+        // since their operands can be boxed integers.
+#define CHECKED_INT_BIN_OP(NAME, FN)                                      \
+    {                                                                     \
+        uint8_t lhs = bc(pos);                                            \
+        uint8_t rhs = bc(pos + 1);                                        \
+        uint8_t res = bc(pos + 2);                                        \
+        comp_printf(state,                                                \
+                    "if(au_value_get_type(r%d)==AU_VALUE_INT&&"           \
+                    "au_value_get_type(r%d)==AU_VALUE_INT){"              \
+                    "int64_t d;"                                          \
+                    "if(" FN "(au_value_get_int(r%d),"                    \
+                    "au_value_get_int(r%d),&d))"                          \
+                    "au_fatal(\"integer overflow\\n\");"                  \
+                    "MOVE_VALUE(r%d,au_value_int(d));"                    \
+                    "}else{"                                              \
+                    "MOVE_VALUE(r%d,au_value_" NAME "(r%d,r%d));"         \
+                    "}\n",                                                \
+                    lhs, rhs, lhs, rhs, res, res, lhs, rhs);              \
+        pos += 3;                                                         \
+        break;                                                            \
+    }
+        case AU_OP_MUL:
+        case AU_OP_MUL_INT:
+            CHECKED_INT_BIN_OP("mul", "au_platform_imul_overflow")
+        case AU_OP_ADD:
+        case AU_OP_ADD_INT:
+            CHECKED_INT_BIN_OP("add", "au_platform_iadd_overflow")
+        case AU_OP_SUB:
+        case AU_OP_SUB_INT:
+            CHECKED_INT_BIN_OP("sub", "au_platform_isub_overflow")
+        case AU_OP_BSHL:
+            CHECKED_INT_BIN_OP("bshl", "au_platform_ishl_overflow")
+#undef CHECKED_INT_BIN_OP
+        case AU_OP_EQ_INT:
+            INT_BIN_OP("eq", "au_value_bool(li==ri)")
+        case AU_OP_NEQ_INT:
+            INT_BIN_OP("neq", "au_value_bool(li!=ri)")
+        case AU_OP_LT_INT:
+            INT_BIN_OP("lt", "au_value_bool(li<ri)")
+        case AU_OP_GT_INT:
+            INT_BIN_OP("gt", "au_value_bool(li>ri)")
+        case AU_OP_LEQ_INT:
+            INT_BIN_OP("leq", "au_value_bool(li<=ri)")
+        case AU_OP_GEQ_INT:
+            INT_BIN_OP("geq", "au_value_bool(li>=ri)")
+#undef INT_BIN_OP
         // Unary instructions
         case AU_OP_NOT: {
             uint8_t reg = bc(pos);
@@ -670,8 +1120,14 @@ static struct au_interpreter_result au_c_comp_func(
         case AU_OP_NEG: {
             uint8_t reg = bc(pos);
             uint8_t ret = bc(pos + 1);
-            comp_printf(state, "COPY_VALUE(r%d,au_value_neg(r%d));", ret,
-                        reg);
+            // Negating an integer fails only if it overflows
+            comp_printf(state,
+                        "{const au_value_t n=au_value_neg(r%d);"
+                        "if(au_value_is_error(n)&&"
+                        "au_value_get_type(r%d)==AU_VALUE_INT)"
+                        "au_fatal(\"integer overflow\\n\");"
+                        "COPY_VALUE(r%d,n);}\n",
+                        reg, reg, ret);
             pos += 3;
             break;
         }
@@ -710,11 +1166,18 @@ static struct au_interpreter_result au_c_comp_func(
             break;
         }
         // Call instructions
-        case AU_OP_CALL: {
+        case AU_OP_CALL:
+        case AU_OP_TAIL_CALL: {
             uint8_t reg = bc(pos);
             DEF_BC16(func_id, 1);
             pos += 3;
 
+            if (au_c_types_is_self_tail_call(p_data, func_idx, opcode,
+                                             func_id)) {
+                pos = comp_self_tail_call(state, bcs, pos);
+                break;
+            }
+
             const struct au_fn *fn =
                 au_fn_array_at_ptr(&p_data->fns, func_id);
             const int num_args = au_fn_num_args(fn);
@@ -756,6 +1219,9 @@ static struct au_interpreter_result au_c_comp_func(
                 }
                 au_data_free(params.data);
                 comp_printf(state, "};");
+                // Callees own their arguments
+                for (int i = 0; i < num_args; i++)
+                    comp_printf(state, "au_value_ref(_args[%d]);", i);
             }
 
             switch (fn->type) {
@@ -1007,6 +1473,16 @@ static struct au_interpreter_result au_c_comp_func(
                                        mmap.size);
 
                 if (!has_old_value) {
+                    // The module's slot is reserved before it is
+                    // compiled, so that the modules it imports get
+                    // indices of their own
+                    struct au_c_comp_module reserved =
+                        (struct au_c_comp_module){0};
+                    reserved.line_info = line_info_array;
+                    line_info_array = (struct line_info_array){0};
+                    au_c_comp_module_array_add(&g_state->modules,
+                                               reserved);
+
                     struct au_program program;
                     struct au_parser_result parse_res =
                         au_parse(mmap.bytes, mmap.size, &program);
@@ -1041,12 +1517,13 @@ static struct au_interpreter_result au_c_comp_func(
                     if (retval.type != AU_INT_ERR_OK)
                         RAISE(retval);
 
-                    struct au_c_comp_module comp_module =
-                        (struct au_c_comp_module){0};
-                    comp_module.fns = program.data.fns;
-                    comp_module.fn_map = program.data.fn_map;
-                    comp_module.classes = program.data.classes;
-                    comp_module.class_map = program.data.class_map;
+                    struct au_c_comp_module *comp_module =
+                        au_c_comp_module_array_at_mut(&g_state->modules,
+                                                      imported_module_idx);
+                    comp_module->fns = program.data.fns;
+                    comp_module->fn_map = program.data.fn_map;
+                    comp_module->classes = program.data.classes;
+                    comp_module->class_map = program.data.class_map;
                     program.data.fns = (struct au_fn_array){0};
                     program.data.fn_map = (struct au_hm_vars){0};
                     program.data.classes =
@@ -1054,14 +1531,8 @@ static struct au_interpreter_result au_c_comp_func(
                     program.data.class_map = (struct au_hm_vars){0};
                     au_program_del(&program);
 
-                    comp_module.c_source = mod_state.str;
+                    comp_module->c_source = mod_state.str;
                     mod_state.str = (struct au_char_array){0};
-
-                    comp_module.line_info = line_info_array;
-                    line_info_array = (struct line_info_array){0};
-
-                    au_c_comp_module_array_add(&g_state->modules,
-                                               comp_module);
                 }
                 break;
             }
@@ -1074,12 +1545,17 @@ static struct au_interpreter_result au_c_comp_func(
 
                 char *lib_filename = basename(resolve_res.abspath);
 
+                // The wrappers around a library's functions are written
+                // into their own translation unit
+                struct au_c_comp_state lib_state = {0};
+
                 if (loaded_module == 0) {
                     write_imported_module_main(
                         imported_module_idx_in_source, g_state,
-                        lib_filename, resolve_res.subpath);
+                        &lib_state, lib_filename, resolve_res.subpath);
                     struct au_c_comp_module comp_module =
                         (struct au_c_comp_module){0};
+                    comp_module.c_source = lib_state.str;
                     au_c_comp_module_array_add(&g_state->modules,
                                                comp_module);
                     // TODO: check for imported functions and error if they
@@ -1095,7 +1571,7 @@ static struct au_interpreter_result au_c_comp_func(
                             const struct au_fn *loaded_fn =
                                 au_fn_array_at_ptr(&loaded_module->fns,
                                                    entry);
-                            comp_printf(&g_state->header_file,
+                            comp_printf(&lib_state,
                                         "static au_extern_func_t "
                                         "_M%d_f%d_ext=0;\n",
                                         (int)imported_module_idx_in_source,
@@ -1103,7 +1579,12 @@ static struct au_interpreter_result au_c_comp_func(
                             if (au_fn_num_args(loaded_fn) == 0) {
                                 comp_printf(
                                     &g_state->header_file,
-                                    "static au_value_t "
+                                    "au_value_t _M%d_f%d();\n",
+                                    (int)imported_module_idx_in_source,
+                                    (int)entry);
+                                comp_printf(
+                                    &lib_state,
+                                    "au_value_t "
                                     "_M%d_f%d(){"
                                     "return _M%d_f%d_ext(0,0);"
                                     "}\n",
@@ -1114,7 +1595,12 @@ static struct au_interpreter_result au_c_comp_func(
                             } else {
                                 comp_printf(
                                     &g_state->header_file,
-                                    "static au_value_t "
+                                    "au_value_t _M%d_f%d(au_value_t*a);\n",
+                                    (int)imported_module_idx_in_source,
+                                    (int)entry);
+                                comp_printf(
+                                    &lib_state,
+                                    "au_value_t "
                                     "_M%d_f%d(au_value_t*a){"
                                     "return _M%d_f%d_ext(0,a);"
                                     "}\n",
@@ -1135,22 +1621,20 @@ static struct au_interpreter_result au_c_comp_func(
                                                name_len, 0);
                             }
                         });
-                    au_c_comp_module_array_add(&g_state->modules,
-                                               comp_module);
 
                     write_imported_module_main_start(
                         imported_module_idx_in_source, g_state,
-                        lib_filename, resolve_res.subpath);
+                        &lib_state, lib_filename, resolve_res.subpath);
                     AU_HM_VARS_FOREACH_PAIR(
                         &loaded_module->fn_map, name, entry, {
-                            comp_printf(&g_state->header_file,
+                            comp_printf(&lib_state,
                                         INDENT "_M%d_f%d_ext="
                                                "au_module_get_fn"
                                                "(&m,\"%.*s\");\n",
                                         (int)imported_module_idx_in_source,
                                         (int)entry, (int)name_len, name);
                             comp_printf(
-                                &g_state->header_file,
+                                &lib_state,
                                 INDENT
                                 "if(_M%d_f%d_ext==0)"
                                 "au_fatal(\"failed to import function "
@@ -1159,7 +1643,11 @@ static struct au_interpreter_result au_c_comp_func(
                                 (int)entry, (int)name_len, name,
                                 lib_filename);
                         });
-                    comp_printf(&g_state->header_file, "}\n");
+                    comp_printf(&lib_state, "}\n");
+
+                    comp_module.c_source = lib_state.str;
+                    au_c_comp_module_array_add(&g_state->modules,
+                                               comp_module);
                 }
 
                 au_program_data_del(loaded_module);
@@ -1262,6 +1750,17 @@ static struct au_interpreter_result au_c_comp_func(
             pos += 3;
             break;
         }
+        // Dictionary instructions
+        case AU_OP_DICT_NEW: {
+            uint8_t reg = bc(pos);
+            comp_printf(state,
+                        "MOVE_VALUE(r%d,"
+                        "au_value_struct("
+                        "(struct au_struct*)au_obj_dict_new()));\n",
+                        reg);
+            pos += 3;
+            break;
+        }
         // Class instructions
         case AU_OP_CLASS_NEW: {
             uint8_t reg = bc(pos);
@@ -1329,11 +1828,13 @@ static struct au_interpreter_result au_c_comp_func(
     }
 
     au_data_free(labelled_lines);
+    au_data_free(vals);
+    au_data_free(insn.reads.data);
     return (struct au_interpreter_result){0};
 }
 
-struct au_interpreter_result
-au_c_comp_module(struct au_c_comp_state *state,
+static struct au_interpreter_result
+comp_module_code(struct au_c_comp_state *state,
                  const struct au_program *program, const size_t module_idx,
                  struct au_c_comp_global_state *g_state) {
     for (size_t i = 0; i < program->data.data_val.len; i++) {
@@ -1359,8 +1860,8 @@ au_c_comp_module(struct au_c_comp_state *state,
             break;
         }
         case AU_VALUE_INT: {
-            comp_printf(state, "return au_value_int(%d);\n",
-                        au_value_get_int(val->real_value));
+            comp_printf(state, "return au_value_int(%lld);\n",
+                        (long long)au_value_get_int(val->real_value));
             break;
         }
         case AU_VALUE_DOUBLE: {
@@ -1398,9 +1899,11 @@ _decl_fn_lib:;
                 &g_state->declared_externs, fn->as.lib_func.symbol,
                 strlen(fn->as.lib_func.symbol), 0);
             if (old == 0) {
-                comp_printf(state, "extern AU_EXTERN_FUNC_DECL(%s);\n",
+                comp_printf(&g_state->header_file,
+                            "extern AU_EXTERN_FUNC_DECL(%s);\n",
                             fn->as.lib_func.symbol);
             }
+            comp_fast_fn_decl(g_state, &fn->as.lib_func);
             break;
         }
         case AU_FN_IMPORTER: {
@@ -1476,6 +1979,28 @@ _decl_fn_lib:;
         const struct au_fn *fn = &program->data.fns.data[i];
         if (fn->type == AU_FN_BC) {
             const struct au_bc_storage *bcs = &fn->as.bc_func;
+            struct au_c_types types;
+            au_c_types_analyze(&types, bcs, &program->data, i, 1);
+            if (types.num_int_args > 0) {
+                // Generic version of the function, which is called if
+                // the arguments don't have the expected types
+                struct au_c_types generic_types;
+                au_c_types_analyze(&generic_types, bcs, &program->data, i,
+                                   0);
+                comp_printf(state,
+                            "static au_value_t _M%d_f%d_g"
+                            "(const au_value_t *args) {\n",
+                            (int)module_idx, (int)i);
+                struct au_interpreter_result retval = au_c_comp_func(
+                    state, bcs, &program->data, module_idx, i, g_state,
+                    enabled_types(&generic_types));
+                au_c_types_del(&generic_types);
+                if (retval.type != AU_INT_ERR_OK) {
+                    au_c_types_del(&types);
+                    return retval;
+                }
+                comp_printf(state, "}\n");
+            }
             if (bcs->num_args > 0) {
                 comp_printf(
                     state,
@@ -1485,8 +2010,10 @@ _decl_fn_lib:;
                 comp_printf(state, "au_value_t _M%d_f%d() {\n",
                             (int)module_idx, (int)i);
             }
-            struct au_interpreter_result retval = au_c_comp_func(
-                state, bcs, &program->data, module_idx, i, g_state);
+            struct au_interpreter_result retval =
+                au_c_comp_func(state, bcs, &program->data, module_idx, i,
+                               g_state, enabled_types(&types));
+            au_c_types_del(&types);
             if (retval.type != AU_INT_ERR_OK)
                 return retval;
             comp_printf(state, "}\n");
@@ -1512,99 +2039,180 @@ _decl_fn_lib:;
         }
         comp_printf(&g_state->header_file, "};\n");
 
-        // Delete function
         comp_printf(&g_state->header_file,
+                    "extern struct au_struct_vdata"
+                    " _struct_M%d_%d_vdata;\n",
+                    (int)module_idx, (int)i);
+        comp_printf(&g_state->header_file,
+                    "struct _M%d_%d *_struct_M%d_%d_new();\n",
+                    (int)module_idx, (int)i, (int)module_idx, (int)i);
+
+        // Delete function
+        comp_printf(g_state->module_header,
                     "void _struct_M%d_%d_del_fn("
                     "struct _M%d_%d*s"
                     "){\n",
                     (int)module_idx, (int)i, (int)module_idx, (int)i);
         for (size_t i = 0; i < interface->map.nitems; i++) {
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         INDENT "au_value_deref(s->v[%d]);\n", (int)i);
         }
-        comp_printf(&g_state->header_file, "}\n");
+        comp_printf(g_state->module_header, "}\n");
+
+        // Field access by name
+        comp_printf(g_state->module_header,
+                    "int _struct_M%d_%d_idx_get_fn("
+                    "struct _M%d_%d*s,au_value_t k,au_value_t*r"
+                    "){\n",
+                    (int)module_idx, (int)i, (int)module_idx, (int)i);
+        comp_printf(g_state->module_header,
+                    INDENT "if(au_value_get_type(k)!=AU_VALUE_STR)"
+                           "return 0;\n");
+        comp_printf(g_state->module_header,
+                    INDENT "const struct au_string*n="
+                           "au_value_get_string(k);(void)n;\n");
+        AU_HM_VARS_FOREACH_PAIR(&interface->map, name, field_idx, {
+            comp_printf(g_state->module_header,
+                        INDENT "if(n->len==%d&&"
+                               "memcmp(n->data,\"%.*s\",%d)==0)"
+                               "{au_value_ref(s->v[%d]);"
+                               "*r=s->v[%d];return 1;}\n",
+                        (int)name_len, (int)name_len, name,
+                        (int)name_len, (int)field_idx, (int)field_idx);
+        })
+        comp_printf(g_state->module_header, INDENT "return 0;\n}\n");
+
+        comp_printf(g_state->module_header,
+                    "int _struct_M%d_%d_idx_set_fn("
+                    "struct _M%d_%d*s,au_value_t k,au_value_t v"
+                    "){\n",
+                    (int)module_idx, (int)i, (int)module_idx, (int)i);
+        comp_printf(g_state->module_header,
+                    INDENT "if(au_value_get_type(k)!=AU_VALUE_STR)"
+                           "return 0;\n");
+        comp_printf(g_state->module_header,
+                    INDENT "const struct au_string*n="
+                           "au_value_get_string(k);(void)n;\n");
+        AU_HM_VARS_FOREACH_PAIR(&interface->map, name, field_idx, {
+            comp_printf(g_state->module_header,
+                        INDENT "if(n->len==%d&&"
+                               "memcmp(n->data,\"%.*s\",%d)==0)"
+                               "{au_value_deref(s->v[%d]);"
+                               "s->v[%d]=v;return 1;}\n",
+                        (int)name_len, (int)name_len, name,
+                        (int)name_len, (int)field_idx, (int)field_idx);
+        })
+        comp_printf(g_state->module_header, INDENT "return 0;\n}\n");
+
+        comp_printf(g_state->module_header,
+                    "int32_t _struct_M%d_%d_len_fn("
+                    "struct _M%d_%d*s){(void)s;return %d;}\n",
+                    (int)module_idx, (int)i, (int)module_idx, (int)i,
+                    (int)interface->map.nitems);
 
         // Virtual data function
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     "static int _struct_M%d_%d_vdata_init=0;\n",
                     (int)module_idx, (int)i);
-        comp_printf(&g_state->header_file,
-                    "static struct au_struct_vdata"
+        comp_printf(g_state->module_header,
+                    "struct au_struct_vdata"
                     " _struct_M%d_%d_vdata={0};\n",
                     (int)module_idx, (int)i);
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     "struct au_struct_vdata *"
                     "_struct_M%d_%d_vdata_get(){\n",
                     (int)module_idx, (int)i);
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     INDENT "if(_struct_M%d_%d_vdata_init)"
                            "return &_struct_M%d_%d_vdata;\n",
                     (int)module_idx, (int)i, (int)module_idx, (int)i);
 #define VDATA_FUNC(NAME)                                                  \
-    comp_printf(&g_state->header_file,                                    \
+    comp_printf(g_state->module_header,                                   \
                 INDENT "_struct_M%d_%d_vdata." NAME "="                   \
                        "(au_struct_" NAME "_t)_struct_M%d_%d_" NAME       \
                        ";\n",                                             \
                 (int)module_idx, (int)i, (int)module_idx, (int)i);
         VDATA_FUNC("del_fn")
+        VDATA_FUNC("idx_get_fn")
+        VDATA_FUNC("idx_set_fn")
+        VDATA_FUNC("len_fn")
 #undef VDATA_FUNC
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     INDENT "_struct_M%d_%d_vdata_init=1;"
                            "return &_struct_M%d_%d_vdata;\n}\n",
                     (int)module_idx, (int)i, (int)module_idx, (int)i);
 
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     "struct _M%d_%d *_struct_M%d_%d_new(){\n",
                     (int)module_idx, (int)i, (int)module_idx, (int)i);
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     INDENT "struct _M%d_%d*k="
                            "au_obj_malloc(sizeof(struct _M%d_%d),"
                            "(au_obj_del_fn_t)_struct_M%d_%d_del_fn);\n",
                     (int)module_idx, (int)i, (int)module_idx, (int)i,
                     (int)module_idx, (int)i);
-        comp_printf(&g_state->header_file,
+        comp_printf(g_state->module_header,
                     INDENT "k->header.vdata=_struct_M%d_%d_vdata_get();\n",
                     (int)module_idx, (int)i);
         for (size_t i = 0; i < interface->map.nitems; i++) {
-            comp_printf(&g_state->header_file,
+            comp_printf(g_state->module_header,
                         INDENT "k->v[%d]=au_value_none();\n", (int)i);
         }
-        comp_printf(&g_state->header_file, INDENT "return k;\n}\n");
+        comp_printf(g_state->module_header, INDENT "return k;\n}\n");
     }
 
     comp_printf(state, "static int _M%d_main_init=0;\n", (int)module_idx);
-    comp_printf(state, "static au_value_t _M%d_main() {\n",
-                (int)module_idx);
+    comp_printf(state, "au_value_t _M%d_main() {\n", (int)module_idx);
     comp_printf(state,
                 INDENT "if(_M%d_main_init){return au_value_none();}\n",
                 (int)module_idx);
     comp_printf(state, INDENT "_M%d_main_init=1;\n", (int)module_idx);
-    struct au_interpreter_result retval =
-        au_c_comp_func(state, &program->main, &program->data, module_idx,
-                       AU_SM_FUNC_ID_MAIN, g_state);
+    struct au_c_types types;
+    au_c_types_analyze(&types, &program->main, &program->data,
+                       AU_SM_FUNC_ID_MAIN, 0);
+    struct au_interpreter_result retval = au_c_comp_func(
+        state, &program->main, &program->data, module_idx,
+        AU_SM_FUNC_ID_MAIN, g_state, enabled_types(&types));
+    au_c_types_del(&types);
     if (retval.type != AU_INT_ERR_OK)
         return retval;
     comp_printf(state, "}\n");
-    comp_printf(&g_state->header_file, "static au_value_t _M%d_main();\n",
+    comp_printf(&g_state->header_file, "au_value_t _M%d_main();\n",
                 (int)module_idx);
     return (struct au_interpreter_result){.type = AU_INT_ERR_OK};
 }
 
+struct au_interpreter_result
+au_c_comp_module(struct au_c_comp_state *state,
+                 const struct au_program *program, const size_t module_idx,
+                 struct au_c_comp_global_state *g_state) {
+    struct au_c_comp_state *old_module_header = g_state->module_header;
+    struct au_c_comp_state module_header = {0};
+    g_state->module_header = &module_header;
+    struct au_interpreter_result retval =
+        comp_module_code(state, program, module_idx, g_state);
+    g_state->module_header = old_module_header;
+    if (retval.type == AU_INT_ERR_OK) {
+        comp_write(&module_header, state->str.data, state->str.len);
+        au_c_comp_state_del(state);
+        state->str = module_header.str;
+    } else {
+        au_c_comp_state_del(&module_header);
+    }
+    return retval;
+}
+
 extern const char AU_RT_HDR[];
 extern const size_t AU_RT_HDR_LEN;
+extern const char AU_RT_DECL_HDR[];
+extern const size_t AU_RT_DECL_HDR_LEN;
 
 #ifdef AU_TEST_RT_CODE
 char *TEST_RT_CODE;
 size_t TEST_RT_CODE_LEN;
 #endif
 
-struct au_interpreter_result
-au_c_comp(struct au_c_comp_state *state, const struct au_program *program,
-          const struct au_c_comp_options *options,
-          struct au_cc_options *cc) {
-    struct au_interpreter_result retval =
-        (struct au_interpreter_result){.type = AU_INT_ERR_OK};
-
+static void comp_runtime(struct au_c_comp_state *state) {
     comp_printf(
         state,
         "/* Code for Aument's core library. Do not edit this. */\n");
@@ -1616,6 +2224,35 @@ au_c_comp(struct au_c_comp_state *state, const struct au_program *program,
     comp_write(state, TEST_RT_CODE, TEST_RT_CODE_LEN);
     comp_putc(state, '\n');
 #endif
+}
+
+/// Adds a translation unit for a module. Only the first unit contains
+///     the definitions of the core library, the rest only declare it.
+static void comp_unit(struct au_c_comp_state *state,
+                      const struct au_c_comp_global_state *g_state,
+                      const struct au_char_array *source) {
+    struct au_c_comp_state unit = {0};
+    if (state->units.len == 0) {
+        comp_runtime(&unit);
+    } else {
+        comp_printf(&unit, "/* Declarations for Aument's core library. "
+                           "Do not edit this. */\n");
+        comp_write(&unit, AU_RT_DECL_HDR, AU_RT_DECL_HDR_LEN);
+        comp_putc(&unit, '\n');
+    }
+    comp_printf(&unit, "/* Code generated from source file */\n");
+    comp_printf(&unit, "%.*s\n", (int)g_state->header_file.str.len,
+                g_state->header_file.str.data);
+    comp_printf(&unit, "%.*s\n", (int)source->len, source->data);
+    au_c_comp_unit_array_add(&state->units, unit.str);
+}
+
+struct au_interpreter_result
+au_c_comp(struct au_c_comp_state *state, const struct au_program *program,
+          const struct au_c_comp_options *options,
+          struct au_cc_options *cc) {
+    struct au_interpreter_result retval =
+        (struct au_interpreter_result){.type = AU_INT_ERR_OK};
 
     struct au_c_comp_global_state g_state =
         (struct au_c_comp_global_state){0};
@@ -1641,24 +2278,36 @@ au_c_comp(struct au_c_comp_state *state, const struct au_program *program,
         .error_file = 0,
     };
     if ((retval = au_c_comp_module(&main_mod_state, program, 0, &g_state))
-            .type != AU_INT_ERR_OK)
+            .type != AU_INT_ERR_OK) {
+        au_c_comp_state_del(&main_mod_state);
         goto end;
-
-    comp_printf(state, "/* Code generated from source file */\n");
-
-    comp_printf(state, "%.*s\n", (int)g_state.header_file.str.len,
-                g_state.header_file.str.data);
-    comp_printf(state, "%.*s\n", (int)main_mod_state.str.len,
-                main_mod_state.str.data);
-
-    au_c_comp_state_del(&main_mod_state);
-    comp_printf(state, "int main() { _M0_main(); return 0; }\n");
-
-    for (size_t i = 0; i < g_state.modules.len; i++) {
-        const struct au_c_comp_module *module = &g_state.modules.data[i];
-        comp_printf(state, "%.*s\n", (int)module->c_source.len,
-                    module->c_source.data);
     }
+    comp_printf(&main_mod_state, "int main() { au_value_print_init(); "
+                                 "_M0_main(); return 0; }\n");
+
+    if (options->split_units) {
+        comp_unit(state, &g_state, &main_mod_state.str);
+        for (size_t i = 0; i < g_state.modules.len; i++) {
+            const struct au_c_comp_module *module =
+                &g_state.modules.data[i];
+            if (module->c_source.len != 0)
+                comp_unit(state, &g_state, &module->c_source);
+        }
+    } else {
+        comp_runtime(state);
+        comp_printf(state, "/* Code generated from source file */\n");
+        comp_printf(state, "%.*s\n", (int)g_state.header_file.str.len,
+                    g_state.header_file.str.data);
+        comp_printf(state, "%.*s", (int)main_mod_state.str.len,
+                    main_mod_state.str.data);
+        for (size_t i = 0; i < g_state.modules.len; i++) {
+            const struct au_c_comp_module *module =
+                &g_state.modules.data[i];
+            comp_printf(state, "%.*s\n", (int)module->c_source.len,
+                        module->c_source.data);
+        }
+    }
+    au_c_comp_state_del(&main_mod_state);
 
     if (cc) {
         cc->loads_dl = g_state.loads_dl;
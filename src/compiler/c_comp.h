@@ -14,8 +14,13 @@
 #include "os/cc.h"
 #include "platform/platform.h"
 
+AU_ARRAY_STRUCT(struct au_char_array, au_c_comp_unit_array, 1)
+
 struct au_c_comp_state {
     struct au_char_array str;
+    /// Translation units of the program, one per module. This is only
+    ///     filled if split_units is set in au_c_comp_options.
+    struct au_c_comp_unit_array units;
     const char *error_file;
 };
 
@@ -27,10 +32,14 @@ struct au_program;
 
 struct au_c_comp_options {
     int with_debug;
+    /// Write every module into its own translation unit instead of
+    ///     a single C file
+    int split_units;
 };
 
 /// [func] Compiles a program into file specified by
-/// an au_c_comp_state instance
+/// an au_c_comp_state instance, or into one translation unit per module
+/// if options->split_units is set
 /// @param state An empty zero-initialized au_c_comp_state object
 /// @param program An au_program object generated by the parser
 /// @param options Additional C code generation options
@@ -0,0 +1,524 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#include <string.h>
+
+#include "core/parser/impl/bc_pass.h"
+#include "core/program.h"
+#include "core/rt/malloc.h"
+
+#include "c_types.h"
+
+/// Functions with more basic blocks times values than this are compiled
+/// without type inference
+#define MAX_BLOCK_STATES (1 << 22)
+
+int au_c_types_is_self_tail_call(const struct au_program_data *p_data,
+                                 size_t func_idx, uint8_t opcode,
+                                 size_t func_id) {
+    if (opcode != AU_OP_TAIL_CALL || func_id != func_idx)
+        return 0;
+    const struct au_fn *fn = au_fn_array_at_ptr(&p_data->fns, func_id);
+    return fn->type == AU_FN_BC &&
+           (fn->flags & AU_FN_FLAG_HAS_CLASS) == 0;
+}
+
+static void decode_args(const struct au_c_types *types,
+                        struct au_c_insn *insn, int num_args) {
+    const struct au_bc_buf *bc = &types->bcs->bc;
+    for (int i = 0; i < num_args; i++) {
+        const size_t arg_pos = insn->pos + 4 + (i / 3) * 4 + 1 + i % 3;
+        au_c_value_array_add(&insn->reads, bc->data[arg_pos]);
+    }
+    insn->size = 4 + ((num_args + 2) / 3) * 4;
+}
+
+void au_c_types_decode(const struct au_c_types *types,
+                       struct au_c_insn *insn, size_t pos) {
+    const struct au_bc_storage *bcs = types->bcs;
+    const struct au_bc_buf *bc = &bcs->bc;
+    const uint8_t op = bc->data[pos];
+    insn->op = op;
+    insn->pos = pos;
+    insn->size = 4;
+    insn->dest = -1;
+    insn->reads.len = 0;
+    insn->target = 0;
+    if (pos + 4 > bc->len)
+        return;
+
+    switch (op) {
+    case AU_OP_CALL:
+    case AU_OP_CALL_CATCH:
+    case AU_OP_TAIL_CALL: {
+        const struct au_fn *fn =
+            &types->p_data->fns.data[read_u16(bc, pos + 2)];
+        insn->dest = bc->data[pos + 1];
+        decode_args(types, insn, au_fn_num_args(fn));
+        break;
+    }
+    case AU_OP_CALL_FUNC_VALUE:
+    case AU_OP_CALL_FUNC_VALUE_CATCH: {
+        au_c_value_array_add(&insn->reads, bc->data[pos + 1]);
+        insn->dest = bc->data[pos + 3];
+        decode_args(types, insn, bc->data[pos + 2]);
+        break;
+    }
+    case AU_OP_CLASS_NEW_INITIALZIED: {
+        insn->dest = bc->data[pos + 1];
+        size_t inner_pos = pos + 4;
+        while (bc->data[inner_pos] != AU_OP_NOP) {
+            au_c_value_array_add(&insn->reads, bc->data[inner_pos + 1]);
+            inner_pos += 4;
+        }
+        insn->size = inner_pos + 4 - pos;
+        break;
+    }
+    case AU_OP_MOV_REG_LOCAL: {
+        au_c_value_array_add(&insn->reads, bc->data[pos + 1]);
+        insn->dest = bcs->num_registers + read_u16(bc, pos + 2);
+        break;
+    }
+    case AU_OP_MOV_LOCAL_REG: {
+        au_c_value_array_add(&insn->reads,
+                             bcs->num_registers + read_u16(bc, pos + 2));
+        insn->dest = bc->data[pos + 1];
+        break;
+    }
+    case AU_OP_RET_LOCAL: {
+        au_c_value_array_add(&insn->reads,
+                             bcs->num_registers + read_u16(bc, pos + 2));
+        break;
+    }
+    default: {
+        const int operands = au_parser_opcode_operands(op);
+        const int dest = au_parser_opcode_dest(op);
+        const int regs[] = {OPR_REG1, OPR_REG2, OPR_REG3};
+        for (int i = 0; i < 3; i++) {
+            if ((operands & regs[i]) == 0)
+                continue;
+            if (dest == regs[i])
+                insn->dest = bc->data[pos + 1 + i];
+            else
+                au_c_value_array_add(&insn->reads, bc->data[pos + 1 + i]);
+        }
+        if ((operands & OPR_JUMP) != 0)
+            insn->target = jump_target(bc, pos / 4) * 4;
+        break;
+    }
+    }
+}
+
+static int is_numeric(uint8_t type) {
+    return type == AU_C_TYPE_INT || type == AU_C_TYPE_DOUBLE;
+}
+
+const struct au_lib_func *
+au_c_types_fast_call(const struct au_c_types *types,
+                     const struct au_c_insn *insn) {
+    if (insn->op != AU_OP_CALL)
+        return 0;
+    const struct au_fn *fn =
+        &types->p_data->fns.data[read_u16(&types->bcs->bc, insn->pos + 2)];
+    if (fn->type != AU_FN_LIB || fn->as.lib_func.fast_symbol == 0)
+        return 0;
+    const int32_t num_args =
+        au_lib_func_sig_num_args(fn->as.lib_func.fast_sig);
+    if (num_args == 0 || (size_t)num_args != insn->reads.len)
+        return 0;
+    return &fn->as.lib_func;
+}
+
+enum au_c_type au_c_types_native(const struct au_c_types *types,
+                                 const struct au_c_value_state *vals,
+                                 const struct au_c_insn *insn) {
+    const uint8_t lhs = insn->reads.len > 0
+                            ? vals[insn->reads.data[0]].type
+                            : AU_C_TYPE_UNDEF;
+    const uint8_t rhs = insn->reads.len > 1
+                            ? vals[insn->reads.data[1]].type
+                            : AU_C_TYPE_UNDEF;
+    switch (insn->op) {
+    case AU_OP_MOV_U16:
+        return AU_C_TYPE_INT;
+    case AU_OP_MOV_BOOL:
+        return AU_C_TYPE_BOOL;
+    case AU_OP_LOAD_CONST: {
+        const struct au_bc_buf *bc = &types->bcs->bc;
+        const uint16_t c = read_u16(bc, insn->pos + 2);
+        if (c >= types->p_data->data_val.len)
+            return AU_C_TYPE_UNDEF;
+        switch (au_value_get_type(
+            types->p_data->data_val.data[c].real_value)) {
+        case AU_VALUE_INT:
+            return AU_C_TYPE_INT;
+        case AU_VALUE_DOUBLE:
+            return AU_C_TYPE_DOUBLE;
+        default:
+            return AU_C_TYPE_UNDEF;
+        }
+    }
+    case AU_OP_MOV_REG_LOCAL:
+    case AU_OP_MOV_LOCAL_REG:
+        return au_c_type_is_native(lhs) ? lhs : AU_C_TYPE_UNDEF;
+    case AU_OP_ADD:
+    case AU_OP_SUB:
+    case AU_OP_MUL:
+    case AU_OP_ADD_INT:
+    case AU_OP_SUB_INT:
+    case AU_OP_MUL_INT: {
+        if (lhs == AU_C_TYPE_INT && rhs == AU_C_TYPE_INT)
+            return AU_C_TYPE_INT;
+        if (is_numeric(lhs) && is_numeric(rhs))
+            return AU_C_TYPE_DOUBLE;
+        return AU_C_TYPE_UNDEF;
+    }
+    case AU_OP_DIV: {
+        if (is_numeric(lhs) && is_numeric(rhs))
+            return AU_C_TYPE_DOUBLE;
+        return AU_C_TYPE_UNDEF;
+    }
+    case AU_OP_MOD:
+    case AU_OP_BAND:
+    case AU_OP_BOR:
+    case AU_OP_BXOR:
+    case AU_OP_BSHL:
+    case AU_OP_BSHR: {
+        if (lhs == AU_C_TYPE_INT && rhs == AU_C_TYPE_INT)
+            return AU_C_TYPE_INT;
+        return AU_C_TYPE_UNDEF;
+    }
+    case AU_OP_EQ:
+    case AU_OP_NEQ:
+    case AU_OP_EQ_INT:
+    case AU_OP_NEQ_INT: {
+        // Values of different types are never equal, and doubles are
+        // never equal to each other
+        if (lhs == rhs && (lhs == AU_C_TYPE_INT || lhs == AU_C_TYPE_BOOL))
+            return AU_C_TYPE_BOOL;
+        return AU_C_TYPE_UNDEF;
+    }
+    case AU_OP_LT:
+    case AU_OP_GT:
+    case AU_OP_LEQ:
+    case AU_OP_GEQ:
+    case AU_OP_LT_INT:
+    case AU_OP_GT_INT:
+    case AU_OP_LEQ_INT:
+    case AU_OP_GEQ_INT: {
+        if (is_numeric(lhs) && is_numeric(rhs))
+            return AU_C_TYPE_BOOL;
+        return AU_C_TYPE_UNDEF;
+    }
+    case AU_OP_NOT:
+    case AU_OP_JIF:
+    case AU_OP_JNIF:
+        return au_c_type_is_native(lhs) ? AU_C_TYPE_BOOL
+                                        : AU_C_TYPE_UNDEF;
+    case AU_OP_NEG:
+    case AU_OP_BNOT:
+        return lhs == AU_C_TYPE_INT ? AU_C_TYPE_INT : AU_C_TYPE_UNDEF;
+    case AU_OP_CALL: {
+        const struct au_lib_func *lib_func =
+            au_c_types_fast_call(types, insn);
+        if (lib_func == 0)
+            return AU_C_TYPE_UNDEF;
+        switch (lib_func->fast_sig) {
+        case AU_LIB_FUNC_SIG_D_D:
+            return lhs == AU_C_TYPE_DOUBLE ? AU_C_TYPE_DOUBLE
+                                           : AU_C_TYPE_UNDEF;
+        case AU_LIB_FUNC_SIG_D_DD:
+            return lhs == AU_C_TYPE_DOUBLE && rhs == AU_C_TYPE_DOUBLE
+                       ? AU_C_TYPE_DOUBLE
+                       : AU_C_TYPE_UNDEF;
+        case AU_LIB_FUNC_SIG_I_I:
+            return lhs == AU_C_TYPE_INT ? AU_C_TYPE_INT : AU_C_TYPE_UNDEF;
+        case AU_LIB_FUNC_SIG_I_II:
+            return lhs == AU_C_TYPE_INT && rhs == AU_C_TYPE_INT
+                       ? AU_C_TYPE_INT
+                       : AU_C_TYPE_UNDEF;
+        default:
+            return AU_C_TYPE_UNDEF;
+        }
+    }
+    default:
+        return AU_C_TYPE_UNDEF;
+    }
+}
+
+void au_c_types_transfer(const struct au_c_types *types,
+                         struct au_c_value_state *vals,
+                         const struct au_c_insn *insn,
+                         enum au_c_type native) {
+    (void)types;
+    if (native == AU_C_TYPE_UNDEF) {
+        // Operands of generic instructions are boxed before use
+        for (size_t i = 0; i < insn->reads.len; i++)
+            vals[insn->reads.data[i]].boxed = 1;
+        if (insn->dest >= 0)
+            vals[insn->dest] = (struct au_c_value_state){
+                .type = AU_C_TYPE_ANY, .boxed = 1};
+    } else if (insn->dest >= 0) {
+        vals[insn->dest] =
+            (struct au_c_value_state){.type = native, .boxed = 0};
+    }
+}
+
+int au_c_types_falls_through(const struct au_c_types *types,
+                             const struct au_c_insn *insn) {
+    switch (insn->op) {
+    case AU_OP_JREL:
+    case AU_OP_JRELB:
+    case AU_OP_RET:
+    case AU_OP_RET_LOCAL:
+    case AU_OP_RET_NULL:
+        return 0;
+    case AU_OP_TAIL_CALL: {
+        const uint16_t func_id = read_u16(&types->bcs->bc, insn->pos + 2);
+        return !au_c_types_is_self_tail_call(
+            types->p_data, types->func_idx, insn->op, func_id);
+    }
+    default:
+        return 1;
+    }
+}
+
+const struct au_c_value_state *
+au_c_types_block_state(const struct au_c_types *types, size_t pos) {
+    if (types->block_at == 0 || pos % 4 != 0 ||
+        pos / 4 >= (types->bcs->bc.len + 3) / 4)
+        return 0;
+    const int block = types->block_at[pos / 4];
+    if (block < 0)
+        return 0;
+    return &types->block_states[block * types->num_values];
+}
+
+// ** Analysis **
+
+static void entry_state(const struct au_c_types *types,
+                        struct au_c_value_state *vals) {
+    for (int i = 0; i < types->num_values; i++)
+        vals[i] = (struct au_c_value_state){.type = AU_C_TYPE_ANY,
+                                            .boxed = 1};
+    for (int i = 0; i < types->bcs->num_args; i++) {
+        if (types->int_args[i])
+            vals[types->bcs->num_registers + i].type = AU_C_TYPE_INT;
+    }
+}
+
+/// Merges the value states at the end of a basic block into the states
+/// at the start of its successor
+/// @return 1 if the successor's states have changed
+static int merge_state(const struct au_c_types *types,
+                       struct au_c_value_state *to,
+                       const struct au_c_value_state *from) {
+    int changed = 0;
+    for (int i = 0; i < types->num_values; i++) {
+        struct au_c_value_state merged = from[i];
+        if (to[i].type != AU_C_TYPE_UNDEF) {
+            if (to[i].type != merged.type)
+                merged.type = AU_C_TYPE_ANY;
+            merged.boxed = merged.boxed && to[i].boxed;
+        }
+        // Unboxed values are boxed on edges leading to a basic block
+        // expecting an au_value_t
+        if (merged.type == AU_C_TYPE_ANY)
+            merged.boxed = 1;
+        if (merged.type != to[i].type || merged.boxed != to[i].boxed) {
+            to[i] = merged;
+            changed = 1;
+        }
+    }
+    return changed;
+}
+
+/// Runs the type inference until every basic block's states are final
+/// @param native_uses if not NULL, marks arguments whose values are read
+///     by instructions operating on unboxed values
+static void infer_types(struct au_c_types *types, char *native_uses) {
+    const struct au_bc_storage *bcs = types->bcs;
+    const size_t num_slots = (bcs->bc.len + 3) / 4;
+    const int num_values = types->num_values;
+
+    memset(types->block_states, 0,
+           types->num_blocks * num_values *
+               sizeof(struct au_c_value_state));
+    memset(types->native_types, 0, num_values);
+    for (int i = 0; i < bcs->num_args; i++) {
+        if (types->int_args[i])
+            types->native_types[bcs->num_registers + i] |=
+                1 << AU_C_TYPE_INT;
+    }
+
+    struct au_c_value_state *vals = au_data_calloc(
+        num_values > 0 ? num_values : 1, sizeof(struct au_c_value_state));
+    int *origins = au_data_calloc(
+        bcs->num_registers > 0 ? bcs->num_registers : 1, sizeof(int));
+    size_t *block_pos =
+        au_data_malloc(types->num_blocks * sizeof(size_t));
+    for (size_t i = 0; i < num_slots; i++) {
+        if (types->block_at[i] >= 0)
+            block_pos[types->block_at[i]] = i * 4;
+    }
+    struct au_c_insn insn = (struct au_c_insn){0};
+
+    entry_state(types, vals);
+    merge_state(types, types->block_states, vals);
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t block = 0; block < types->num_blocks; block++) {
+            const struct au_c_value_state *start =
+                &types->block_states[block * num_values];
+            if (num_values > 0 && start[0].type == AU_C_TYPE_UNDEF)
+                continue;
+            memcpy(vals, start,
+                   num_values * sizeof(struct au_c_value_state));
+            for (int i = 0; i < bcs->num_registers; i++)
+                origins[i] = -1;
+
+            size_t pos = block_pos[block];
+            while (pos < bcs->bc.len) {
+                au_c_types_decode(types, &insn, pos);
+                const enum au_c_type native =
+                    au_c_types_native(types, vals, &insn);
+
+                if (native_uses != 0 && native != AU_C_TYPE_UNDEF &&
+                    insn.op != AU_OP_MOV_REG_LOCAL) {
+                    for (size_t i = 0; i < insn.reads.len; i++) {
+                        const int value = insn.reads.data[i];
+                        if (value < bcs->num_registers &&
+                            origins[value] >= 0 &&
+                            origins[value] < bcs->num_args)
+                            native_uses[origins[value]] = 1;
+                    }
+                }
+                if (insn.dest >= 0 && insn.dest < bcs->num_registers) {
+                    origins[insn.dest] = -1;
+                    if (insn.op == AU_OP_MOV_LOCAL_REG)
+                        origins[insn.dest] =
+                            insn.reads.data[0] - bcs->num_registers;
+                }
+
+                au_c_types_transfer(types, vals, &insn, native);
+                if (native != AU_C_TYPE_UNDEF && insn.dest >= 0)
+                    types->native_types[insn.dest] |= 1 << native;
+
+                if (insn.op == AU_OP_JIF || insn.op == AU_OP_JNIF ||
+                    insn.op == AU_OP_JREL || insn.op == AU_OP_JRELB) {
+                    const int target = types->block_at[insn.target / 4];
+                    changed |= merge_state(
+                        types, &types->block_states[target * num_values],
+                        vals);
+                }
+                if (!au_c_types_falls_through(types, &insn))
+                    break;
+                pos += insn.size;
+                if (pos / 4 < num_slots && types->block_at[pos / 4] >= 0) {
+                    const int next = types->block_at[pos / 4];
+                    changed |= merge_state(
+                        types, &types->block_states[next * num_values],
+                        vals);
+                    break;
+                }
+            }
+        }
+    }
+
+    au_data_free(vals);
+    au_data_free(origins);
+    au_data_free(block_pos);
+    au_data_free(insn.reads.data);
+}
+
+void au_c_types_analyze(struct au_c_types *types,
+                        const struct au_bc_storage *bcs,
+                        const struct au_program_data *p_data,
+                        size_t func_idx, int speculate) {
+    *types = (struct au_c_types){0};
+    types->bcs = bcs;
+    types->p_data = p_data;
+    types->func_idx = func_idx;
+    types->num_values = bcs->num_registers + bcs->num_locals;
+    types->int_args = au_data_calloc(bcs->num_args + 1, 1);
+
+    const size_t num_slots = (bcs->bc.len + 3) / 4;
+    types->block_at = au_data_malloc((num_slots + 1) * sizeof(int));
+    for (size_t i = 0; i < num_slots + 1; i++)
+        types->block_at[i] = -1;
+    types->block_at[0] = 0;
+    types->num_blocks = 1;
+
+    struct au_c_insn insn = (struct au_c_insn){0};
+    for (size_t pos = 0; pos < bcs->bc.len; pos += insn.size) {
+        au_c_types_decode(types, &insn, pos);
+        if (insn.op == AU_OP_JIF || insn.op == AU_OP_JNIF ||
+            insn.op == AU_OP_JREL || insn.op == AU_OP_JRELB) {
+            if (insn.target / 4 >= num_slots) {
+                // Malformed jump, don't infer anything
+                au_data_free(insn.reads.data);
+                au_c_types_del(types);
+                return;
+            }
+            if (types->block_at[insn.target / 4] < 0)
+                types->block_at[insn.target / 4] = 0;
+        }
+    }
+    au_data_free(insn.reads.data);
+    types->num_blocks = 0;
+    for (size_t i = 0; i < num_slots; i++) {
+        if (types->block_at[i] >= 0)
+            types->block_at[i] = types->num_blocks++;
+    }
+
+    if (types->num_blocks * (size_t)types->num_values > MAX_BLOCK_STATES) {
+        au_c_types_del(types);
+        return;
+    }
+    types->block_states =
+        au_data_calloc(types->num_blocks * types->num_values + 1,
+                       sizeof(struct au_c_value_state));
+    types->native_types = au_data_calloc(types->num_values + 1, 1);
+
+    if (!speculate || bcs->num_args == 0) {
+        infer_types(types, 0);
+        return;
+    }
+
+    // Speculate on the arguments that end up being used as integers.
+    // Arguments that aren't used by unboxed instructions are dropped,
+    // until no more arguments are dropped.
+    char *native_uses = au_data_calloc(bcs->num_args, 1);
+    for (int i = 0; i < bcs->num_args; i++)
+        types->int_args[i] = 1;
+    for (;;) {
+        memset(native_uses, 0, bcs->num_args);
+        infer_types(types, native_uses);
+        int dropped = 0;
+        for (int i = 0; i < bcs->num_args; i++) {
+            if (types->int_args[i] && !native_uses[i]) {
+                types->int_args[i] = 0;
+                dropped = 1;
+            }
+        }
+        if (!dropped)
+            break;
+    }
+    au_data_free(native_uses);
+    for (int i = 0; i < bcs->num_args; i++)
+        types->num_int_args += types->int_args[i];
+}
+
+void au_c_types_del(struct au_c_types *types) {
+    au_data_free(types->int_args);
+    au_data_free(types->block_at);
+    au_data_free(types->block_states);
+    au_data_free(types->native_types);
+    const struct au_bc_storage *bcs = types->bcs;
+    *types = (struct au_c_types){0};
+    types->bcs = bcs;
+}
@@ -0,0 +1,159 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/array.h"
+#include "core/bc.h"
+#include "platform/platform.h"
+
+struct au_program_data;
+struct au_lib_func;
+
+/// Inferred type of a register or local at some point of a function
+enum au_c_type {
+    /// The value hasn't been reached yet
+    AU_C_TYPE_UNDEF = 0,
+    /// The value is stored in an unboxed int64_t
+    AU_C_TYPE_INT,
+    /// The value is stored in an unboxed double
+    AU_C_TYPE_DOUBLE,
+    /// The value is stored in an unboxed int32_t, which is either 0 or 1
+    AU_C_TYPE_BOOL,
+    /// The value is only stored in its au_value_t
+    AU_C_TYPE_ANY,
+};
+
+struct au_c_value_state {
+    /// An au_c_type
+    uint8_t type;
+    /// Set if the au_value_t of an unboxed value is up to date
+    uint8_t boxed;
+};
+
+AU_ARRAY_COPY(int, au_c_value_array, 4)
+
+/// A decoded instruction
+struct au_c_insn {
+    uint8_t op;
+    /// Offset of the instruction
+    size_t pos;
+    /// Size of the instruction in bytes, including the trailing
+    ///     AU_OP_PUSH_ARG or AU_OP_CLASS_SET_INNER instructions
+    size_t size;
+    /// Value written by the instruction, or -1
+    int dest;
+    /// Values read by the instruction
+    struct au_c_value_array reads;
+    /// Offset the instruction jumps to, if it is a jump instruction
+    size_t target;
+};
+
+/// Result of the type inference of a function. Values are numbered
+/// with registers first, followed by locals.
+struct au_c_types {
+    const struct au_bc_storage *bcs;
+    const struct au_program_data *p_data;
+    size_t func_idx;
+    int num_values;
+    /// Arguments that are checked to be integers when the function is
+    ///     entered. The function falls back to a generic version of
+    ///     itself if an argument isn't an integer.
+    char *int_args;
+    int num_int_args;
+    /// Index of the basic block starting at each 4-byte slot, or -1
+    int *block_at;
+    size_t num_blocks;
+    /// Value states at the start of each basic block
+    struct au_c_value_state *block_states;
+    /// Bit mask of the unboxed types (1 << type) each value takes
+    uint8_t *native_types;
+};
+
+/// [func] Infers which registers and locals of a function can be kept
+///     unboxed
+/// @param types the result
+/// @param bcs the function's bytecode
+/// @param p_data program data
+/// @param func_idx index of the function, or AU_SM_FUNC_ID_MAIN
+/// @param speculate if set, integer arguments are speculated on
+AU_PRIVATE void au_c_types_analyze(struct au_c_types *types,
+                                   const struct au_bc_storage *bcs,
+                                   const struct au_program_data *p_data,
+                                   size_t func_idx, int speculate);
+
+/// [func] Deinitializes an au_c_types instance
+/// @param types instance to be deinitialized
+AU_PRIVATE void au_c_types_del(struct au_c_types *types);
+
+/// [func] Decodes the instruction at offset pos
+/// @param types the function's types
+/// @param insn the decoded instruction. Its reads array is reused
+///     between calls.
+/// @param pos offset of the instruction
+AU_PRIVATE void au_c_types_decode(const struct au_c_types *types,
+                                  struct au_c_insn *insn, size_t pos);
+
+/// [func] Returns the unboxed type that an instruction computes its
+///     result in
+/// @param types the function's types
+/// @param vals value states before the instruction
+/// @param insn the instruction
+/// @return the type of the result, AU_C_TYPE_BOOL for jumps on an
+///     unboxed condition, or AU_C_TYPE_UNDEF if the instruction operates
+///     on boxed values
+AU_PRIVATE enum au_c_type
+au_c_types_native(const struct au_c_types *types,
+                  const struct au_c_value_state *vals,
+                  const struct au_c_insn *insn);
+
+/// [func] Returns the native function that a call instruction calls,
+///     if the function has a typed fast path that compiled code can call
+/// @param types the function's types
+/// @param insn the instruction
+/// @return the native function, or NULL
+AU_PRIVATE const struct au_lib_func *
+au_c_types_fast_call(const struct au_c_types *types,
+                     const struct au_c_insn *insn);
+
+/// [func] Updates the value states after an instruction
+/// @param types the function's types
+/// @param vals value states to be updated
+/// @param insn the instruction
+/// @param native the result of au_c_types_native for the instruction
+AU_PRIVATE void au_c_types_transfer(const struct au_c_types *types,
+                                    struct au_c_value_state *vals,
+                                    const struct au_c_insn *insn,
+                                    enum au_c_type native);
+
+/// [func] Returns the value states at the start of the basic block
+///     starting at offset pos
+/// @return the value states, or NULL if no basic block starts at pos
+AU_PRIVATE const struct au_c_value_state *
+au_c_types_block_state(const struct au_c_types *types, size_t pos);
+
+/// [func] Checks if a call to func_id can be compiled into a jump back
+///     to the start of the current function
+/// @param p_data program data
+/// @param func_idx index of the current function
+/// @param opcode opcode of the call
+/// @param func_id index of the called function
+AU_PRIVATE int
+au_c_types_is_self_tail_call(const struct au_program_data *p_data,
+                             size_t func_idx, uint8_t opcode,
+                             size_t func_id);
+
+/// [func] Checks if execution continues with the next instruction
+///     after insn
+AU_PRIVATE int au_c_types_falls_through(const struct au_c_types *types,
+                                        const struct au_c_insn *insn);
+
+static inline int au_c_type_is_native(uint8_t type) {
+    return type == AU_C_TYPE_INT || type == AU_C_TYPE_DOUBLE ||
+           type == AU_C_TYPE_BOOL;
+}
@@ -7,12 +7,20 @@
 #include <string.h>
 
 #include "bc.h"
+#include "core/rt/malloc.h"
 
 void au_bc_storage_init(struct au_bc_storage *bc_storage) {
     memset(bc_storage, 0, sizeof(struct au_bc_storage));
 }
 
 void au_bc_storage_del(struct au_bc_storage *bc_storage) {
+    if (bc_storage->field_caches != 0) {
+        for (size_t i = 0; i < bc_storage->bc.len / 4; i++) {
+            if (bc_storage->field_caches[i].name != 0)
+                au_obj_deref(bc_storage->field_caches[i].name);
+        }
+        au_data_free(bc_storage->field_caches);
+    }
     au_data_free(bc_storage->bc.data);
     memset(bc_storage, 0, sizeof(struct au_bc_storage));
 }
\ No newline at end of file
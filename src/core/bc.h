@@ -23,6 +23,20 @@ extern const char *au_opcode_dbg[AU_MAX_OPCODE];
 
 AU_ARRAY_COPY(uint8_t, au_bc_buf, 4)
 
+struct au_class_interface;
+struct au_string;
+
+/// Inline cache of an instruction that accesses a class field by name
+struct au_field_cache {
+    /// Class of the last instance accessed. This pointer is not reference
+    /// counted.
+    const struct au_class_interface *interface;
+    /// Name of the last field accessed. The cache holds a reference to it.
+    struct au_string *name;
+    /// Index of the field in the instance
+    size_t field_idx;
+};
+
 struct au_bc_storage {
     /// Number of arguments the function takes
     int num_args;
@@ -39,8 +53,15 @@ struct au_bc_storage {
     /// Bytecode buffer
     struct au_bc_buf bc;
     /// At which index does the source map representation of the function
-    /// start
+    /// start. Once the program has been parsed, the entries of a function
+    /// are contiguous and sorted by bc_from.
     size_t source_map_start;
+    /// Number of source map entries of the function
+    size_t source_map_len;
+    /// Inline caches of IDX_GET_CLASS and IDX_SET_CLASS, indexed by
+    /// the offset of the instruction divided by 4. Allocated by the
+    /// virtual machine the first time a field is accessed by name.
+    struct au_field_cache *field_caches;
     size_t func_idx;
 };
 
@@ -109,7 +109,16 @@ void au_bc_dbg(const struct au_bc_storage *bcs,
         case AU_OP_BAND:
         case AU_OP_BOR:
         case AU_OP_BSHL:
-        case AU_OP_BSHR: {
+        case AU_OP_BSHR:
+        case AU_OP_MUL_INT:
+        case AU_OP_ADD_INT:
+        case AU_OP_SUB_INT:
+        case AU_OP_EQ_INT:
+        case AU_OP_NEQ_INT:
+        case AU_OP_LT_INT:
+        case AU_OP_GT_INT:
+        case AU_OP_LEQ_INT:
+        case AU_OP_GEQ_INT: {
             uint8_t lhs = bc(pos);
             uint8_t rhs = bc(pos + 1);
             uint8_t res = bc(pos + 2);
@@ -164,7 +173,8 @@ void au_bc_dbg(const struct au_bc_storage *bcs,
             break;
         }
         case AU_OP_CALL:
-        case AU_OP_CALL_CATCH: {
+        case AU_OP_CALL_CATCH:
+        case AU_OP_TAIL_CALL: {
             uint8_t retval = bc(pos);
             DEF_BC16(x, 1);
             printf(" (%d) -> r%d\n", x, retval);
@@ -209,7 +219,11 @@ void au_bc_dbg(const struct au_bc_storage *bcs,
             pos += 3;
             break;
         }
-        case AU_OP_IDX_GET: {
+        case AU_OP_IDX_GET:
+        case AU_OP_IDX_GET_ARRAY_INT:
+        case AU_OP_IDX_GET_TUPLE_INT:
+        case AU_OP_IDX_GET_DICT:
+        case AU_OP_IDX_GET_CLASS: {
             uint8_t reg = bc(pos);
             uint8_t idx = bc(pos + 1);
             uint8_t ret = bc(pos + 2);
@@ -217,7 +231,10 @@ void au_bc_dbg(const struct au_bc_storage *bcs,
             pos += 3;
             break;
         }
-        case AU_OP_IDX_SET: {
+        case AU_OP_IDX_SET:
+        case AU_OP_IDX_SET_ARRAY_INT:
+        case AU_OP_IDX_SET_DICT:
+        case AU_OP_IDX_SET_CLASS: {
             uint8_t reg = bc(pos);
             uint8_t idx = bc(pos + 1);
             uint8_t ret = bc(pos + 2);
@@ -9,6 +9,78 @@
 #include "main.h"
 #include "platform/platform.h"
 
+/// [func] Finds the native function with a typed fast path that a
+///     function refers to
+/// @param fn the function
+/// @return the native function, or NULL if fn doesn't refer to a native
+///     function or the native function has no fast path
+static inline const struct au_lib_func *
+au_fn_fast_lib_func(const struct au_fn *fn) {
+    while (fn->type == AU_FN_IMPORTER) {
+        const struct au_program_data *p_data =
+            fn->as.imported_func.p_data_cached;
+        fn = &p_data->fns.data[fn->as.imported_func.fn_idx_cached];
+    }
+    if (fn->type == AU_FN_LIB &&
+        fn->as.lib_func.fast_sig != AU_LIB_FUNC_SIG_NONE)
+        return &fn->as.lib_func;
+    return 0;
+}
+
+/// [func] Calls the typed fast path of a native function if the
+///     arguments have the types in its signature. The arguments aren't
+///     dereferenced.
+/// @param func the native function
+/// @param args the arguments
+/// @param result the return value. It is an error value if an integer
+///     result doesn't fit in a value.
+/// @return 1 if the fast path was called, 0 if func->func must be called
+///     instead
+static inline int au_lib_func_call_fast(const struct au_lib_func *func,
+                                        const au_value_t *args,
+                                        au_value_t *result) {
+    switch (func->fast_sig) {
+    case AU_LIB_FUNC_SIG_D_D: {
+        if (au_value_get_type(args[0]) != AU_VALUE_DOUBLE)
+            return 0;
+        *result = au_value_double(((double (*)(double))func->fast_func)(
+            au_value_get_double(args[0])));
+        return 1;
+    }
+    case AU_LIB_FUNC_SIG_D_DD: {
+        if (au_value_get_type(args[0]) != AU_VALUE_DOUBLE ||
+            au_value_get_type(args[1]) != AU_VALUE_DOUBLE)
+            return 0;
+        *result = au_value_double(
+            ((double (*)(double, double))func->fast_func)(
+                au_value_get_double(args[0]),
+                au_value_get_double(args[1])));
+        return 1;
+    }
+    case AU_LIB_FUNC_SIG_I_I: {
+        if (au_value_get_type(args[0]) != AU_VALUE_INT)
+            return 0;
+        const int64_t n = ((int64_t(*)(int64_t))func->fast_func)(
+            au_value_get_int(args[0]));
+        *result =
+            au_platform_ifits(n) ? au_value_int(n) : au_value_error();
+        return 1;
+    }
+    case AU_LIB_FUNC_SIG_I_II: {
+        if (au_value_get_type(args[0]) != AU_VALUE_INT ||
+            au_value_get_type(args[1]) != AU_VALUE_INT)
+            return 0;
+        const int64_t n = ((int64_t(*)(int64_t, int64_t))func->fast_func)(
+            au_value_get_int(args[0]), au_value_get_int(args[1]));
+        *result =
+            au_platform_ifits(n) ? au_value_int(n) : au_value_error();
+        return 1;
+    }
+    default:
+        return 0;
+    }
+}
+
 /// [func] Calls another aument function. If the called function
 ///     lies in another module, it will recursively search
 ///     for the real module that holds the function.
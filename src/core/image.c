@@ -0,0 +1,916 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/bc.h"
+#include "core/fn.h"
+#include "core/hash.h"
+#include "core/parser/impl/bc_pass.h"
+#include "core/program.h"
+#include "core/rt/au_class.h"
+#include "core/rt/malloc.h"
+#include "platform/fastdiv.h"
+#include "stdlib/au_stdlib.h"
+#include "version.h"
+
+#include "image.h"
+
+// An image starts with a header, followed by the main program, the
+// number of modules and each module's path, import paths and program.
+// Arrays are stored as their length followed by their elements, and
+// structs without pointers are stored as they are laid out in memory.
+//
+// Images are checked against a checksum before they are read, and every
+// index stored in them is range-checked once their programs are read.
+
+#define IMAGE_MAGIC "AUIMAGE"
+#define IMAGE_FORMAT_VERSION 3
+#define NULL_STR_LEN ((size_t)-1)
+
+struct image_header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t size_size;
+    uint64_t version;
+    /// Sizes of the structs that are stored as they are laid out
+    uint32_t layout[5];
+    /// Hash of the opcode names, in the order of their numbering
+    uint32_t opcodes;
+    /// Checksum of everything after the header
+    uint32_t checksum;
+    uint32_t _reserved;
+};
+
+static uint32_t opcodes_hash() {
+    uint32_t hash = 0;
+    for (size_t i = 0; i < AU_MAX_OPCODE && au_opcode_dbg[i] != 0; i++) {
+        const char *name = au_opcode_dbg[i];
+        hash = au_hash_u32(hash ^
+                           au_hash((const uint8_t *)name, strlen(name)));
+    }
+    return hash;
+}
+
+/// Returns the header of images written by this build, with an empty
+/// checksum
+static struct image_header current_header() {
+    struct image_header header = {0};
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.format_version = IMAGE_FORMAT_VERSION;
+    header.size_size = sizeof(size_t);
+    header.version = AU_VERSION_NUMERIC;
+    header.layout[0] = sizeof(au_value_t);
+    header.layout[1] = sizeof(struct au_program_data_val);
+    header.layout[2] = sizeof(struct au_program_source_map);
+    header.layout[3] = sizeof(struct au_hm_var_el_bucket);
+    header.layout[4] = sizeof(struct au_hm_vars);
+    header.opcodes = opcodes_hash();
+    return header;
+}
+
+int au_image_is_image(const char *bytes, size_t len) {
+    return len >= sizeof(IMAGE_MAGIC) &&
+           memcmp(bytes, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0;
+}
+
+// ** Writer **
+
+struct image_writer {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+};
+
+static void write_bytes(struct image_writer *w, const void *bytes,
+                        size_t len) {
+    if (len == 0)
+        return;
+    if (w->len + len > w->cap) {
+        size_t cap = w->cap == 0 ? 4096 : w->cap * 2;
+        while (cap < w->len + len)
+            cap *= 2;
+        w->data = au_data_realloc(w->data, cap);
+        w->cap = cap;
+    }
+    memcpy(&w->data[w->len], bytes, len);
+    w->len += len;
+}
+
+static void write_size(struct image_writer *w, size_t size) {
+    write_bytes(w, &size, sizeof(size));
+}
+
+static void write_str(struct image_writer *w, const char *str,
+                      size_t len) {
+    write_size(w, len);
+    write_bytes(w, str, len);
+}
+
+static void write_nullable_str(struct image_writer *w, const char *str) {
+    if (str == 0)
+        write_size(w, NULL_STR_LEN);
+    else
+        write_str(w, str, strlen(str));
+}
+
+static void write_hm_vars(struct image_writer *w,
+                          const struct au_hm_vars *hm) {
+    write_size(w, hm->initialized != 0);
+    if (!hm->initialized)
+        return;
+    write_bytes(w, hm, sizeof(struct au_hm_vars));
+    write_bytes(w, hm->buckets,
+                hm->size * sizeof(struct au_hm_var_el_bucket));
+    write_bytes(w, hm->key_bytes, hm->key_bytes_len);
+}
+
+static void write_bc_storage(struct image_writer *w,
+                             const struct au_bc_storage *bcs) {
+    const int32_t counts[4] = {bcs->num_args, bcs->num_registers,
+                               bcs->num_locals, bcs->num_values};
+    write_bytes(w, counts, sizeof(counts));
+    write_size(w, bcs->class_idx);
+    write_size(w, bcs->class_interface_cache != 0);
+    write_str(w, (const char *)bcs->bc.data, bcs->bc.len);
+    write_size(w, bcs->source_map_start);
+    write_size(w, bcs->source_map_len);
+    write_size(w, bcs->func_idx);
+}
+
+static void write_fn(struct image_writer *w, const struct au_fn *fn) {
+    write_size(w, fn->type);
+    write_size(w, fn->flags);
+    switch (fn->type) {
+    case AU_FN_BC: {
+        write_bc_storage(w, &fn->as.bc_func);
+        break;
+    }
+    case AU_FN_IMPORTER: {
+        const struct au_imported_func *func = &fn->as.imported_func;
+        write_size(w, (size_t)func->num_args);
+        write_size(w, (size_t)func->module_idx);
+        write_str(w, func->name, func->name_len);
+        break;
+    }
+    case AU_FN_DISPATCH: {
+        const struct au_dispatch_func *func = &fn->as.dispatch_func;
+        write_size(w, (size_t)func->num_args);
+        write_size(w, func->fallback_fn);
+        write_size(w, func->data.len);
+        for (size_t i = 0; i < func->data.len; i++) {
+            const struct au_dispatch_func_instance *instance =
+                &func->data.data[i];
+            write_size(w, instance->function_idx);
+            write_size(w, instance->class_idx);
+            write_size(w, instance->class_interface_cache != 0);
+        }
+        break;
+    }
+    default: {
+        // Native functions only exist in loaded libraries, and
+        // unresolved functions in programs that failed to parse
+        w->failed = 1;
+        break;
+    }
+    }
+}
+
+static void write_program_data(struct image_writer *w,
+                               const struct au_program_data *p_data) {
+    write_size(w, p_data->fns.len);
+    for (size_t i = 0; i < p_data->fns.len; i++)
+        write_fn(w, &p_data->fns.data[i]);
+    write_hm_vars(w, &p_data->fn_map);
+
+    write_size(w, p_data->data_val.len);
+    write_bytes(w, p_data->data_val.data,
+                p_data->data_val.len * sizeof(struct au_program_data_val));
+    write_str(w, (const char *)p_data->data_buf, p_data->data_buf_len);
+
+    write_size(w, p_data->imports.len);
+    for (size_t i = 0; i < p_data->imports.len; i++) {
+        write_nullable_str(w, p_data->imports.data[i].path);
+        write_size(w, p_data->imports.data[i].module_idx);
+    }
+    write_hm_vars(w, &p_data->imported_module_map);
+    write_size(w, p_data->imported_modules.len);
+    for (size_t i = 0; i < p_data->imported_modules.len; i++) {
+        const struct au_imported_module *module =
+            &p_data->imported_modules.data[i];
+        write_hm_vars(w, &module->fn_map);
+        write_hm_vars(w, &module->class_map);
+        write_hm_vars(w, &module->const_map);
+        write_size(w, module->stdlib_module_idx);
+    }
+
+    write_nullable_str(w, p_data->file);
+    write_nullable_str(w, p_data->cwd);
+
+    write_size(w, p_data->source_map.len);
+    write_bytes(w, p_data->source_map.data,
+                p_data->source_map.len *
+                    sizeof(struct au_program_source_map));
+
+    write_size(w, p_data->fn_names.len);
+    for (size_t i = 0; i < p_data->fn_names.len; i++)
+        write_nullable_str(w, p_data->fn_names.data[i]);
+
+    write_size(w, p_data->classes.len);
+    for (size_t i = 0; i < p_data->classes.len; i++) {
+        const struct au_class_interface *interface =
+            p_data->classes.data[i];
+        write_size(w, interface != 0);
+        if (interface == 0)
+            continue;
+        write_nullable_str(w, interface->name);
+        write_size(w, interface->flags);
+        write_hm_vars(w, &interface->map);
+    }
+    write_hm_vars(w, &p_data->class_map);
+    write_hm_vars(w, &p_data->exported_consts);
+}
+
+static void write_program(struct image_writer *w,
+                          const struct au_program *program) {
+    write_bc_storage(w, &program->main);
+    write_program_data(w, &program->data);
+}
+
+int au_image_write(const char *path, const struct au_program *program,
+                   const struct au_image_module_array *modules) {
+    struct image_writer w = {0};
+    struct image_header header = current_header();
+    write_bytes(&w, &header, sizeof(header));
+    write_program(&w, program);
+    write_size(&w, modules->len);
+    for (size_t i = 0; i < modules->len; i++) {
+        const struct au_image_module *module = &modules->data[i];
+        write_nullable_str(&w, module->abspath);
+        write_size(&w, module->import_paths.len);
+        for (size_t j = 0; j < module->import_paths.len; j++)
+            write_nullable_str(&w, module->import_paths.data[j]);
+        write_program(&w, module->program);
+    }
+    header.checksum = au_hash((const uint8_t *)&w.data[sizeof(header)],
+                              w.len - sizeof(header));
+    memcpy(w.data, &header, sizeof(header));
+
+    int success = !w.failed;
+    if (success) {
+        FILE *f = fopen(path, "wb");
+        if (f == 0) {
+            success = 0;
+        } else {
+            success = fwrite(w.data, 1, w.len, f) == w.len;
+            if (fclose(f) != 0)
+                success = 0;
+        }
+    }
+    au_data_free(w.data);
+    return success;
+}
+
+// ** Reader **
+
+struct image_reader {
+    const char *data;
+    size_t len;
+    size_t pos;
+    int failed;
+};
+
+static const char *read_bytes(struct image_reader *r, size_t len) {
+    if (r->failed || len > r->len - r->pos) {
+        r->failed = 1;
+        return 0;
+    }
+    const char *bytes = &r->data[r->pos];
+    r->pos += len;
+    return bytes;
+}
+
+static size_t read_size(struct image_reader *r) {
+    size_t size = 0;
+    const char *bytes = read_bytes(r, sizeof(size));
+    if (bytes != 0)
+        memcpy(&size, bytes, sizeof(size));
+    return size;
+}
+
+/// Reads an array of count elements into a newly allocated buffer
+/// @return the buffer, or NULL if count is 0 or the image is malformed
+static void *read_array(struct image_reader *r, size_t count,
+                        size_t el_size) {
+    if (count == 0)
+        return 0;
+    if (count > (r->len - r->pos) / el_size) {
+        r->failed = 1;
+        return 0;
+    }
+    const char *bytes = read_bytes(r, count * el_size);
+    if (bytes == 0)
+        return 0;
+    void *array = au_data_malloc(count * el_size);
+    memcpy(array, bytes, count * el_size);
+    return array;
+}
+
+/// Reads a null-terminated string
+/// @param len_out if not NULL, stores the length of the string
+static char *read_str(struct image_reader *r, size_t *len_out) {
+    const size_t len = read_size(r);
+    if (len == NULL_STR_LEN || r->failed)
+        return 0;
+    const char *bytes = read_bytes(r, len);
+    if (bytes == 0)
+        return 0;
+    char *str = au_data_malloc(len + 1);
+    memcpy(str, bytes, len);
+    str[len] = 0;
+    if (len_out != 0)
+        *len_out = len;
+    return str;
+}
+
+static void read_hm_vars(struct image_reader *r, struct au_hm_vars *hm) {
+    memset(hm, 0, sizeof(struct au_hm_vars));
+    if (!read_size(r))
+        return;
+    const char *bytes = read_bytes(r, sizeof(struct au_hm_vars));
+    if (bytes == 0)
+        return;
+    struct au_hm_vars stored;
+    memcpy(&stored, bytes, sizeof(struct au_hm_vars));
+    if (stored.size == 0 || stored.size > UINT32_MAX ||
+        stored.nitems > stored.size) {
+        r->failed = 1;
+        return;
+    }
+    struct au_hm_var_el_bucket *buckets =
+        read_array(r, stored.size, sizeof(struct au_hm_var_el_bucket));
+    char *key_bytes = read_array(r, stored.key_bytes_len, 1);
+    if (r->failed) {
+        au_data_free(buckets);
+        au_data_free(key_bytes);
+        return;
+    }
+    size_t nitems = 0;
+    for (size_t i = 0; i < stored.size; i++) {
+        if (buckets[i].key_len == 0)
+            continue;
+        nitems++;
+        if (buckets[i].key_idx > stored.key_bytes_len ||
+            buckets[i].key_len >
+                stored.key_bytes_len - buckets[i].key_idx) {
+            r->failed = 1;
+            break;
+        }
+    }
+    if (r->failed || nitems != stored.nitems) {
+        r->failed = 1;
+        au_data_free(buckets);
+        au_data_free(key_bytes);
+        return;
+    }
+    *hm = stored;
+    hm->divinfo = fast_div32_init((uint32_t)stored.size);
+    hm->buckets = buckets;
+    hm->key_bytes = key_bytes;
+}
+
+/// Placeholder for class_interface_cache pointers that are filled in
+/// once the program's classes are read
+static struct au_class_interface pending_class;
+
+static void read_bc_storage(struct image_reader *r,
+                            struct au_bc_storage *bcs) {
+    au_bc_storage_init(bcs);
+    int32_t counts[4] = {0};
+    const char *bytes = read_bytes(r, sizeof(counts));
+    if (bytes != 0)
+        memcpy(counts, bytes, sizeof(counts));
+    bcs->num_args = counts[0];
+    bcs->num_registers = counts[1];
+    bcs->num_locals = counts[2];
+    bcs->num_values = counts[3];
+    bcs->class_idx = read_size(r);
+    if (read_size(r))
+        bcs->class_interface_cache = &pending_class;
+    const size_t bc_len = read_size(r);
+    bcs->bc.data = read_array(r, bc_len, 1);
+    if (bcs->bc.data != 0) {
+        bcs->bc.len = bc_len;
+        bcs->bc.cap = bc_len;
+    }
+    bcs->source_map_start = read_size(r);
+    bcs->source_map_len = read_size(r);
+    bcs->func_idx = read_size(r);
+}
+
+static void read_fn(struct image_reader *r, struct au_fn *fn) {
+    memset(fn, 0, sizeof(struct au_fn));
+    const size_t type = read_size(r);
+    fn->flags = (uint32_t)read_size(r);
+    switch (type) {
+    case AU_FN_BC: {
+        fn->type = AU_FN_BC;
+        read_bc_storage(r, &fn->as.bc_func);
+        break;
+    }
+    case AU_FN_IMPORTER: {
+        fn->type = AU_FN_IMPORTER;
+        struct au_imported_func *func = &fn->as.imported_func;
+        func->num_args = (int32_t)read_size(r);
+        func->module_idx = (int32_t)read_size(r);
+        func->name = read_str(r, &func->name_len);
+        break;
+    }
+    case AU_FN_DISPATCH: {
+        fn->type = AU_FN_DISPATCH;
+        struct au_dispatch_func *func = &fn->as.dispatch_func;
+        func->num_args = (int32_t)read_size(r);
+        func->fallback_fn = read_size(r);
+        const size_t len = read_size(r);
+        for (size_t i = 0; i < len && !r->failed; i++) {
+            struct au_dispatch_func_instance instance = {0};
+            instance.function_idx = read_size(r);
+            instance.class_idx = read_size(r);
+            if (read_size(r))
+                instance.class_interface_cache = &pending_class;
+            au_dispatch_func_instance_array_add(&func->data, instance);
+        }
+        break;
+    }
+    default: {
+        r->failed = 1;
+        break;
+    }
+    }
+}
+
+/// Replaces a pending_class placeholder with the program's class
+static int fill_class_cache(struct au_class_interface **cache,
+                            size_t class_idx,
+                            const struct au_program_data *p_data) {
+    if (*cache != &pending_class)
+        return 1;
+    if (class_idx >= p_data->classes.len)
+        return 0;
+    *cache = p_data->classes.data[class_idx];
+    return 1;
+}
+
+static int fill_class_caches(struct au_bc_storage *main,
+                             struct au_program_data *p_data) {
+    if (!fill_class_cache(&main->class_interface_cache, main->class_idx,
+                          p_data))
+        return 0;
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type == AU_FN_BC) {
+            if (!fill_class_cache(&fn->as.bc_func.class_interface_cache,
+                                  fn->as.bc_func.class_idx, p_data))
+                return 0;
+        } else if (fn->type == AU_FN_DISPATCH) {
+            for (size_t j = 0; j < fn->as.dispatch_func.data.len; j++) {
+                struct au_dispatch_func_instance *instance =
+                    &fn->as.dispatch_func.data.data[j];
+                if (!fill_class_cache(&instance->class_interface_cache,
+                                      instance->class_idx, p_data))
+                    return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void read_program_data(struct image_reader *r,
+                              struct au_program_data *p_data) {
+    memset(p_data, 0, sizeof(struct au_program_data));
+
+    const size_t num_fns = read_size(r);
+    for (size_t i = 0; i < num_fns && !r->failed; i++) {
+        struct au_fn fn;
+        read_fn(r, &fn);
+        au_fn_array_add(&p_data->fns, fn);
+    }
+    read_hm_vars(r, &p_data->fn_map);
+
+    const size_t num_data_vals = read_size(r);
+    p_data->data_val.data = read_array(
+        r, num_data_vals, sizeof(struct au_program_data_val));
+    if (p_data->data_val.data != 0) {
+        p_data->data_val.len = num_data_vals;
+        p_data->data_val.cap = num_data_vals;
+    }
+    const size_t data_buf_len = read_size(r);
+    p_data->data_buf = read_array(r, data_buf_len, 1);
+    if (p_data->data_buf != 0)
+        p_data->data_buf_len = data_buf_len;
+
+    const size_t num_imports = read_size(r);
+    for (size_t i = 0; i < num_imports && !r->failed; i++) {
+        struct au_program_import import = {0};
+        import.path = read_str(r, 0);
+        import.module_idx = read_size(r);
+        au_program_import_array_add(&p_data->imports, import);
+    }
+    read_hm_vars(r, &p_data->imported_module_map);
+    const size_t num_imported_modules = read_size(r);
+    for (size_t i = 0; i < num_imported_modules && !r->failed; i++) {
+        struct au_imported_module module;
+        read_hm_vars(r, &module.fn_map);
+        read_hm_vars(r, &module.class_map);
+        read_hm_vars(r, &module.const_map);
+        module.stdlib_module_idx = read_size(r);
+        au_imported_module_array_add(&p_data->imported_modules, module);
+    }
+
+    p_data->file = read_str(r, 0);
+    p_data->cwd = read_str(r, 0);
+
+    const size_t num_source_map = read_size(r);
+    p_data->source_map.data = read_array(
+        r, num_source_map, sizeof(struct au_program_source_map));
+    if (p_data->source_map.data != 0) {
+        p_data->source_map.len = num_source_map;
+        p_data->source_map.cap = num_source_map;
+    }
+
+    const size_t num_fn_names = read_size(r);
+    for (size_t i = 0; i < num_fn_names && !r->failed; i++)
+        au_str_array_add(&p_data->fn_names, read_str(r, 0));
+
+    const size_t num_classes = read_size(r);
+    for (size_t i = 0; i < num_classes && !r->failed; i++) {
+        struct au_class_interface *interface = 0;
+        if (read_size(r)) {
+            interface = au_data_malloc(sizeof(struct au_class_interface));
+            au_class_interface_init(interface, read_str(r, 0));
+            interface->flags = (uint32_t)read_size(r);
+            au_hm_vars_del(&interface->map);
+            read_hm_vars(r, &interface->map);
+        }
+        au_class_interface_ptr_array_add(&p_data->classes, interface);
+    }
+    read_hm_vars(r, &p_data->class_map);
+    read_hm_vars(r, &p_data->exported_consts);
+}
+
+// ** Validation **
+
+/// Checks that every value stored in a map is an index below limit
+static int check_hm_values(const struct au_hm_vars *hm, size_t limit) {
+    AU_HM_VARS_FOREACH_PAIR(hm, key, entry, {
+        (void)key;
+        (void)key_len;
+        if (entry >= limit)
+            return 0;
+    })
+    return 1;
+}
+
+/// Checks that a field index is in bounds for a class. Imported classes
+/// are only known once their module is linked, so their fields aren't
+/// checked.
+static int check_field(const struct au_class_interface *interface,
+                       uint16_t field_idx) {
+    return interface == 0 || field_idx < interface->map.nitems;
+}
+
+/// Checks that a call instruction at pos is followed by the
+/// AU_OP_PUSH_ARG instructions for num_args arguments
+static int check_call_args(const struct au_bc_buf *bc, size_t pos,
+                           int32_t num_args) {
+    if (num_args < 0)
+        return 0;
+    const size_t num_slots = 1 + ((size_t)num_args + 2) / 3;
+    return num_slots <= (bc->len - pos) / 4;
+}
+
+static int check_bc_storage(const struct au_bc_storage *bcs,
+                            const struct au_program_data *p_data) {
+    if (bcs->num_args < 0 || bcs->num_registers < 0 ||
+        bcs->num_locals < 0 || bcs->num_registers > AU_REGS ||
+        bcs->num_locals > AU_MAX_LOCALS ||
+        bcs->num_args > bcs->num_locals ||
+        bcs->num_values != bcs->num_registers + bcs->num_locals)
+        return 0;
+    if (bcs->source_map_start > p_data->source_map.len ||
+        bcs->source_map_len >
+            p_data->source_map.len - bcs->source_map_start)
+        return 0;
+
+    // The bytecode ends with an AU_OP_RET_NULL, which is the only
+    // instruction that doesn't need to be padded
+    const struct au_bc_buf *bc = &bcs->bc;
+    if (bc->len == 0 || bc->data[(bc->len - 1) / 4 * 4] != AU_OP_RET_NULL)
+        return 0;
+    const size_t num_slots = (bc->len + 3) / 4;
+    for (size_t pos = 0; pos + 4 <= bc->len; pos += 4) {
+        const uint8_t op = bc->data[pos];
+        const int operands = au_parser_opcode_operands(op);
+        for (int i = 0; i < 3; i++) {
+            if ((operands & (OPR_REG1 << i)) != 0 &&
+                bc->data[pos + 1 + i] >= bcs->num_registers)
+                return 0;
+        }
+        const uint16_t u16 = read_u16(bc, pos + 2);
+        switch (op) {
+        case AU_OP_LOAD_SELF: {
+            if (bcs->class_idx >= p_data->classes.len ||
+                bcs->num_args == 0)
+                return 0;
+            break;
+        }
+        case AU_OP_CALL:
+        case AU_OP_CALL_CATCH:
+        case AU_OP_TAIL_CALL: {
+            if (u16 >= p_data->fns.len ||
+                !check_call_args(bc, pos,
+                                 au_fn_num_args(&p_data->fns.data[u16])))
+                return 0;
+            break;
+        }
+        case AU_OP_LOAD_FUNC: {
+            if (u16 >= p_data->fns.len)
+                return 0;
+            break;
+        }
+        case AU_OP_CALL_FUNC_VALUE:
+        case AU_OP_CALL_FUNC_VALUE_CATCH: {
+            if (!check_call_args(bc, pos, bc->data[pos + 2]))
+                return 0;
+            break;
+        }
+        case AU_OP_LOAD_CONST:
+        case AU_OP_SET_CONST: {
+            if (u16 >= p_data->data_val.len)
+                return 0;
+            break;
+        }
+        case AU_OP_CLASS_NEW: {
+            if (u16 >= p_data->classes.len)
+                return 0;
+            break;
+        }
+        case AU_OP_CLASS_NEW_INITIALZIED: {
+            if (u16 >= p_data->classes.len)
+                return 0;
+            // The fields are set by the following instructions, up to
+            // an AU_OP_NOP
+            const struct au_class_interface *interface =
+                p_data->classes.data[u16];
+            for (pos += 4; pos + 4 <= bc->len; pos += 4) {
+                if (bc->data[pos] == AU_OP_NOP)
+                    break;
+                if (bc->data[pos] != AU_OP_CLASS_SET_INNER ||
+                    bc->data[pos + 1] >= bcs->num_registers ||
+                    !check_field(interface, read_u16(bc, pos + 2)))
+                    return 0;
+            }
+            if (pos + 4 > bc->len)
+                return 0;
+            break;
+        }
+        case AU_OP_CLASS_GET_INNER:
+        case AU_OP_CLASS_SET_INNER: {
+            if (!check_field(bcs->class_interface_cache, u16))
+                return 0;
+            break;
+        }
+        case AU_OP_IMPORT: {
+            if (u16 >= p_data->imports.len)
+                return 0;
+            break;
+        }
+        case AU_OP_MOV_REG_LOCAL:
+        case AU_OP_MOV_LOCAL_REG:
+        case AU_OP_RET_LOCAL: {
+            if (u16 >= bcs->num_locals)
+                return 0;
+            break;
+        }
+        case AU_OP_JIF:
+        case AU_OP_JNIF:
+        case AU_OP_JIF_BOOL:
+        case AU_OP_JNIF_BOOL:
+        case AU_OP_JREL: {
+            if (u16 >= num_slots - pos / 4)
+                return 0;
+            break;
+        }
+        case AU_OP_JRELB: {
+            if (u16 > pos / 4)
+                return 0;
+            break;
+        }
+        case AU_OP_IDX_GET_ARRAY_INT:
+        case AU_OP_IDX_GET_TUPLE_INT:
+        case AU_OP_IDX_GET_DICT:
+        case AU_OP_IDX_SET_ARRAY_INT:
+        case AU_OP_IDX_SET_DICT:
+        case AU_OP_IDX_GET_CLASS:
+        case AU_OP_IDX_SET_CLASS: {
+            // Only written by the interpreter while it runs a program
+            return 0;
+        }
+        default: {
+            if (au_opcode_dbg[op] == 0)
+                return 0;
+            break;
+        }
+        }
+    }
+    return 1;
+}
+
+static int check_program(const struct au_program *program) {
+    const struct au_program_data *p_data = &program->data;
+    const size_t num_fns = p_data->fns.len;
+    const size_t num_classes = p_data->classes.len;
+    const size_t num_consts = p_data->data_val.len;
+    const size_t num_modules = p_data->imported_modules.len;
+
+    if (!check_bc_storage(&program->main, p_data))
+        return 0;
+    for (size_t i = 0; i < num_fns; i++) {
+        const struct au_fn *fn = &p_data->fns.data[i];
+        switch (fn->type) {
+        case AU_FN_BC: {
+            if (!check_bc_storage(&fn->as.bc_func, p_data))
+                return 0;
+            break;
+        }
+        case AU_FN_IMPORTER: {
+            if (fn->as.imported_func.num_args < 0 ||
+                fn->as.imported_func.module_idx < 0 ||
+                (size_t)fn->as.imported_func.module_idx >= num_modules)
+                return 0;
+            break;
+        }
+        case AU_FN_DISPATCH: {
+            const struct au_dispatch_func *func = &fn->as.dispatch_func;
+            if (func->fallback_fn != AU_DISPATCH_FUNC_NO_FALLBACK &&
+                func->fallback_fn >= num_fns)
+                return 0;
+            for (size_t j = 0; j < func->data.len; j++) {
+                if (func->data.data[j].function_idx >= num_fns)
+                    return 0;
+            }
+            break;
+        }
+        default:
+            return 0;
+        }
+    }
+    if (!check_hm_values(&p_data->fn_map, num_fns))
+        return 0;
+
+    for (size_t i = 0; i < num_consts; i++) {
+        const struct au_program_data_val *val = &p_data->data_val.data[i];
+        switch (au_value_get_type(val->real_value)) {
+        case AU_VALUE_STR: {
+            if (val->buf_idx > p_data->data_buf_len ||
+                val->buf_len > p_data->data_buf_len - val->buf_idx)
+                return 0;
+            break;
+        }
+        case AU_VALUE_NONE:
+        case AU_VALUE_INT:
+        case AU_VALUE_DOUBLE:
+        case AU_VALUE_BOOL:
+            break;
+        default:
+            return 0;
+        }
+    }
+
+    for (size_t i = 0; i < p_data->imports.len; i++) {
+        const struct au_program_import *import = &p_data->imports.data[i];
+        if (import->path == 0 ||
+            (import->module_idx != AU_PROGRAM_IMPORT_NO_MODULE &&
+             import->module_idx >= num_modules))
+            return 0;
+    }
+    if (!check_hm_values(&p_data->imported_module_map, num_modules))
+        return 0;
+    for (size_t i = 0; i < num_modules; i++) {
+        const struct au_imported_module *module =
+            &p_data->imported_modules.data[i];
+        if (module->stdlib_module_idx != AU_IMPORTED_MODULE_NOT_STDLIB &&
+            module->stdlib_module_idx >= au_stdlib_modules_len)
+            return 0;
+        if (!check_hm_values(&module->fn_map, num_fns) ||
+            !check_hm_values(&module->class_map, num_classes) ||
+            !check_hm_values(&module->const_map, num_consts))
+            return 0;
+        AU_HM_VARS_FOREACH_PAIR(&module->fn_map, key, entry, {
+            (void)key;
+            (void)key_len;
+            if (p_data->fns.data[entry].type != AU_FN_IMPORTER)
+                return 0;
+        })
+        AU_HM_VARS_FOREACH_PAIR(&module->class_map, key, entry, {
+            (void)key;
+            (void)key_len;
+            if (p_data->classes.data[entry] != 0)
+                return 0;
+        })
+    }
+
+    for (size_t i = 0; i < p_data->source_map.len; i++) {
+        const size_t parent = p_data->source_map.data[i].parent;
+        if (parent != AU_SM_NO_PARENT && parent >= i)
+            return 0;
+    }
+
+    for (size_t i = 0; i < num_classes; i++) {
+        const struct au_class_interface *interface =
+            p_data->classes.data[i];
+        if (interface != 0 &&
+            !check_hm_values(&interface->map, interface->map.nitems))
+            return 0;
+    }
+    return check_hm_values(&p_data->class_map, num_classes) &&
+           check_hm_values(&p_data->exported_consts, num_consts);
+}
+
+static void read_program(struct image_reader *r,
+                         struct au_program *program) {
+    read_bc_storage(r, &program->main);
+    read_program_data(r, &program->data);
+    if (!r->failed &&
+        (!fill_class_caches(&program->main, &program->data) ||
+         !check_program(program)))
+        r->failed = 1;
+}
+
+int au_image_read(const char *bytes, size_t len,
+                  struct au_program *program,
+                  struct au_image_module_array *modules) {
+    struct image_reader r = {
+        .data = bytes,
+        .len = len,
+        .pos = 0,
+        .failed = 0,
+    };
+
+    const struct image_header expected = current_header();
+    const char *header_bytes = read_bytes(&r, sizeof(struct image_header));
+    if (header_bytes == 0)
+        return 0;
+    struct image_header header;
+    memcpy(&header, header_bytes, sizeof(struct image_header));
+    const uint32_t checksum = header.checksum;
+    header.checksum = 0;
+    if (memcmp(&header, &expected, sizeof(struct image_header)) != 0 ||
+        au_hash((const uint8_t *)&bytes[r.pos], len - r.pos) != checksum)
+        return 0;
+
+    read_program(&r, program);
+    if (r.failed) {
+        au_program_del(program);
+        return 0;
+    }
+
+    const size_t old_len = modules->len;
+    const size_t num_modules = read_size(&r);
+    for (size_t i = 0; i < num_modules && !r.failed; i++) {
+        struct au_image_module module = {0};
+        module.abspath = read_str(&r, 0);
+        const size_t num_import_paths = read_size(&r);
+        for (size_t j = 0; j < num_import_paths && !r.failed; j++) {
+            char *import_path = read_str(&r, 0);
+            if (import_path == 0)
+                r.failed = 1;
+            else
+                au_str_array_add(&module.import_paths, import_path);
+        }
+        if (module.abspath == 0)
+            r.failed = 1;
+        module.program = au_data_malloc(sizeof(struct au_program));
+        read_program(&r, module.program);
+        au_image_module_array_add(modules, module);
+    }
+    if (!r.failed && r.pos == r.len)
+        return 1;
+
+    for (size_t i = old_len; i < modules->len; i++) {
+        au_data_free(modules->data[i].abspath);
+        for (size_t j = 0; j < modules->data[i].import_paths.len; j++)
+            au_data_free(modules->data[i].import_paths.data[j]);
+        au_data_free(modules->data[i].import_paths.data);
+        au_program_del(modules->data[i].program);
+        au_data_free(modules->data[i].program);
+    }
+    modules->len = old_len;
+    au_program_del(program);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#pragma once
+
+#include <stddef.h>
+
+#include "core/array.h"
+#include "core/str_array.h"
+#include "platform/platform.h"
+
+struct au_program;
+
+/// A parsed module stored in a program image
+struct au_image_module {
+    /// Absolute path of the module
+    char *abspath;
+    /// Paths the module is imported with, resolved by
+    ///     au_module_resolve_lexical. Running the image looks modules
+    ///     up by these paths instead of resolving imports on the file
+    ///     system.
+    struct au_str_array import_paths;
+    struct au_program *program;
+};
+
+AU_ARRAY_COPY(struct au_image_module, au_image_module_array, 1)
+
+/// [func] Checks if a file is a program image written by au_image_write
+/// @param bytes contents of the file
+/// @param len size of the file
+AU_PRIVATE int au_image_is_image(const char *bytes, size_t len);
+
+/// [func] Writes a parsed program and the parsed modules it imports into
+///     an image file. Images contain no pointers, and can only be read
+///     by builds of aument with the same version and data layout.
+/// @param path path of the image file
+/// @param program the program. Its file and cwd are stored in the image.
+/// @param modules the modules
+/// @return 1 if successful, 0 if the file couldn't be written or the
+///     program has functions that can't be stored
+AU_PRIVATE int au_image_write(const char *path,
+                              const struct au_program *program,
+                              const struct au_image_module_array *modules);
+
+/// [func] Restores a program and its modules from an image
+/// @param bytes contents of the image file
+/// @param len size of the image file
+/// @param program the restored program
+/// @param modules array the restored modules are added to. The caller
+///     owns the added paths and programs.
+/// @return 1 if successful, 0 if the image is malformed or was written
+///     by an incompatible build
+AU_PRIVATE int au_image_read(const char *bytes, size_t len,
+                             struct au_program *program,
+                             struct au_image_module_array *modules);
@@ -23,6 +23,10 @@ static const char *error_path(const char *path) {
 
 static void print_source(struct au_error_location loc, size_t error_pos,
                          size_t error_len) {
+    // The source is missing or has changed since it was parsed, as
+    // happens when running images
+    if (loc.src == 0 || error_pos > loc.len)
+        return;
     int lines = 1, cols = 0;
     size_t line_begin = 0, line_end = 0;
     for (size_t i = 0; i < error_pos; i++) {
@@ -150,6 +154,11 @@ void au_print_parser_error(struct au_parser_result res,
         errored_token = res.data.duplicate_id.name_token;
         break;
     }
+    case X(INT_TOO_LARGE): {
+        fprintf(stderr, "this integer is too large");
+        errored_token = res.data.int_too_large.int_token;
+        break;
+    }
     }
 #undef X
     fprintf(stderr, "\n");
@@ -222,6 +231,10 @@ void au_print_interpreter_error(struct au_interpreter_result res,
         fprintf(stderr, "uncaught exception");
         break;
     }
+    case X(INT_OVERFLOW): {
+        fprintf(stderr, "integer overflow");
+        break;
+    }
     }
 #undef X
     fprintf(stderr, "\n");
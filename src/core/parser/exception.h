@@ -25,6 +25,7 @@ enum au_parser_result_type {
     X(DUPLICATE_PROP) = 12,
     X(DUPLICATE_ARG) = 13,
     X(DUPLICATE_CONST) = 14,
+    X(INT_TOO_LARGE) = 15,
 };
 #undef X
 
@@ -53,6 +54,9 @@ struct au_parser_result {
         struct {
             struct au_token at_token;
         } class_scope;
+        struct {
+            struct au_token int_token;
+        } int_too_large;
     } data;
     enum au_parser_result_type type;
 };
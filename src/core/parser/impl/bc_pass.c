@@ -0,0 +1,295 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#include <stdlib.h>
+
+#include "bc_pass.h"
+
+int au_parser_opcode_operands(uint8_t op) {
+    switch (op) {
+    case AU_OP_MOV_U16:
+    case AU_OP_LOAD_NIL:
+    case AU_OP_LOAD_CONST:
+    case AU_OP_SET_CONST:
+    case AU_OP_CALL:
+    case AU_OP_CALL_CATCH:
+    case AU_OP_TAIL_CALL:
+    case AU_OP_LOAD_FUNC:
+    case AU_OP_ARRAY_NEW:
+    case AU_OP_TUPLE_NEW:
+    case AU_OP_DICT_NEW:
+    case AU_OP_CLASS_NEW:
+    case AU_OP_CLASS_NEW_INITIALZIED:
+    // Only appears as part of an AU_OP_CLASS_NEW_INITIALZIED sequence,
+    // since methods are never inlined
+    case AU_OP_CLASS_SET_INNER:
+    case AU_OP_PRINT:
+    case AU_OP_RET:
+        return OPR_REG1;
+    case AU_OP_MOV_REG_LOCAL:
+    case AU_OP_MOV_LOCAL_REG:
+        return OPR_REG1 | OPR_LOCAL;
+    case AU_OP_RET_LOCAL:
+        return OPR_LOCAL;
+    case AU_OP_MOV_BOOL:
+        return OPR_REG2;
+    case AU_OP_NOT:
+    case AU_OP_BNOT:
+    case AU_OP_NEG:
+    case AU_OP_ARRAY_PUSH:
+    case AU_OP_BIND_ARG_TO_FUNC:
+        return OPR_REG1 | OPR_REG2;
+    case AU_OP_MUL:
+    case AU_OP_DIV:
+    case AU_OP_ADD:
+    case AU_OP_SUB:
+    case AU_OP_MOD:
+    case AU_OP_EQ:
+    case AU_OP_NEQ:
+    case AU_OP_LT:
+    case AU_OP_GT:
+    case AU_OP_LEQ:
+    case AU_OP_GEQ:
+    case AU_OP_BOR:
+    case AU_OP_BXOR:
+    case AU_OP_BAND:
+    case AU_OP_BSHL:
+    case AU_OP_BSHR:
+    case AU_OP_MUL_INT:
+    case AU_OP_DIV_INT:
+    case AU_OP_ADD_INT:
+    case AU_OP_SUB_INT:
+    case AU_OP_MOD_INT:
+    case AU_OP_EQ_INT:
+    case AU_OP_NEQ_INT:
+    case AU_OP_LT_INT:
+    case AU_OP_GT_INT:
+    case AU_OP_LEQ_INT:
+    case AU_OP_GEQ_INT:
+    case AU_OP_MUL_DOUBLE:
+    case AU_OP_DIV_DOUBLE:
+    case AU_OP_ADD_DOUBLE:
+    case AU_OP_SUB_DOUBLE:
+    case AU_OP_EQ_DOUBLE:
+    case AU_OP_NEQ_DOUBLE:
+    case AU_OP_LT_DOUBLE:
+    case AU_OP_GT_DOUBLE:
+    case AU_OP_LEQ_DOUBLE:
+    case AU_OP_GEQ_DOUBLE:
+    case AU_OP_IDX_GET:
+    case AU_OP_IDX_SET:
+    case AU_OP_PUSH_ARG:
+        return OPR_REG1 | OPR_REG2 | OPR_REG3;
+    case AU_OP_IDX_SET_STATIC:
+    case AU_OP_CALL_FUNC_VALUE:
+    case AU_OP_CALL_FUNC_VALUE_CATCH:
+        return OPR_REG1 | OPR_REG3;
+    case AU_OP_JIF:
+    case AU_OP_JNIF:
+    case AU_OP_JIF_BOOL:
+    case AU_OP_JNIF_BOOL:
+        return OPR_REG1 | OPR_JUMP;
+    case AU_OP_JREL:
+    case AU_OP_JRELB:
+        return OPR_JUMP;
+    case AU_OP_RET_NULL:
+    case AU_OP_NOP:
+        return 0;
+    case AU_OP_CLASS_GET_INNER:
+    case AU_OP_RAISE:
+        return OPR_REG1 | OPR_NO_INLINE;
+    default:
+        // AU_OP_LOAD_SELF, AU_OP_IMPORT
+        return OPR_NO_INLINE;
+    }
+}
+int au_parser_opcode_dest(uint8_t op) {
+    switch (op) {
+    case AU_OP_MOV_U16:
+    case AU_OP_MOV_LOCAL_REG:
+    case AU_OP_LOAD_NIL:
+    case AU_OP_LOAD_CONST:
+    case AU_OP_CALL:
+    case AU_OP_CALL_CATCH:
+    case AU_OP_TAIL_CALL:
+    case AU_OP_LOAD_FUNC:
+    case AU_OP_ARRAY_NEW:
+    case AU_OP_TUPLE_NEW:
+    case AU_OP_DICT_NEW:
+    case AU_OP_CLASS_NEW:
+    case AU_OP_CLASS_NEW_INITIALZIED:
+    case AU_OP_CLASS_GET_INNER:
+        return OPR_REG1;
+    case AU_OP_MOV_BOOL:
+    case AU_OP_NOT:
+    case AU_OP_BNOT:
+    case AU_OP_NEG:
+        return OPR_REG2;
+    case AU_OP_MUL:
+    case AU_OP_DIV:
+    case AU_OP_ADD:
+    case AU_OP_SUB:
+    case AU_OP_MOD:
+    case AU_OP_EQ:
+    case AU_OP_NEQ:
+    case AU_OP_LT:
+    case AU_OP_GT:
+    case AU_OP_LEQ:
+    case AU_OP_GEQ:
+    case AU_OP_BOR:
+    case AU_OP_BXOR:
+    case AU_OP_BAND:
+    case AU_OP_BSHL:
+    case AU_OP_BSHR:
+    case AU_OP_MUL_INT:
+    case AU_OP_DIV_INT:
+    case AU_OP_ADD_INT:
+    case AU_OP_SUB_INT:
+    case AU_OP_MOD_INT:
+    case AU_OP_EQ_INT:
+    case AU_OP_NEQ_INT:
+    case AU_OP_LT_INT:
+    case AU_OP_GT_INT:
+    case AU_OP_LEQ_INT:
+    case AU_OP_GEQ_INT:
+    case AU_OP_MUL_DOUBLE:
+    case AU_OP_DIV_DOUBLE:
+    case AU_OP_ADD_DOUBLE:
+    case AU_OP_SUB_DOUBLE:
+    case AU_OP_EQ_DOUBLE:
+    case AU_OP_NEQ_DOUBLE:
+    case AU_OP_LT_DOUBLE:
+    case AU_OP_GT_DOUBLE:
+    case AU_OP_LEQ_DOUBLE:
+    case AU_OP_GEQ_DOUBLE:
+    case AU_OP_IDX_GET:
+    case AU_OP_CALL_FUNC_VALUE:
+    case AU_OP_CALL_FUNC_VALUE_CATCH:
+        return OPR_REG3;
+    default:
+        return 0;
+    }
+}
+
+void au_parser_relocate_source_map(
+    struct au_program_data *p_data, size_t func_idx, const size_t *new_pos,
+    const struct au_parser_sm_insert_array *inserts) {
+    const struct au_program_source_map_array old = p_data->source_map;
+    size_t *new_idx = au_data_calloc(old.len + 1, sizeof(size_t));
+    struct au_program_source_map_array source_map =
+        (struct au_program_source_map_array){0};
+
+    for (size_t i = 0; i <= old.len; i++) {
+        new_idx[i] = source_map.len;
+        for (size_t j = 0; j < inserts->len; j++) {
+            const struct au_parser_sm_insert *insert = &inserts->data[j];
+            if (insert->insert_before != i)
+                continue;
+            for (size_t k = 0; k < insert->entries.len; k++)
+                au_program_source_map_array_add(&source_map,
+                                                insert->entries.data[k]);
+        }
+        if (i == old.len)
+            break;
+        struct au_program_source_map map = old.data[i];
+        if (map.func_idx == func_idx) {
+            map.bc_from = new_pos[map.bc_from / 4];
+            map.bc_to = new_pos[(map.bc_to + 3) / 4];
+        }
+        au_program_source_map_array_add(&source_map, map);
+    }
+
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type != AU_FN_BC)
+            continue;
+        struct au_bc_storage *bcs = &fn->as.bc_func;
+        if (bcs->source_map_start <= old.len)
+            bcs->source_map_start = new_idx[bcs->source_map_start];
+    }
+
+    au_data_free(new_idx);
+    au_data_free(old.data);
+    p_data->source_map = source_map;
+}
+
+struct sm_sort_key {
+    const struct au_program_source_map *map;
+    size_t idx;
+};
+
+static int sm_sort_key_cmp(const void *a, const void *b) {
+    const struct sm_sort_key *x = a, *y = b;
+    // AU_SM_FUNC_ID_MAIN wraps around, so the main function comes first
+    const size_t x_func = x->map->func_idx + 1;
+    const size_t y_func = y->map->func_idx + 1;
+    if (x_func != y_func)
+        return x_func < y_func ? -1 : 1;
+    if (x->map->bc_from != y->map->bc_from)
+        return x->map->bc_from < y->map->bc_from ? -1 : 1;
+    // Enclosing entries come before the entries they contain
+    if (x->map->bc_to != y->map->bc_to)
+        return x->map->bc_to > y->map->bc_to ? -1 : 1;
+    // Entries spanning the same bytecode are added innermost first
+    if (x->idx != y->idx)
+        return x->idx > y->idx ? -1 : 1;
+    return 0;
+}
+
+void au_parser_sort_source_map(struct au_program *program) {
+    struct au_program_data *p_data = &program->data;
+    const struct au_program_source_map_array old = p_data->source_map;
+
+    program->main.source_map_start = 0;
+    program->main.source_map_len = 0;
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type != AU_FN_BC)
+            continue;
+        fn->as.bc_func.source_map_start = 0;
+        fn->as.bc_func.source_map_len = 0;
+    }
+    if (old.len == 0)
+        return;
+
+    struct sm_sort_key *keys =
+        au_data_malloc(old.len * sizeof(struct sm_sort_key));
+    for (size_t i = 0; i < old.len; i++)
+        keys[i] = (struct sm_sort_key){.map = &old.data[i], .idx = i};
+    qsort(keys, old.len, sizeof(struct sm_sort_key), sm_sort_key_cmp);
+
+    struct au_program_source_map_array source_map =
+        (struct au_program_source_map_array){0};
+    // Stack of the entries enclosing the current one
+    size_t *enclosing = au_data_malloc(old.len * sizeof(size_t));
+    size_t num_enclosing = 0;
+    struct au_bc_storage *bcs = 0;
+    for (size_t i = 0; i < old.len; i++) {
+        struct au_program_source_map map = *keys[i].map;
+        if (bcs == 0 || map.func_idx != bcs->func_idx) {
+            if (map.func_idx == AU_SM_FUNC_ID_MAIN)
+                bcs = &program->main;
+            else
+                bcs = &p_data->fns.data[map.func_idx].as.bc_func;
+            bcs->source_map_start = i;
+            num_enclosing = 0;
+        }
+        while (num_enclosing > 0 &&
+               source_map.data[enclosing[num_enclosing - 1]].bc_to <=
+                   map.bc_from)
+            num_enclosing--;
+        map.parent = num_enclosing > 0 ? enclosing[num_enclosing - 1]
+                                       : AU_SM_NO_PARENT;
+        enclosing[num_enclosing++] = i;
+        au_program_source_map_array_add(&source_map, map);
+        bcs->source_map_len++;
+    }
+
+    au_data_free(enclosing);
+    au_data_free(keys);
+    au_data_free(old.data);
+    p_data->source_map = source_map;
+}
@@ -0,0 +1,92 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#pragma once
+
+#include "bc.h"
+#include "def.h"
+
+// Operand layout of an instruction
+#define OPR_REG1 (1 << 0)
+#define OPR_REG2 (1 << 1)
+#define OPR_REG3 (1 << 2)
+#define OPR_LOCAL (1 << 3)
+#define OPR_JUMP (1 << 4)
+#define OPR_NO_INLINE (1 << 5)
+
+/// [func] Returns the operand layout of an opcode
+/// @param op the opcode
+/// @return a combination of OPR_* flags
+AU_PRIVATE int au_parser_opcode_operands(uint8_t op);
+
+/// [func] Returns which register operand an opcode writes to
+/// @param op the opcode
+/// @return OPR_REG1, OPR_REG2, OPR_REG3 or 0 if the opcode doesn't write
+///     to a register
+AU_PRIVATE int au_parser_opcode_dest(uint8_t op);
+
+static inline int is_jump_op(uint8_t op) {
+    return (au_parser_opcode_operands(op) & OPR_JUMP) != 0;
+}
+
+static inline int is_call_op(uint8_t op) {
+    return op == AU_OP_CALL || op == AU_OP_TAIL_CALL;
+}
+
+static inline uint16_t read_u16(const struct au_bc_buf *bc, size_t idx) {
+    return *((uint16_t *)(&bc->data[idx]));
+}
+
+/// Returns the absolute slot index that the jump instruction in slot
+/// `slot` targets
+static inline size_t jump_target(const struct au_bc_buf *bc,
+                                 size_t slot) {
+    const size_t offset = read_u16(bc, slot * 4 + 2);
+    if (bc->data[slot * 4] == AU_OP_JRELB)
+        return slot - offset;
+    return slot + offset;
+}
+
+static inline void emit_insn(struct au_bc_buf *bc, uint8_t op, uint8_t a,
+                             uint8_t b, uint8_t c) {
+    au_bc_buf_add(bc, op);
+    au_bc_buf_add(bc, a);
+    au_bc_buf_add(bc, b);
+    au_bc_buf_add(bc, c);
+}
+
+static inline void emit_insn_u16(struct au_bc_buf *bc, uint8_t op,
+                                 uint8_t a, uint16_t val) {
+    emit_insn(bc, op, a, 0, 0);
+    au_replace_bc_u16(bc, bc->len - 2, val);
+}
+
+/// Source map entries to be inserted into the program's source map
+struct au_parser_sm_insert {
+    /// Index (in the old source map) of the entry that the new entries
+    /// are inserted before
+    size_t insert_before;
+    struct au_program_source_map_array entries;
+};
+
+AU_ARRAY_STRUCT(struct au_parser_sm_insert, au_parser_sm_insert_array, 1)
+
+/// [func] Relocates the source map entries of a function whose bytecode
+///     has been rewritten, and inserts new entries into the source map
+/// @param p_data program data
+/// @param func_idx index of the rewritten function
+/// @param new_pos maps every slot of the old bytecode (plus the end of
+///     the bytecode) to its offset in the new bytecode
+/// @param inserts entries to be inserted
+AU_PRIVATE void au_parser_relocate_source_map(
+    struct au_program_data *p_data, size_t func_idx, const size_t *new_pos,
+    const struct au_parser_sm_insert_array *inserts);
+
+/// [func] Groups the source map entries of the program by function and
+///     sorts them by bc_from, so that au_vm_locate_error can use a binary
+///     search. Runs after every pass that rewrites bytecode.
+/// @param program the program
+AU_PRIVATE void au_parser_sort_source_map(struct au_program *program);
@@ -75,6 +75,11 @@ struct au_parser {
     int self_num_args;
     /// Current function flags
     uint32_t self_flags;
+    /// Offset of the last emitted AU_OP_CALL instruction
+    size_t last_call_offset;
+    /// Length of the bytecode buffer right after the last emitted
+    ///     AU_OP_CALL instruction and its arguments
+    size_t last_call_end;
 
     /// The index of this function's class
     struct au_class_interface *class_interface;
@@ -10,6 +10,7 @@
 #include "regs.h"
 #include "resolve.h"
 
+#include "platform/arithmetic.h"
 #include "platform/dconv.h"
 
 #include <stdio.h>
@@ -789,6 +790,7 @@ int au_parser_exec_call(struct au_parser *p, struct au_lexer *l,
     }
 
     // Generate code
+    const size_t call_offset = p->bc.len;
     switch (calling_type) {
     case CA_NORMAL: {
         au_parser_emit_bc_u8(p, AU_OP_CALL);
@@ -828,6 +830,9 @@ int au_parser_exec_call(struct au_parser *p, struct au_lexer *l,
 #undef EMIT_ARG
     }
 
+    p->last_call_offset = call_offset;
+    p->last_call_end = p->bc.len;
+
     if (execute_self) {
         size_t_array_add(&p->self_fill_call, call_fn_offset);
     } else {
@@ -859,16 +864,28 @@ int au_parser_exec_value(struct au_parser *p, struct au_lexer *l) {
 
     switch (tok.type) {
     case AU_TOK_INT: {
-        int32_t num = 0;
+        int64_t num = 0;
+        int too_large = 0;
         if (tok.len >= 2 && tok.src[0] == '0' && tok.src[1] == 'x') {
-            for (size_t i = 2; i < tok.len; i++) {
-                num = num * 16 + hex_value(tok.src[i]);
+            for (size_t i = 2; i < tok.len && !too_large; i++) {
+                too_large = au_platform_imul_overflow(num, 16, &num) ||
+                            au_platform_iadd_overflow(
+                                num, hex_value(tok.src[i]), &num);
             }
         } else {
-            for (size_t i = 0; i < tok.len; i++) {
-                num = num * 10 + (tok.src[i] - '0');
+            for (size_t i = 0; i < tok.len && !too_large; i++) {
+                too_large = au_platform_imul_overflow(num, 10, &num) ||
+                            au_platform_iadd_overflow(
+                                num, tok.src[i] - '0', &num);
             }
         }
+        if (too_large) {
+            p->res = (struct au_parser_result){
+                .type = AU_PARSER_RES_INT_TOO_LARGE,
+                .data.int_too_large.int_token = tok,
+            };
+            return 0;
+        }
 
         uint8_t result_reg;
         EXPECT_BYTECODE(au_parser_new_reg(p, &result_reg));
@@ -0,0 +1,353 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#include "inline.h"
+#include "bc_pass.h"
+
+static int is_inlinable(const struct au_fn *fn, size_t callee_idx,
+                        const struct au_bc_storage *caller,
+                        int is_tail_site, int *ret_src_out) {
+    if (fn->type != AU_FN_BC)
+        return 0;
+    if ((fn->flags & (AU_FN_FLAG_HAS_CLASS | AU_FN_FLAG_MAY_FAIL)) != 0)
+        return 0;
+    const struct au_bc_storage *bcs = &fn->as.bc_func;
+    if (bcs == caller || bcs->bc.len > AU_INLINE_MAX_BC)
+        return 0;
+    if (caller->num_registers + bcs->num_registers > AU_REGS ||
+        caller->num_locals + bcs->num_locals > AU_MAX_LOCALS)
+        return 0;
+
+    // The callee's return register is renamed to the caller's result
+    // register, so every AU_OP_RET must return the same register
+    int ret_src = -1;
+    for (size_t pos = 0; pos < bcs->bc.len; pos += 4) {
+        const uint8_t op = bcs->bc.data[pos];
+        if ((au_parser_opcode_operands(op) & OPR_NO_INLINE) != 0)
+            return 0;
+        if ((is_call_op(op) || op == AU_OP_CALL_CATCH) &&
+            read_u16(&bcs->bc, pos + 2) == callee_idx)
+            return 0;
+        if (op == AU_OP_RET) {
+            const uint8_t reg = bcs->bc.data[pos + 1];
+            if (ret_src != -1 && ret_src != reg)
+                return 0;
+            ret_src = reg;
+        }
+    }
+
+    // Tail calls inside the callee stay tail calls when the call site is
+    // in the caller's tail position, which requires them to produce the
+    // callee's return value
+    if (is_tail_site) {
+        for (size_t pos = 0; pos < bcs->bc.len; pos += 4) {
+            if (bcs->bc.data[pos] == AU_OP_TAIL_CALL &&
+                bcs->bc.data[pos + 1] != ret_src)
+                return 0;
+        }
+    }
+    *ret_src_out = ret_src;
+    return 1;
+}
+
+struct inline_call {
+    const struct au_bc_storage *callee;
+    int ret_src;
+    uint8_t ret_reg;
+    int is_tail_site;
+    int base_reg;
+    int base_local;
+    size_t caller_func_idx;
+};
+
+static inline uint8_t remap_reg(const struct inline_call *call,
+                                uint8_t reg) {
+    if (reg == call->ret_src)
+        return call->ret_reg;
+    return call->base_reg + reg;
+}
+
+/// Emits the body of an inlined function into `out`, and adds its
+/// (relocated) source map entries into `entries`
+/// @return 1 on success, 0 if a jump offset can't be encoded
+static int emit_inlined_body(const struct inline_call *call,
+                             struct au_bc_buf *out,
+                             const struct au_program_data *p_data,
+                             struct au_program_source_map_array *entries) {
+    const struct au_bc_buf *cbc = &call->callee->bc;
+    const size_t num_slots = (cbc->len + 3) / 4;
+
+    char *is_target = au_data_calloc(num_slots + 1, 1);
+    for (size_t slot = 0; slot < num_slots; slot++) {
+        if (is_jump_op(cbc->data[slot * 4]))
+            is_target[jump_target(cbc, slot)] = 1;
+    }
+
+    // Every function body ends with an AU_OP_RET_NULL, which is dead
+    // code if the last statement is a return statement
+    size_t end_slot = num_slots;
+    if (num_slots >= 2 &&
+        cbc->data[(num_slots - 1) * 4] == AU_OP_RET_NULL &&
+        is_return_op(cbc->data[(num_slots - 2) * 4]) &&
+        !is_target[num_slots - 1])
+        end_slot--;
+
+    size_t *new_pos = au_data_calloc(num_slots + 1, sizeof(size_t));
+    struct size_t_array exit_jumps = (struct size_t_array){0};
+    struct size_t_array inner_jumps = (struct size_t_array){0};
+    int retval = 1;
+
+    for (size_t slot = 0; slot < end_slot; slot++) {
+        new_pos[slot] = out->len;
+        const uint8_t *insn = &cbc->data[slot * 4];
+        const int is_last = slot == end_slot - 1;
+        switch (insn[0]) {
+        case AU_OP_RET: {
+            // The returned register has been renamed to ret_reg
+            break;
+        }
+        case AU_OP_RET_LOCAL: {
+            emit_insn_u16(out, AU_OP_MOV_LOCAL_REG, call->ret_reg,
+                          call->base_local + read_u16(cbc, slot * 4 + 2));
+            break;
+        }
+        case AU_OP_RET_NULL: {
+            emit_insn(out, AU_OP_LOAD_NIL, call->ret_reg, 0, 0);
+            break;
+        }
+        default: {
+            const int operands = au_parser_opcode_operands(insn[0]);
+            const size_t pos = out->len;
+            // Calls in the callee's tail position are only in the
+            // caller's tail position if the call site itself is
+            const uint8_t op =
+                insn[0] == AU_OP_TAIL_CALL && !call->is_tail_site
+                    ? AU_OP_CALL
+                    : insn[0];
+            emit_insn(out, op,
+                      (operands & OPR_REG1) ? remap_reg(call, insn[1])
+                                            : insn[1],
+                      (operands & OPR_REG2) ? remap_reg(call, insn[2])
+                                            : insn[2],
+                      (operands & OPR_REG3) ? remap_reg(call, insn[3])
+                                            : insn[3]);
+            if ((operands & OPR_LOCAL) != 0)
+                au_replace_bc_u16(out, pos + 2,
+                                  call->base_local +
+                                      read_u16(cbc, slot * 4 + 2));
+            if ((operands & OPR_JUMP) != 0) {
+                size_t_array_add(&inner_jumps, pos);
+                size_t_array_add(&inner_jumps, jump_target(cbc, slot));
+            }
+            continue;
+        }
+        }
+        if (!is_last) {
+            size_t_array_add(&exit_jumps, out->len);
+            emit_insn(out, AU_OP_JREL, 0, 0, 0);
+        }
+    }
+    for (size_t slot = end_slot; slot <= num_slots; slot++)
+        new_pos[slot] = out->len;
+
+    for (size_t i = 0; i < exit_jumps.len; i++) {
+        const size_t pos = exit_jumps.data[i];
+        const size_t offset = (out->len - pos) / 4;
+        if (offset > UINT16_MAX) {
+            retval = 0;
+            goto end;
+        }
+        au_replace_bc_u16(out, pos + 2, offset);
+    }
+    for (size_t i = 0; i < inner_jumps.len; i += 2) {
+        const size_t pos = inner_jumps.data[i];
+        const size_t target = new_pos[inner_jumps.data[i + 1]];
+        const size_t offset = out->data[pos] == AU_OP_JRELB
+                                  ? (pos - target) / 4
+                                  : (target - pos) / 4;
+        if (offset > UINT16_MAX) {
+            retval = 0;
+            goto end;
+        }
+        au_replace_bc_u16(out, pos + 2, offset);
+    }
+
+    for (size_t i = 0; i < p_data->source_map.len; i++) {
+        const struct au_program_source_map *map =
+            &p_data->source_map.data[i];
+        if (map->func_idx != call->callee->func_idx)
+            continue;
+        struct au_program_source_map new_map = *map;
+        new_map.bc_from = new_pos[map->bc_from / 4];
+        new_map.bc_to = new_pos[(map->bc_to + 3) / 4];
+        new_map.func_idx = call->caller_func_idx;
+        au_program_source_map_array_add(entries, new_map);
+    }
+
+end:
+    au_data_free(is_target);
+    au_data_free(new_pos);
+    au_data_free(exit_jumps.data);
+    au_data_free(inner_jumps.data);
+    return retval;
+}
+
+static void inline_calls(struct au_bc_storage *caller,
+                         struct au_program_data *p_data) {
+    const struct au_bc_buf *bc = &caller->bc;
+    const size_t num_slots = (bc->len + 3) / 4;
+
+    int has_inlinable_call = 0;
+    for (size_t pos = 0; pos + 4 <= bc->len; pos += 4) {
+        int ret_src;
+        if (is_call_op(bc->data[pos])) {
+            const size_t func_idx = read_u16(bc, pos + 2);
+            if (is_inlinable(&p_data->fns.data[func_idx], func_idx, caller,
+                             bc->data[pos] == AU_OP_TAIL_CALL,
+                             &ret_src)) {
+                has_inlinable_call = 1;
+                break;
+            }
+        }
+    }
+    if (!has_inlinable_call)
+        return;
+
+    struct au_bc_buf out = (struct au_bc_buf){0};
+    size_t *new_pos = au_data_calloc(num_slots + 1, sizeof(size_t));
+    struct au_parser_sm_insert_array sites =
+        (struct au_parser_sm_insert_array){0};
+    int extra_regs = 0, extra_locals = 0;
+    int ok = 1;
+
+    for (size_t slot = 0; slot < num_slots;) {
+        const size_t pos = slot * 4;
+        new_pos[slot] = out.len;
+
+        int ret_src;
+        const struct au_fn *fn = 0;
+        size_t func_idx = 0;
+        if (is_call_op(bc->data[pos])) {
+            func_idx = read_u16(bc, pos + 2);
+            fn = &p_data->fns.data[func_idx];
+            if (!is_inlinable(fn, func_idx, caller,
+                              bc->data[pos] == AU_OP_TAIL_CALL, &ret_src))
+                fn = 0;
+        }
+        if (fn == 0) {
+            for (size_t i = pos; i < pos + 4 && i < bc->len; i++)
+                au_bc_buf_add(&out, bc->data[i]);
+            slot++;
+            continue;
+        }
+
+        const struct au_bc_storage *callee = &fn->as.bc_func;
+        const struct inline_call call = (struct inline_call){
+            .callee = callee,
+            .ret_src = ret_src,
+            .ret_reg = bc->data[pos + 1],
+            .is_tail_site = bc->data[pos] == AU_OP_TAIL_CALL,
+            .base_reg = caller->num_registers,
+            .base_local = caller->num_locals,
+            .caller_func_idx = caller->func_idx,
+        };
+
+        // The innermost statement containing the call site
+        struct au_parser_sm_insert site = (struct au_parser_sm_insert){0};
+        site.insert_before = p_data->source_map.len;
+        for (size_t i = 0; i < p_data->source_map.len; i++) {
+            const struct au_program_source_map *map =
+                &p_data->source_map.data[i];
+            if (map->func_idx == caller->func_idx && map->bc_from <= pos &&
+                pos < map->bc_to) {
+                site.insert_before = i;
+                break;
+            }
+        }
+
+        // Move the arguments into the callee's locals
+        const size_t region_from = out.len;
+        for (int i = 0; i < callee->num_args; i++) {
+            const uint8_t arg_reg =
+                bc->data[pos + 4 + (i / 3) * 4 + 1 + i % 3];
+            emit_insn_u16(&out, AU_OP_MOV_REG_LOCAL, arg_reg,
+                          call.base_local + i);
+        }
+        if (!emit_inlined_body(&call, &out, p_data, &site.entries)) {
+            au_data_free(site.entries.data);
+            ok = 0;
+            break;
+        }
+        if (site.insert_before != p_data->source_map.len) {
+            const struct au_program_source_map *map =
+                &p_data->source_map.data[site.insert_before];
+            struct au_program_source_map call_site =
+                (struct au_program_source_map){
+                    .bc_from = region_from,
+                    .bc_to = out.len,
+                    .source_start = map->source_start,
+                    .func_idx = caller->func_idx,
+                    .inlined_call = 1,
+                };
+            au_program_source_map_array_add(&site.entries, call_site);
+        }
+        au_parser_sm_insert_array_add(&sites, site);
+
+        if (callee->num_registers > extra_regs)
+            extra_regs = callee->num_registers;
+        if (callee->num_locals > extra_locals)
+            extra_locals = callee->num_locals;
+
+        // Skip the call and its AU_OP_PUSH_ARG instructions
+        const size_t call_slots = 1 + (callee->num_args + 2) / 3;
+        for (size_t i = 1; i < call_slots; i++)
+            new_pos[slot + i] = region_from;
+        slot += call_slots;
+    }
+    new_pos[num_slots] = out.len;
+
+    // Relocate the caller's jumps
+    for (size_t slot = 0; ok && slot < num_slots; slot++) {
+        if (slot * 4 + 4 > bc->len || !is_jump_op(bc->data[slot * 4]))
+            continue;
+        const size_t pos = new_pos[slot];
+        const size_t target = new_pos[jump_target(bc, slot)];
+        const size_t offset = bc->data[slot * 4] == AU_OP_JRELB
+                                  ? (pos - target) / 4
+                                  : (target - pos) / 4;
+        if (offset > UINT16_MAX)
+            ok = 0;
+        else
+            au_replace_bc_u16(&out, pos + 2, offset);
+    }
+
+    if (ok) {
+        au_parser_relocate_source_map(p_data, caller->func_idx, new_pos,
+                                      &sites);
+        au_data_free(caller->bc.data);
+        caller->bc = out;
+        caller->num_registers += extra_regs;
+        caller->num_locals += extra_locals;
+        caller->num_values = caller->num_registers + caller->num_locals;
+    } else {
+        au_data_free(out.data);
+    }
+
+    for (size_t i = 0; i < sites.len; i++)
+        au_data_free(sites.data[i].entries.data);
+    au_data_free(sites.data);
+    au_data_free(new_pos);
+}
+
+void au_parser_inline_program(struct au_program *program) {
+    struct au_program_data *p_data = &program->data;
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type == AU_FN_BC)
+            inline_calls(&fn->as.bc_func, p_data);
+    }
+    inline_calls(&program->main, p_data);
+}
@@ -0,0 +1,18 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#pragma once
+
+#include "def.h"
+
+/// Maximum size (in bytes) of a function's bytecode for it to be inlined
+#define AU_INLINE_MAX_BC 64
+
+/// [func] Inlines calls to small, non-recursive bytecode functions into
+///     their callers. This pass runs after the whole module has been
+///     parsed, so that every function body is final.
+/// @param program the program to be optimized
+AU_PRIVATE void au_parser_inline_program(struct au_program *program);
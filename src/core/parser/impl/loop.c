@@ -0,0 +1,769 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#include "loop.h"
+#include "bc_pass.h"
+
+#define REG_SET_LEN AU_BA_LEN(AU_REGS)
+#define NO_REG (-1)
+#define NO_INSN ((size_t)-1)
+
+struct insn {
+    /// Slot index of the instruction
+    size_t slot;
+    /// Number of slots the instruction spans, including the trailing
+    ///     AU_OP_PUSH_ARG or AU_OP_CLASS_SET_INNER slots
+    size_t num_slots;
+    /// Index of the instruction this instruction jumps to, or NO_INSN
+    size_t target;
+    /// Register the instruction writes to, or NO_REG
+    int dest;
+    /// Set if the instruction starts a basic block
+    int is_leader;
+    /// Registers read by the instruction
+    char uses[REG_SET_LEN];
+    /// Registers live right before the instruction
+    char live_in[REG_SET_LEN];
+    /// Registers live right after the instruction
+    char live_out[REG_SET_LEN];
+};
+
+AU_ARRAY_STRUCT(struct insn, insn_array, 1)
+
+struct loop {
+    /// Index of the first instruction of the loop, which is also the
+    /// target of its back edge
+    size_t head;
+    /// Index of the AU_OP_JRELB instruction closing the loop
+    size_t tail;
+};
+
+AU_ARRAY_COPY(struct loop, loop_array, 1)
+
+/// A load that has been moved in front of a loop
+struct hoisted_load {
+    size_t loop_idx;
+    uint8_t op;
+    uint8_t arg;
+    uint16_t val;
+    /// Register the value is loaded into
+    uint8_t reg;
+};
+
+AU_ARRAY_COPY(struct hoisted_load, hoisted_load_array, 1)
+
+/// Renames the register `from` into `to` wherever it is read by the
+/// instruction `insn`
+struct reg_rename {
+    size_t insn;
+    uint8_t from;
+    uint8_t to;
+};
+
+AU_ARRAY_COPY(struct reg_rename, reg_rename_array, 1)
+
+static inline int is_terminator_op(uint8_t op) {
+    return op == AU_OP_JREL || op == AU_OP_JRELB || op == AU_OP_RAISE ||
+           is_return_op(op);
+}
+
+static inline int insn_in_loop(const struct loop *loop, size_t insn) {
+    return loop->head <= insn && insn <= loop->tail;
+}
+
+static size_t insn_num_slots(const struct au_bc_buf *bc,
+                             const struct au_program_data *p_data,
+                             size_t slot) {
+    const size_t pos = slot * 4;
+    switch (bc->data[pos]) {
+    case AU_OP_CALL:
+    case AU_OP_CALL_CATCH:
+    case AU_OP_TAIL_CALL: {
+        const struct au_fn *fn = &p_data->fns.data[read_u16(bc, pos + 2)];
+        return 1 + (au_fn_num_args(fn) + 2) / 3;
+    }
+    case AU_OP_CALL_FUNC_VALUE:
+    case AU_OP_CALL_FUNC_VALUE_CATCH: {
+        return 1 + (bc->data[pos + 2] + 2) / 3;
+    }
+    case AU_OP_CLASS_NEW_INITIALZIED: {
+        size_t num_slots = 1;
+        while (bc->data[(slot + num_slots) * 4] != AU_OP_NOP)
+            num_slots++;
+        return num_slots + 1;
+    }
+    default:
+        return 1;
+    }
+}
+
+/// Returns the byte offset (relative to the start of the slot) of every
+/// register that the instruction in `slot` reads, where `part` is the
+/// index of the slot inside the instruction
+static int read_operands(const struct au_bc_buf *bc, size_t slot,
+                         size_t part, int offsets[3]) {
+    const uint8_t op = bc->data[slot * 4];
+    if (part != 0) {
+        if (op == AU_OP_PUSH_ARG) {
+            offsets[0] = 1;
+            offsets[1] = 2;
+            offsets[2] = 3;
+            return 3;
+        } else if (op == AU_OP_CLASS_SET_INNER) {
+            offsets[0] = 1;
+            return 1;
+        }
+        return 0;
+    }
+    const int operands = au_parser_opcode_operands(op);
+    const int dest = au_parser_opcode_dest(op);
+    int len = 0;
+    if ((operands & OPR_REG1) != 0 && dest != OPR_REG1)
+        offsets[len++] = 1;
+    if ((operands & OPR_REG2) != 0 && dest != OPR_REG2)
+        offsets[len++] = 2;
+    if ((operands & OPR_REG3) != 0 && dest != OPR_REG3)
+        offsets[len++] = 3;
+    return len;
+}
+
+static int dest_offset(uint8_t op) {
+    switch (au_parser_opcode_dest(op)) {
+    case OPR_REG1:
+        return 1;
+    case OPR_REG2:
+        return 2;
+    case OPR_REG3:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+/// Splits the bytecode into instructions and computes which registers are
+/// live before and after each of them
+/// @return 1 on success, 0 if the bytecode has a shape this pass doesn't
+///     understand
+static int analyze_insns(const struct au_bc_storage *bcs,
+                         const struct au_program_data *p_data,
+                         struct insn_array *insns, size_t *insn_at) {
+    const struct au_bc_buf *bc = &bcs->bc;
+    const size_t num_slots = (bc->len + 3) / 4;
+
+    for (size_t slot = 0; slot < num_slots;) {
+        struct insn insn = (struct insn){0};
+        insn.slot = slot;
+        insn.target = NO_INSN;
+        insn.dest = NO_REG;
+        if (slot * 4 + 4 > bc->len) {
+            // Trailing AU_OP_RET_NULL
+            insn.num_slots = 1;
+        } else {
+            insn.num_slots = insn_num_slots(bc, p_data, slot);
+            if (slot + insn.num_slots > num_slots)
+                return 0;
+            const uint8_t op = bc->data[slot * 4];
+            const int dest = dest_offset(op);
+            if (dest != 0)
+                insn.dest = bc->data[slot * 4 + dest];
+            for (size_t part = 0; part < insn.num_slots; part++) {
+                const uint8_t *data = &bc->data[(slot + part) * 4];
+                int offsets[3];
+                const int len =
+                    read_operands(bc, slot + part, part, offsets);
+                for (int i = 0; i < len; i++)
+                    AU_BA_SET_BIT(insn.uses, data[offsets[i]]);
+            }
+        }
+        insn_at[slot] = insns->len;
+        for (size_t part = 1; part < insn.num_slots; part++)
+            insn_at[slot + part] = NO_INSN;
+        insn_array_add(insns, insn);
+        slot += insn.num_slots;
+    }
+    insn_at[num_slots] = insns->len;
+
+    for (size_t i = 0; i < insns->len; i++) {
+        struct insn *insn = &insns->data[i];
+        const uint8_t op = bc->data[insn->slot * 4];
+        if (i == 0)
+            insn->is_leader = 1;
+        if (insn->slot * 4 + 4 > bc->len || !is_jump_op(op))
+            continue;
+        const size_t target_slot = jump_target(bc, insn->slot);
+        if (target_slot > num_slots || insn_at[target_slot] == NO_INSN ||
+            insn_at[target_slot] == insns->len)
+            return 0;
+        insn->target = insn_at[target_slot];
+        insns->data[insn->target].is_leader = 1;
+        if (i + 1 < insns->len)
+            insns->data[i + 1].is_leader = 1;
+    }
+    for (size_t i = 0; i + 1 < insns->len; i++) {
+        if (is_terminator_op(bc->data[insns->data[i].slot * 4]))
+            insns->data[i + 1].is_leader = 1;
+    }
+
+    // Backwards liveness analysis
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (size_t i = insns->len; i-- > 0;) {
+            struct insn *insn = &insns->data[i];
+            const uint8_t op = bc->data[insn->slot * 4];
+            char live_out[REG_SET_LEN] = {0};
+            if (!is_terminator_op(op) && i + 1 < insns->len)
+                memcpy(live_out, insns->data[i + 1].live_in, REG_SET_LEN);
+            if (insn->target != NO_INSN) {
+                const struct insn *target = &insns->data[insn->target];
+                for (size_t j = 0; j < REG_SET_LEN; j++)
+                    live_out[j] |= target->live_in[j];
+            }
+            char live_in[REG_SET_LEN];
+            memcpy(live_in, live_out, REG_SET_LEN);
+            if (insn->dest != NO_REG)
+                AU_BA_RESET_BIT(live_in, insn->dest);
+            for (size_t j = 0; j < REG_SET_LEN; j++)
+                live_in[j] |= insn->uses[j];
+            if (memcmp(live_in, insn->live_in, REG_SET_LEN) != 0 ||
+                memcmp(live_out, insn->live_out, REG_SET_LEN) != 0) {
+                memcpy(insn->live_in, live_in, REG_SET_LEN);
+                memcpy(insn->live_out, live_out, REG_SET_LEN);
+                changed = 1;
+            }
+        }
+    }
+    return 1;
+}
+
+/// Finds the loops of a function. Only loops that can solely be entered
+/// through their first instruction are returned. Loops sharing their
+/// first instruction are merged.
+static void find_loops(const struct au_bc_buf *bc,
+                       const struct insn_array *insns,
+                       struct loop_array *loops) {
+    for (size_t i = 0; i < insns->len; i++) {
+        const struct insn *insn = &insns->data[i];
+        if (insn->target == NO_INSN ||
+            bc->data[insn->slot * 4] != AU_OP_JRELB)
+            continue;
+        struct loop loop = (struct loop){.head = insn->target, .tail = i};
+        for (size_t j = 0; j < insns->len; j++) {
+            const size_t target = insns->data[j].target;
+            if (target != NO_INSN && !insn_in_loop(&loop, j) &&
+                target > loop.head && target <= loop.tail)
+                goto next;
+        }
+        for (size_t j = 0; j < loops->len; j++) {
+            if (loops->data[j].head == loop.head) {
+                if (loops->data[j].tail < loop.tail)
+                    loops->data[j].tail = loop.tail;
+                goto next;
+            }
+        }
+        loop_array_add(loops, loop);
+    next:;
+    }
+
+    // Loops that partially overlap aren't optimized
+    for (size_t i = 0; i < loops->len; i++) {
+        for (size_t j = 0; j < loops->len; j++) {
+            const struct loop *a = &loops->data[i], *b = &loops->data[j];
+            if (a->head < b->head && b->head <= a->tail &&
+                a->tail < b->tail) {
+                loops->data[i] = loops->data[--loops->len];
+                i--;
+                break;
+            }
+        }
+    }
+}
+
+// ** Induction variables **
+
+enum origin_kind {
+    ORIGIN_NONE = 0,
+    /// The register holds an integer
+    ORIGIN_INT,
+    /// The register holds the value of a local
+    ORIGIN_LOCAL,
+    /// The register holds the value of a local plus or minus an integer
+    ORIGIN_STEP,
+};
+
+struct origin {
+    enum origin_kind kind;
+    uint16_t local;
+};
+
+struct local_store {
+    uint16_t local;
+    int num_stores;
+    int is_step;
+};
+
+AU_ARRAY_COPY(struct local_store, local_store_array, 1)
+
+static int is_induction_local(const struct local_store_array *stores,
+                              uint16_t local) {
+    for (size_t i = 0; i < stores->len; i++) {
+        if (stores->data[i].local == local)
+            return stores->data[i].num_stores == 1 &&
+                   stores->data[i].is_step;
+    }
+    return 0;
+}
+
+static int is_int_origin(const struct origin *origin,
+                         const struct local_store_array *stores) {
+    switch (origin->kind) {
+    case ORIGIN_INT:
+        return 1;
+    case ORIGIN_LOCAL:
+    case ORIGIN_STEP:
+        return is_induction_local(stores, origin->local);
+    default:
+        return 0;
+    }
+}
+
+static uint8_t int_specialized_op(uint8_t op) {
+    switch (op) {
+    case AU_OP_ADD:
+        return AU_OP_ADD_INT;
+    case AU_OP_SUB:
+        return AU_OP_SUB_INT;
+    case AU_OP_MUL:
+        return AU_OP_MUL_INT;
+    case AU_OP_EQ:
+        return AU_OP_EQ_INT;
+    case AU_OP_NEQ:
+        return AU_OP_NEQ_INT;
+    case AU_OP_LT:
+        return AU_OP_LT_INT;
+    case AU_OP_GT:
+        return AU_OP_GT_INT;
+    case AU_OP_LEQ:
+        return AU_OP_LEQ_INT;
+    case AU_OP_GEQ:
+        return AU_OP_GEQ_INT;
+    default:
+        return op;
+    }
+}
+
+/// Tracks the origin of every register through the loop. The first pass
+/// records the stores to locals into `stores`, the second pass (with
+/// `specialize` set) replaces instructions operating on integer
+/// induction variables with their int-specialized versions.
+static void trace_origins(struct au_bc_buf *bc,
+                          const struct insn_array *insns,
+                          const struct loop *loop,
+                          struct local_store_array *stores,
+                          int specialize) {
+    struct origin origins[AU_REGS];
+    for (size_t i = loop->head; i <= loop->tail; i++) {
+        const struct insn *insn = &insns->data[i];
+        if (insn->is_leader)
+            memset(origins, 0, sizeof(origins));
+        uint8_t *data = &bc->data[insn->slot * 4];
+        struct origin result = (struct origin){.kind = ORIGIN_NONE};
+        switch (data[0]) {
+        case AU_OP_MOV_U16: {
+            result.kind = ORIGIN_INT;
+            break;
+        }
+        case AU_OP_MOV_LOCAL_REG: {
+            result.kind = ORIGIN_LOCAL;
+            result.local = read_u16(bc, insn->slot * 4 + 2);
+            break;
+        }
+        case AU_OP_MOV_REG_LOCAL: {
+            if (specialize)
+                break;
+            const uint16_t local = read_u16(bc, insn->slot * 4 + 2);
+            const struct origin *src = &origins[data[1]];
+            struct local_store *store = 0;
+            for (size_t j = 0; j < stores->len; j++) {
+                if (stores->data[j].local == local)
+                    store = &stores->data[j];
+            }
+            if (store == 0) {
+                local_store_array_add(
+                    stores, (struct local_store){.local = local});
+                store = &stores->data[stores->len - 1];
+            }
+            store->num_stores++;
+            store->is_step =
+                src->kind == ORIGIN_STEP && src->local == local;
+            break;
+        }
+        case AU_OP_ADD:
+        case AU_OP_SUB:
+        case AU_OP_MUL:
+        case AU_OP_EQ:
+        case AU_OP_NEQ:
+        case AU_OP_LT:
+        case AU_OP_GT:
+        case AU_OP_LEQ:
+        case AU_OP_GEQ: {
+            const struct origin *lhs = &origins[data[1]];
+            const struct origin *rhs = &origins[data[2]];
+            if (!specialize) {
+                if ((data[0] == AU_OP_ADD || data[0] == AU_OP_SUB) &&
+                    lhs->kind == ORIGIN_LOCAL && rhs->kind == ORIGIN_INT) {
+                    result.kind = ORIGIN_STEP;
+                    result.local = lhs->local;
+                } else if (data[0] == AU_OP_ADD &&
+                           lhs->kind == ORIGIN_INT &&
+                           rhs->kind == ORIGIN_LOCAL) {
+                    result.kind = ORIGIN_STEP;
+                    result.local = rhs->local;
+                }
+                break;
+            }
+            if (is_int_origin(lhs, stores) && is_int_origin(rhs, stores)) {
+                const uint8_t op = data[0];
+                data[0] = int_specialized_op(op);
+                if (op == AU_OP_ADD || op == AU_OP_SUB || op == AU_OP_MUL)
+                    result.kind = ORIGIN_INT;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        if (insn->dest != NO_REG)
+            origins[insn->dest] = result;
+    }
+}
+
+/// Replaces arithmetic and comparisons on integer induction variables
+/// (locals whose only store in the loop adds an integer to itself) with
+/// their int-specialized versions. The specialized instructions still
+/// fall back to the generic ones if an operand isn't an integer.
+static void specialize_induction_vars(struct au_bc_buf *bc,
+                                      const struct insn_array *insns,
+                                      const struct loop *loop) {
+    struct local_store_array stores = (struct local_store_array){0};
+    trace_origins(bc, insns, loop, &stores, 0);
+    trace_origins(bc, insns, loop, &stores, 1);
+    au_data_free(stores.data);
+}
+
+// ** Invariant code motion **
+
+/// Finds the instructions reading the value that instruction `def`
+/// writes into its register. The value must be dead once the basic
+/// block ends.
+/// @return 1 if the value only reaches instructions in the same basic
+///     block, 0 otherwise
+static int find_block_uses(const struct au_bc_buf *bc,
+                           const struct insn_array *insns, size_t def,
+                           struct reg_rename_array *uses) {
+    const int reg = insns->data[def].dest;
+    for (size_t i = def + 1; i < insns->len; i++) {
+        const struct insn *insn = &insns->data[i];
+        if (insn->is_leader)
+            return !AU_BA_GET_BIT(insn->live_in, reg);
+        if (AU_BA_GET_BIT(insn->uses, reg))
+            reg_rename_array_add(uses, (struct reg_rename){.insn = i});
+        if (insn->dest == reg)
+            return 1;
+        if (is_terminator_op(bc->data[insn->slot * 4]) ||
+            insn->target != NO_INSN)
+            return !AU_BA_GET_BIT(insn->live_out, reg);
+    }
+    return 1;
+}
+
+static int is_invariant_load(const struct au_bc_buf *bc,
+                             const struct insn_array *insns,
+                             const struct loop *loop, size_t i,
+                             const char *set_consts) {
+    const size_t pos = insns->data[i].slot * 4;
+    switch (bc->data[pos]) {
+    case AU_OP_MOV_U16:
+    case AU_OP_MOV_BOOL:
+    case AU_OP_LOAD_NIL:
+        return 1;
+    case AU_OP_LOAD_CONST:
+        // Constants set by AU_OP_SET_CONST may still be unset when the
+        // loop starts
+        return !AU_BA_GET_BIT(set_consts, read_u16(bc, pos + 2));
+    case AU_OP_MOV_LOCAL_REG: {
+        const uint16_t local = read_u16(bc, pos + 2);
+        for (size_t j = loop->head; j <= loop->tail; j++) {
+            const size_t store_pos = insns->data[j].slot * 4;
+            if (bc->data[store_pos] == AU_OP_MOV_REG_LOCAL &&
+                read_u16(bc, store_pos + 2) == local)
+                return 0;
+        }
+        return 1;
+    }
+    default:
+        return 0;
+    }
+}
+
+/// Moves loads of loop-invariant values into new registers, which are
+/// loaded in front of the outermost loop that the value is invariant in
+static void hoist_invariant_loads(struct au_bc_storage *bcs,
+                                  const struct insn_array *insns,
+                                  const struct loop_array *loops,
+                                  const char *set_consts,
+                                  struct hoisted_load_array *hoisted,
+                                  struct reg_rename_array *renames,
+                                  char *deleted) {
+    const struct au_bc_buf *bc = &bcs->bc;
+    for (size_t i = 0; i < insns->len; i++) {
+        size_t loop_idx = NO_INSN;
+        for (size_t j = 0; j < loops->len; j++) {
+            const struct loop *loop = &loops->data[j];
+            if (!insn_in_loop(loop, i) ||
+                !is_invariant_load(bc, insns, loop, i, set_consts))
+                continue;
+            if (loop_idx == NO_INSN ||
+                loop->head < loops->data[loop_idx].head)
+                loop_idx = j;
+        }
+        if (loop_idx == NO_INSN)
+            continue;
+
+        struct reg_rename_array uses = (struct reg_rename_array){0};
+        if (!find_block_uses(bc, insns, i, &uses) || uses.len == 0) {
+            au_data_free(uses.data);
+            continue;
+        }
+
+        const size_t pos = insns->data[i].slot * 4;
+        struct hoisted_load load = (struct hoisted_load){
+            .loop_idx = loop_idx,
+            .op = bc->data[pos],
+            .arg = bc->data[pos + 1],
+            .val = read_u16(bc, pos + 2),
+        };
+        if (load.op == AU_OP_MOV_BOOL)
+            load.val = 0;
+        else
+            load.arg = 0;
+        size_t load_idx = 0;
+        for (; load_idx < hoisted->len; load_idx++) {
+            const struct hoisted_load *other = &hoisted->data[load_idx];
+            if (other->loop_idx == load.loop_idx &&
+                other->op == load.op && other->arg == load.arg &&
+                other->val == load.val)
+                break;
+        }
+        if (load_idx == hoisted->len) {
+            const int reg = bcs->num_registers + (int)hoisted->len;
+            if (reg >= AU_REGS) {
+                au_data_free(uses.data);
+                return;
+            }
+            load.reg = reg;
+            hoisted_load_array_add(hoisted, load);
+        }
+
+        for (size_t j = 0; j < uses.len; j++) {
+            struct reg_rename rename = uses.data[j];
+            rename.from = insns->data[i].dest;
+            rename.to = hoisted->data[load_idx].reg;
+            reg_rename_array_add(renames, rename);
+        }
+        au_data_free(uses.data);
+        deleted[i] = 1;
+    }
+}
+
+static void emit_hoisted_load(struct au_bc_buf *out,
+                              const struct hoisted_load *load) {
+    switch (load->op) {
+    case AU_OP_MOV_BOOL: {
+        emit_insn(out, load->op, load->arg, load->reg, 0);
+        break;
+    }
+    case AU_OP_LOAD_NIL: {
+        emit_insn(out, load->op, load->reg, 0, 0);
+        break;
+    }
+    default: {
+        emit_insn_u16(out, load->op, load->reg, load->val);
+        break;
+    }
+    }
+}
+
+/// Rebuilds the bytecode of a function with the hoisted loads in front
+/// of their loops
+/// @return 1 on success, 0 if a jump offset can't be encoded
+static int rebuild_bc(struct au_bc_storage *bcs,
+                      struct au_program_data *p_data,
+                      const struct insn_array *insns,
+                      const struct loop_array *loops,
+                      const struct hoisted_load_array *hoisted,
+                      const struct reg_rename_array *renames,
+                      const char *deleted) {
+    const struct au_bc_buf *bc = &bcs->bc;
+    const size_t num_slots = (bc->len + 3) / 4;
+    struct au_bc_buf out = (struct au_bc_buf){0};
+    size_t *new_pos = au_data_calloc(num_slots + 1, sizeof(size_t));
+    size_t *insn_pos = au_data_calloc(insns->len, sizeof(size_t));
+    int retval = 1;
+
+    for (size_t i = 0; i < insns->len; i++) {
+        const struct insn *insn = &insns->data[i];
+        new_pos[insn->slot] = out.len;
+        for (size_t j = 0; j < loops->len; j++) {
+            if (loops->data[j].head != i)
+                continue;
+            for (size_t k = 0; k < hoisted->len; k++) {
+                if (hoisted->data[k].loop_idx == j)
+                    emit_hoisted_load(&out, &hoisted->data[k]);
+            }
+        }
+        insn_pos[i] = out.len;
+        if (deleted[i])
+            continue;
+        for (size_t part = 0; part < insn->num_slots; part++) {
+            const size_t slot = insn->slot + part;
+            const size_t pos = out.len;
+            for (size_t k = slot * 4; k < slot * 4 + 4 && k < bc->len; k++)
+                au_bc_buf_add(&out, bc->data[k]);
+            if (part != 0)
+                new_pos[slot] = pos;
+            int offsets[3];
+            const int len = read_operands(bc, slot, part, offsets);
+            for (size_t k = 0; k < renames->len; k++) {
+                if (renames->data[k].insn != i)
+                    continue;
+                for (int o = 0; o < len; o++) {
+                    uint8_t *reg = &out.data[pos + offsets[o]];
+                    if (*reg == renames->data[k].from)
+                        *reg = renames->data[k].to;
+                }
+            }
+        }
+    }
+    new_pos[num_slots] = out.len;
+
+    for (size_t i = 0; i < insns->len; i++) {
+        const struct insn *insn = &insns->data[i];
+        if (insn->target == NO_INSN)
+            continue;
+        // Back edges skip over the loads in front of the loop
+        size_t target = new_pos[insns->data[insn->target].slot];
+        for (size_t j = 0; j < loops->len; j++) {
+            if (loops->data[j].head == insn->target &&
+                insn_in_loop(&loops->data[j], i))
+                target = insn_pos[insn->target];
+        }
+        const size_t pos = insn_pos[i];
+        const int is_backwards = out.data[pos] == AU_OP_JRELB;
+        if (is_backwards != (target <= pos)) {
+            retval = 0;
+            goto end;
+        }
+        const size_t offset =
+            is_backwards ? (pos - target) / 4 : (target - pos) / 4;
+        if (offset > UINT16_MAX) {
+            retval = 0;
+            goto end;
+        }
+        au_replace_bc_u16(&out, pos + 2, offset);
+    }
+
+    const struct au_parser_sm_insert_array no_inserts =
+        (struct au_parser_sm_insert_array){0};
+    au_parser_relocate_source_map(p_data, bcs->func_idx, new_pos,
+                                  &no_inserts);
+    au_data_free(bcs->bc.data);
+    bcs->bc = out;
+    bcs->num_registers += hoisted->len;
+    bcs->num_values = bcs->num_registers + bcs->num_locals;
+
+end:
+    if (!retval)
+        au_data_free(out.data);
+    au_data_free(new_pos);
+    au_data_free(insn_pos);
+    return retval;
+}
+
+static void optimize_loops(struct au_bc_storage *bcs,
+                           struct au_program_data *p_data,
+                           const char *set_consts) {
+    int has_loop = 0;
+    for (size_t pos = 0; pos + 4 <= bcs->bc.len; pos += 4) {
+        if (bcs->bc.data[pos] == AU_OP_JRELB) {
+            has_loop = 1;
+            break;
+        }
+    }
+    if (!has_loop)
+        return;
+
+    const size_t num_slots = (bcs->bc.len + 3) / 4;
+    struct insn_array insns = (struct insn_array){0};
+    size_t *insn_at = au_data_calloc(num_slots + 1, sizeof(size_t));
+    struct loop_array loops = (struct loop_array){0};
+    struct hoisted_load_array hoisted = (struct hoisted_load_array){0};
+    struct reg_rename_array renames = (struct reg_rename_array){0};
+    char *deleted = 0;
+
+    if (!analyze_insns(bcs, p_data, &insns, insn_at))
+        goto end;
+    find_loops(&bcs->bc, &insns, &loops);
+    if (loops.len == 0)
+        goto end;
+
+    for (size_t i = 0; i < loops.len; i++)
+        specialize_induction_vars(&bcs->bc, &insns, &loops.data[i]);
+
+    deleted = au_data_calloc(insns.len, 1);
+    hoist_invariant_loads(bcs, &insns, &loops, set_consts, &hoisted,
+                          &renames, deleted);
+    if (hoisted.len > 0)
+        rebuild_bc(bcs, p_data, &insns, &loops, &hoisted, &renames,
+                   deleted);
+
+end:
+    au_data_free(insns.data);
+    au_data_free(insn_at);
+    au_data_free(loops.data);
+    au_data_free(hoisted.data);
+    au_data_free(renames.data);
+    au_data_free(deleted);
+}
+
+static void mark_set_consts(const struct au_bc_storage *bcs,
+                            char *set_consts) {
+    for (size_t pos = 0; pos + 4 <= bcs->bc.len; pos += 4) {
+        if (bcs->bc.data[pos] == AU_OP_SET_CONST)
+            AU_BA_SET_BIT(set_consts, read_u16(&bcs->bc, pos + 2));
+    }
+}
+
+void au_parser_optimize_loops(struct au_program *program) {
+    struct au_program_data *p_data = &program->data;
+
+    char *set_consts = au_data_calloc(AU_BA_LEN(UINT16_MAX + 1), 1);
+    mark_set_consts(&program->main, set_consts);
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        const struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type == AU_FN_BC)
+            mark_set_consts(&fn->as.bc_func, set_consts);
+    }
+
+    for (size_t i = 0; i < p_data->fns.len; i++) {
+        struct au_fn *fn = &p_data->fns.data[i];
+        if (fn->type == AU_FN_BC)
+            optimize_loops(&fn->as.bc_func, p_data, set_consts);
+    }
+    optimize_loops(&program->main, p_data, set_consts);
+
+    au_data_free(set_consts);
+}
@@ -0,0 +1,16 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+
+#pragma once
+
+#include "def.h"
+
+/// [func] Optimizes the loops of every bytecode function in a program.
+///     Loads of loop-invariant values are hoisted in front of the loop,
+///     and arithmetic on integer induction variables is emitted as
+///     int-specialized instructions.
+/// @param program the program to be optimized
+AU_PRIVATE void au_parser_optimize_loops(struct au_program *program);
@@ -5,8 +5,11 @@
 // See LICENSE.txt for license information
 
 #include "bc.h"
+#include "bc_pass.h"
 #include "def.h"
 #include "expr.h"
+#include "inline.h"
+#include "loop.h"
 #include "regs.h"
 #include "stmt.h"
 
@@ -34,6 +37,8 @@ void au_parser_init(struct au_parser *p, struct au_program_data *p_data) {
     p->self_fill_call = (struct size_t_array){0};
     p->self_num_args = 0;
     p->self_flags = 0;
+    p->last_call_offset = 0;
+    p->last_call_end = 0;
     p->func_idx = AU_SM_FUNC_ID_MAIN;
 
     p->class_interface = 0;
@@ -119,6 +124,9 @@ struct au_parser_result au_parse(const char *src, size_t len,
 
     program->main = p_main;
     program->data = p_data;
+    au_parser_inline_program(program);
+    au_parser_optimize_loops(program);
+    au_parser_sort_source_map(program);
 
     au_lexer_del(&l);
     au_parser_del(&p);
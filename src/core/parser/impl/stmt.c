@@ -471,7 +471,7 @@ int au_parser_exec_func_statement(struct au_parser *p, struct au_lexer *l,
                            tok.len, bcs.num_args);
         if (old != NULL)
             RAISE_DUPLICATE_ARG(tok);
-        func_p.local_placement++;
+        au_parser_bump_local(&func_p);
         EXPECT_BYTECODE(func_p.local_placement < AU_MAX_LOCALS);
         bcs.num_args++;
     });
@@ -855,6 +855,16 @@ int au_parser_exec_return_statement(struct au_parser *p,
         return 0;
     const uint8_t reg = au_parser_pop_reg(p);
 
+    if (p->last_call_end == p->bc.len &&
+        p->bc.data[p->last_call_offset] == AU_OP_CALL &&
+        p->bc.data[p->last_call_offset + 1] == reg) {
+        // OPTIMIZE: the returned value comes straight from a function
+        // call, so the VM can reuse the current frame for the callee.
+        // The return instruction is still emitted below, in case the
+        // call can't be done in place.
+        p->bc.data[p->last_call_offset] = AU_OP_TAIL_CALL;
+    }
+
     if (p->bc.len > 4 &&
         (p->bc.data[p->bc.len - 4] == AU_OP_MOV_LOCAL_REG &&
          p->bc.data[p->bc.len - 3] == reg)) {
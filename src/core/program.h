@@ -26,12 +26,20 @@ struct au_program_data_val {
 AU_ARRAY_COPY(struct au_program_data_val, au_program_data_vals, 1)
 
 #define AU_SM_FUNC_ID_MAIN ((size_t)-1)
+#define AU_SM_NO_PARENT ((size_t)-1)
 
 struct au_program_source_map {
     size_t bc_from;
     size_t bc_to;
     size_t source_start;
     size_t func_idx;
+    /// Index of the innermost entry of the same function that contains
+    /// this entry, or AU_SM_NO_PARENT. Only valid once the program has
+    /// been parsed.
+    size_t parent;
+    /// Set if this entry spans the body of an inlined function. In this
+    /// case, source_start points to the statement containing the call.
+    int inlined_call;
 };
 
 AU_ARRAY_STRUCT(struct au_program_source_map, au_program_source_map_array,
@@ -11,13 +11,8 @@
 #include "../value_array.h"
 #endif
 
-struct au_obj_array {
-    struct au_struct header;
-    struct au_value_array array;
-};
-
-AU_THREAD_LOCAL struct au_struct_vdata au_obj_array_vdata;
-static AU_THREAD_LOCAL int au_obj_array_vdata_inited = 0;
+struct au_struct_vdata au_obj_array_vdata;
+static int au_obj_array_vdata_inited = 0;
 static void au_obj_array_vdata_init() {
     if (!au_obj_array_vdata_inited) {
         au_obj_array_vdata = (struct au_struct_vdata){
@@ -40,22 +35,108 @@ struct au_obj_array *au_obj_array_new(size_t capacity) {
     obj_array->array.data = au_value_calloc(capacity);
     obj_array->array.len = 0;
     obj_array->array.cap = capacity;
+    obj_array->shared = 0;
     return obj_array;
 }
 
+/// Releases an array's use of shared elements, freeing them if no other
+/// array uses them
+static void shared_release(struct au_obj_array_shared *shared) {
+    shared->rc--;
+    if (shared->rc != 0)
+        return;
+    for (size_t i = 0; i < shared->len; i++) {
+        au_value_deref(shared->data[i]);
+    }
+    au_data_free(shared->data);
+    au_data_free(shared);
+}
+
 void au_obj_array_del(struct au_obj_array *obj_array) {
+    if (obj_array->shared != 0) {
+        shared_release(obj_array->shared);
+        return;
+    }
     for (size_t i = 0; i < obj_array->array.len; i++) {
         au_value_deref(obj_array->array.data[i]);
     }
     au_data_free(obj_array->array.data);
 }
 
+/// Creates an array that uses a range of the elements of another array
+static struct au_obj_array *share(struct au_obj_array *obj_array,
+                                  size_t start, size_t len) {
+    struct au_obj_array_shared *shared = obj_array->shared;
+    if (shared == 0) {
+        shared = au_data_malloc(sizeof(struct au_obj_array_shared));
+        shared->rc = 1;
+        shared->data = obj_array->array.data;
+        shared->len = obj_array->array.len;
+        obj_array->shared = shared;
+    }
+    shared->rc++;
+
+    struct au_obj_array *view = au_obj_malloc(
+        sizeof(struct au_obj_array), (au_obj_del_fn_t)au_obj_array_del);
+    view->header = (struct au_struct){
+        .vdata = &au_obj_array_vdata,
+    };
+    view->array.data = &obj_array->array.data[start];
+    view->array.len = len;
+    view->array.cap = len;
+    view->shared = shared;
+    return view;
+}
+
+struct au_obj_array *au_obj_array_copy(struct au_obj_array *obj_array) {
+    return share(obj_array, 0, obj_array->array.len);
+}
+
+struct au_obj_array *au_obj_array_slice(struct au_obj_array *obj_array,
+                                        size_t start, size_t end) {
+    const size_t len = end - start;
+    const size_t buffer_len = obj_array->shared != 0
+                                  ? obj_array->shared->len
+                                  : obj_array->array.len;
+    if (len * AU_OBJ_ARRAY_MAX_VIEW_RATIO >= buffer_len)
+        return share(obj_array, start, len);
+    // Small slices are copied, so that they don't keep a large buffer
+    // alive after the array is freed
+    struct au_obj_array *slice = au_obj_array_new(len);
+    for (size_t i = start; i < end; i++)
+        au_obj_array_push(slice, obj_array->array.data[i]);
+    return slice;
+}
+
+void au_obj_array_unshare(struct au_obj_array *obj_array) {
+    struct au_obj_array_shared *shared = obj_array->shared;
+    obj_array->shared = 0;
+    // The last user of the whole buffer takes it over
+    if (shared->rc == 1 && shared->data == obj_array->array.data &&
+        shared->len == obj_array->array.len) {
+        au_data_free(shared);
+        return;
+    }
+    const size_t len = obj_array->array.len;
+    const size_t cap = len > 0 ? len : 1;
+    au_value_t *data = au_value_calloc(cap);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = obj_array->array.data[i];
+        au_value_ref(data[i]);
+    }
+    obj_array->array.data = data;
+    obj_array->array.cap = cap;
+    shared_release(shared);
+}
+
 void au_obj_array_push(struct au_obj_array *obj_array, au_value_t el) {
+    if (AU_UNLIKELY(obj_array->shared != 0))
+        au_obj_array_unshare(obj_array);
     au_value_ref(el);
     au_value_array_add(&obj_array->array, el);
 }
 
-int au_obj_array_insert(struct au_obj_array *obj_array, int32_t idx,
+int au_obj_array_insert(struct au_obj_array *obj_array, int64_t idx,
                         au_value_t el) {
     if ((size_t)idx == obj_array->array.len) {
         au_obj_array_push(obj_array, el);
@@ -63,6 +144,8 @@ int au_obj_array_insert(struct au_obj_array *obj_array, int32_t idx,
     } else if ((size_t)idx > obj_array->array.len) {
         return 0;
     }
+    if (AU_UNLIKELY(obj_array->shared != 0))
+        au_obj_array_unshare(obj_array);
     au_value_ref(el);
     au_value_array_add(&obj_array->array, au_value_none());
     memmove(&obj_array->array.data[idx + 1], &obj_array->array.data[idx],
@@ -74,6 +157,8 @@ int au_obj_array_insert(struct au_obj_array *obj_array, int32_t idx,
 au_value_t au_obj_array_pop(struct au_obj_array *obj_array) {
     if (obj_array->array.len == 0)
         return au_value_none();
+    if (AU_UNLIKELY(obj_array->shared != 0))
+        au_obj_array_unshare(obj_array);
     return obj_array->array.data[--obj_array->array.len];
 }
 
@@ -81,25 +166,16 @@ int au_obj_array_get(struct au_obj_array *obj_array,
                      const au_value_t idx_val, au_value_t *result) {
     if (AU_UNLIKELY(au_value_get_type(idx_val) != AU_VALUE_INT))
         return 0;
-    const size_t idx = au_value_get_int(idx_val);
-    if (AU_UNLIKELY(idx >= obj_array->array.len))
-        return 0;
-    au_value_ref(obj_array->array.data[idx]);
-    *result = obj_array->array.data[idx];
-    return 1;
+    return au_obj_array_get_int(obj_array, au_value_get_int(idx_val),
+                                result);
 }
 
 int au_obj_array_set(struct au_obj_array *obj_array, au_value_t idx_val,
                      au_value_t value) {
     if (AU_UNLIKELY(au_value_get_type(idx_val) != AU_VALUE_INT))
         return 0;
-    const size_t idx = au_value_get_int(idx_val);
-    if (AU_UNLIKELY(idx >= obj_array->array.len))
-        return 0;
-    au_value_ref(value);
-    obj_array->array.data[idx] = value;
-    au_value_deref(obj_array->array.data[idx]);
-    return 1;
+    return au_obj_array_set_int(obj_array, au_value_get_int(idx_val),
+                                value);
 }
 
 int32_t au_obj_array_len(struct au_obj_array *obj_array) {
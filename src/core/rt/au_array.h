@@ -8,6 +8,8 @@
 #include "platform/platform.h"
 #include "value.h"
 #include <stdlib.h>
+
+#include "../value_array.h"
 #endif
 
 struct au_obj_array;
@@ -20,7 +22,7 @@ AU_PUBLIC void au_obj_array_push(struct au_obj_array *obj_array,
                                  au_value_t el);
 
 AU_PUBLIC int au_obj_array_insert(struct au_obj_array *obj_array,
-                                  int32_t idx, au_value_t el);
+                                  int64_t idx, au_value_t el);
 
 AU_PUBLIC au_value_t au_obj_array_pop(struct au_obj_array *obj_array);
 
@@ -32,9 +34,57 @@ AU_PUBLIC int au_obj_array_set(struct au_obj_array *obj_array,
 
 AU_PUBLIC int32_t au_obj_array_len(struct au_obj_array *obj_array);
 
+/// [func] Creates a copy of an array in constant time. The copy shares
+///     the elements of the array until one of them is modified.
+/// @param obj_array the array
+/// @return the copy
+AU_PUBLIC struct au_obj_array *
+au_obj_array_copy(struct au_obj_array *obj_array);
+
+/// Slices that are this many times smaller than the elements of their
+/// array are copied instead of sharing the elements
+#define AU_OBJ_ARRAY_MAX_VIEW_RATIO 4
+
+/// [func] Creates an array from a range of another array. Large slices
+///     share the elements of the array like au_obj_array_copy, and
+///     small slices are copied.
+/// @param obj_array the array
+/// @param start index of the first element
+/// @param end index after the last element. The range must be in
+///     bounds.
+/// @return the slice
+AU_PUBLIC struct au_obj_array *
+au_obj_array_slice(struct au_obj_array *obj_array, size_t start,
+                   size_t end);
+
+/// [func] Gives an array its own copy of the elements it shares with
+///     other arrays. This must be called before modifying a shared
+///     array.
+/// @param obj_array the array
+AU_PUBLIC void au_obj_array_unshare(struct au_obj_array *obj_array);
+
 #ifdef _AUMENT_H
 AU_PUBLIC struct au_obj_array *au_obj_array_coerce(au_value_t value);
 #else
+/// Elements shared between copies of an array. Shared elements are
+/// never modified in place.
+struct au_obj_array_shared {
+    /// Number of arrays using the elements
+    uint32_t rc;
+    /// Start of the allocated buffer
+    au_value_t *data;
+    /// Number of elements referenced by the buffer
+    size_t len;
+};
+
+struct au_obj_array {
+    struct au_struct header;
+    struct au_value_array array;
+    /// The elements shared with other arrays, or NULL if the array owns
+    /// its elements
+    struct au_obj_array_shared *shared;
+};
+
 extern struct au_struct_vdata au_obj_array_vdata;
 static inline struct au_obj_array *au_obj_array_coerce(au_value_t value) {
     if (au_value_get_type(value) != AU_VALUE_STRUCT ||
@@ -42,4 +92,36 @@ static inline struct au_obj_array *au_obj_array_coerce(au_value_t value) {
         return 0;
     return (struct au_obj_array *)au_value_get_struct(value);
 }
+
+/// [func] Gets an element of an array by an unboxed index
+/// @param obj_array the array
+/// @param idx the index
+/// @param result the element, with its reference count increased
+/// @return 1 if the index is in bounds, 0 otherwise
+static inline int au_obj_array_get_int(struct au_obj_array *obj_array,
+                                       int64_t idx, au_value_t *result) {
+    if (AU_UNLIKELY((size_t)idx >= obj_array->array.len))
+        return 0;
+    au_value_ref(obj_array->array.data[idx]);
+    *result = obj_array->array.data[idx];
+    return 1;
+}
+
+/// [func] Sets an element of an array by an unboxed index
+/// @param obj_array the array
+/// @param idx the index
+/// @param value the new element
+/// @return 1 if the index is in bounds, 0 otherwise
+static inline int au_obj_array_set_int(struct au_obj_array *obj_array,
+                                       int64_t idx, au_value_t value) {
+    if (AU_UNLIKELY((size_t)idx >= obj_array->array.len))
+        return 0;
+    if (AU_UNLIKELY(obj_array->shared != 0))
+        au_obj_array_unshare(obj_array);
+    const au_value_t old_value = obj_array->array.data[idx];
+    au_value_ref(value);
+    obj_array->array.data[idx] = value;
+    au_value_deref(old_value);
+    return 1;
+}
 #endif
\ No newline at end of file
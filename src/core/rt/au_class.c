@@ -32,8 +32,8 @@ void au_class_interface_deref(struct au_class_interface *interface) {
     }
 }
 
-AU_THREAD_LOCAL struct au_struct_vdata au_obj_class_vdata;
-static AU_THREAD_LOCAL int au_obj_class_vdata_inited = 0;
+struct au_struct_vdata au_obj_class_vdata;
+static int au_obj_class_vdata_inited = 0;
 static void au_obj_class_vdata_init() {
     if (!au_obj_class_vdata_inited) {
         au_obj_class_vdata = (struct au_struct_vdata){
@@ -68,16 +68,44 @@ void au_obj_class_del(struct au_obj_class *obj_class) {
     }
 }
 
-int au_obj_class_get(AU_UNUSED struct au_obj_class *obj_class,
-                     AU_UNUSED const au_value_t idx,
-                     AU_UNUSED au_value_t *result) {
-    return 0;
+int au_class_interface_field_idx(
+    const struct au_class_interface *interface,
+    const struct au_string *name, size_t *field_idx) {
+    const au_hm_var_value_t *value =
+        au_hm_vars_get(&interface->map, name->data, name->len);
+    if (value == 0)
+        return 0;
+    *field_idx = *value;
+    return 1;
 }
 
-int au_obj_class_set(AU_UNUSED struct au_obj_class *obj_class,
-                     AU_UNUSED au_value_t idx_val,
-                     AU_UNUSED au_value_t value) {
-    return 0;
+int au_obj_class_get(struct au_obj_class *obj_class, const au_value_t idx,
+                     au_value_t *result) {
+    if (au_value_get_type(idx) != AU_VALUE_STR)
+        return 0;
+    size_t field_idx;
+    if (!au_class_interface_field_idx(obj_class->interface,
+                                      au_value_get_string(idx),
+                                      &field_idx))
+        return 0;
+    au_value_ref(obj_class->data[field_idx]);
+    *result = obj_class->data[field_idx];
+    return 1;
+}
+
+int au_obj_class_set(struct au_obj_class *obj_class, au_value_t idx_val,
+                     au_value_t value) {
+    if (au_value_get_type(idx_val) != AU_VALUE_STR)
+        return 0;
+    size_t field_idx;
+    if (!au_class_interface_field_idx(obj_class->interface,
+                                      au_value_get_string(idx_val),
+                                      &field_idx))
+        return 0;
+    au_value_ref(value);
+    au_value_deref(obj_class->data[field_idx]);
+    obj_class->data[field_idx] = value;
+    return 1;
 }
 
 int32_t au_obj_class_len(struct au_obj_class *obj_class) {
@@ -48,6 +48,16 @@ au_class_interface_ref(struct au_class_interface *interface);
 AU_PRIVATE void
 au_class_interface_deref(struct au_class_interface *interface);
 
+/// [func] Finds the index of a field of a class by its name
+/// @param interface the class
+/// @param name name of the field
+/// @param field_idx the index of the field, if it was found
+/// @return 1 if the class has the field, 0 otherwise
+AU_PUBLIC int
+au_class_interface_field_idx(const struct au_class_interface *interface,
+                             const struct au_string *name,
+                             size_t *field_idx);
+
 struct au_obj_class;
 
 AU_PUBLIC struct au_obj_class *
@@ -55,9 +65,20 @@ au_obj_class_new(const struct au_class_interface *interface);
 
 AU_PUBLIC void au_obj_class_del(struct au_obj_class *obj_class);
 
+/// [func] Gets a field of a class instance by its name
+/// @param obj_class the instance
+/// @param idx name of the field, as a string
+/// @param result the value of the field, with its reference count
+///     increased
+/// @return 1 if the instance has the field, 0 otherwise
 AU_PUBLIC int au_obj_class_get(struct au_obj_class *obj_class,
                                const au_value_t idx, au_value_t *result);
 
+/// [func] Sets a field of a class instance by its name
+/// @param obj_class the instance
+/// @param idx name of the field, as a string
+/// @param value the new value of the field
+/// @return 1 if the instance has the field, 0 otherwise
 AU_PUBLIC int au_obj_class_set(struct au_obj_class *obj_class,
                                au_value_t idx, au_value_t value);
 
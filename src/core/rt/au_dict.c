@@ -101,8 +101,8 @@ struct au_obj_dict_hm {
 };
 
 static AU_UNUSED int
-validate_psl_p(struct au_obj_dict_hm *hmap,
-               const struct au_obj_dict_bucket *bucket, uint32_t i) {
+dict_validate_psl_p(struct au_obj_dict_hm *hmap,
+                    const struct au_obj_dict_bucket *bucket, uint32_t i) {
     uint32_t base_i = fast_rem32(bucket->hash, hmap->size, hmap->divinfo);
     uint32_t diff = (base_i > i) ? hmap->size - base_i + i : i - base_i;
     return au_value_get_type(bucket->key) == AU_VALUE_NONE ||
@@ -110,11 +110,12 @@ validate_psl_p(struct au_obj_dict_hm *hmap,
 }
 
 /*
- * hm_get: lookup an value given the key.
+ * dict_hm_get: lookup an value given the key.
  *
  * => If key is present, return its associated value; otherwise NULL.
  */
-static au_value_t hm_get(struct au_obj_dict_hm *hmap, au_value_t key) {
+static au_value_t dict_hm_get(struct au_obj_dict_hm *hmap,
+                              au_value_t key) {
     const uint32_t hash = au_hash_value(key);
     uint32_t n = 0, i = fast_rem32(hash, hmap->size, hmap->divinfo);
     struct au_obj_dict_bucket *bucket;
@@ -124,7 +125,7 @@ static au_value_t hm_get(struct au_obj_dict_hm *hmap, au_value_t key) {
      */
 probe:
     bucket = &hmap->buckets[i];
-    // assert(validate_psl_p(hmap, bucket, i));
+    // assert(dict_validate_psl_p(hmap, bucket, i));
 
     if (bucket->hash == hash && value_eq(bucket->key, key)) {
         au_value_ref(bucket->val);
@@ -149,10 +150,10 @@ probe:
 }
 
 /*
- * hm_insert: internal hm_put(), without the resize.
+ * dict_hm_insert: internal dict_hm_put(), without the resize.
  */
-static void hm_insert(struct au_obj_dict_hm *hmap, au_value_t key,
-                      au_value_t val) {
+static void dict_hm_insert(struct au_obj_dict_hm *hmap, au_value_t key,
+                           au_value_t val) {
     const uint32_t hash = au_hash_value(key);
     struct au_obj_dict_bucket *bucket, entry;
     uint32_t i;
@@ -182,7 +183,7 @@ static void hm_insert(struct au_obj_dict_hm *hmap, au_value_t key,
 probe:
     bucket = &hmap->buckets[i];
     if (!is_empty_value(bucket->key)) {
-        // assert(validate_psl_p(hmap, bucket, i));
+        // assert(dict_validate_psl_p(hmap, bucket, i));
 
         /*
          * There is a key in the bucket.
@@ -212,7 +213,7 @@ probe:
         entry.psl++;
 
         /* Continue to the next bucket. */
-        // assert(validate_psl_p(hmap, bucket, i));
+        // assert(dict_validate_psl_p(hmap, bucket, i));
         i = fast_rem32(i + 1, hmap->size, hmap->divinfo);
         goto probe;
     }
@@ -223,10 +224,10 @@ probe:
     *bucket = entry; // copy
     hmap->nitems++;
 
-    // assert(validate_psl_p(hmap, bucket, i));
+    // assert(dict_validate_psl_p(hmap, bucket, i));
 }
 
-static int hm_resize(struct au_obj_dict_hm *hmap, size_t newsize) {
+static int dict_hm_resize(struct au_obj_dict_hm *hmap, size_t newsize) {
     const size_t len = newsize * sizeof(struct au_obj_dict_bucket);
     struct au_obj_dict_bucket *oldbuckets = hmap->buckets;
     const size_t oldsize = hmap->size;
@@ -265,7 +266,7 @@ static int hm_resize(struct au_obj_dict_hm *hmap, size_t newsize) {
         if (is_empty_value(bucket->key)) {
             continue;
         }
-        hm_insert(hmap, bucket->key, bucket->val);
+        dict_hm_insert(hmap, bucket->key, bucket->val);
         au_value_deref(bucket->key);
     }
     if (oldbuckets && oldbuckets != &hmap->init_bucket) {
@@ -275,13 +276,13 @@ static int hm_resize(struct au_obj_dict_hm *hmap, size_t newsize) {
 }
 
 /*
- * hm_put: insert a value given the key.
+ * dict_hm_put: insert a value given the key.
  *
  * => If the key is already present, return its associated value.
  * => Otherwise, on successful insert, return the given value.
  */
-static void hm_put(struct au_obj_dict_hm *hmap, au_value_t key,
-                   au_value_t val) {
+static void dict_hm_put(struct au_obj_dict_hm *hmap, au_value_t key,
+                        au_value_t val) {
     const size_t threshold = APPROX_85_PERCENT(hmap->size);
 
     /*
@@ -294,21 +295,21 @@ static void hm_put(struct au_obj_dict_hm *hmap, au_value_t key,
          */
         const size_t grow_limit = hmap->size + MAX_GROWTH_STEP;
         const size_t newsize = MIN(hmap->size << 1, grow_limit);
-        if (hm_resize(hmap, newsize) != 0) {
+        if (dict_hm_resize(hmap, newsize) != 0) {
             au_fatal("out of memory\n"); // TODO
         }
     }
 
-    hm_insert(hmap, key, val);
+    dict_hm_insert(hmap, key, val);
 }
 
 /*
- * hm_del: remove the given key and return its value.
+ * dict_hm_del: remove the given key and return its value.
  *
  * => If key was present, return its associated value; otherwise NULL.
  */
-static AU_UNUSED au_value_t hm_del(struct au_obj_dict_hm *hmap,
-                                   au_value_t key) {
+static AU_UNUSED au_value_t dict_hm_del(struct au_obj_dict_hm *hmap,
+                                        au_value_t key) {
     const size_t threshold = APPROX_40_PERCENT(hmap->size);
     const uint32_t hash = au_hash_value(key);
     uint32_t n = 0, i = fast_rem32(hash, hmap->size, hmap->divinfo);
@@ -323,7 +324,7 @@ probe:
     if (is_empty_value(bucket->key) || n > bucket->psl) {
         return empty_value();
     }
-    // assert(validate_psl_p(hmap, bucket, i));
+    // assert(dict_validate_psl_p(hmap, bucket, i));
 
     if (bucket->hash != hash || !value_eq(bucket->key, key)) {
         /* Continue to the next bucket. */
@@ -351,7 +352,7 @@ probe:
 
         i = fast_rem32(i + 1, hmap->size, hmap->divinfo);
         nbucket = &hmap->buckets[i];
-        // assert(validate_psl_p(hmap, nbucket, i));
+        // assert(dict_validate_psl_p(hmap, nbucket, i));
 
         /*
          * Stop if we reach an empty bucket or hit a key which
@@ -372,7 +373,7 @@ probe:
      */
     if (hmap->nitems > hmap->minsize && hmap->nitems < threshold) {
         size_t newsize = MAX(hmap->size >> 1, hmap->minsize);
-        (void)hm_resize(hmap, newsize);
+        (void)dict_hm_resize(hmap, newsize);
     }
     return val;
 }
@@ -383,20 +384,20 @@ probe:
  * => If size is non-zero, then pre-allocate the given number of buckets;
  * => If size is zero, then a default minimum is used.
  */
-static void hm_init(struct au_obj_dict_hm *hmap, size_t size) {
+static void dict_hm_init(struct au_obj_dict_hm *hmap, size_t size) {
     memset(hmap, 0, sizeof(struct au_obj_dict_hm));
     hmap->minsize = MAX(size, 1);
-    if (hm_resize(hmap, hmap->minsize) != 0) {
+    if (dict_hm_resize(hmap, hmap->minsize) != 0) {
         abort(); // TODO
     }
 }
 
 /*
- * hm_destroy: free the memory used by the hash table.
+ * dict_hm_destroy: free the memory used by the hash table.
  *
  * => It is the responsibility of the caller to remove elements if needed.
  */
-static void hm_destroy(struct au_obj_dict_hm *hmap) {
+static void dict_hm_destroy(struct au_obj_dict_hm *hmap) {
     for (uint32_t i = 0; i < hmap->size; i++) {
         const struct au_obj_dict_bucket *bucket = &hmap->buckets[i];
 
@@ -416,8 +417,8 @@ struct au_obj_dict {
     struct au_obj_dict_hm hashmap;
 };
 
-AU_THREAD_LOCAL struct au_struct_vdata au_obj_dict_vdata;
-static AU_THREAD_LOCAL int au_obj_dict_vdata_inited = 0;
+struct au_struct_vdata au_obj_dict_vdata;
+static int au_obj_dict_vdata_inited = 0;
 static void au_obj_dict_vdata_init() {
     if (!au_obj_dict_vdata_inited) {
         au_obj_dict_vdata = (struct au_struct_vdata){
@@ -437,17 +438,17 @@ struct au_obj_dict *au_obj_dict_new() {
     obj_dict->header = (struct au_struct){
         .vdata = &au_obj_dict_vdata,
     };
-    hm_init(&obj_dict->hashmap, 1);
+    dict_hm_init(&obj_dict->hashmap, 1);
     return obj_dict;
 }
 
 void au_obj_dict_del(struct au_obj_dict *obj_dict) {
-    hm_destroy(&obj_dict->hashmap);
+    dict_hm_destroy(&obj_dict->hashmap);
 }
 
 int au_obj_dict_get(struct au_obj_dict *obj_dict, const au_value_t key,
                     au_value_t *result) {
-    au_value_t get_result = hm_get(&obj_dict->hashmap, key);
+    au_value_t get_result = dict_hm_get(&obj_dict->hashmap, key);
     if (is_empty_value(get_result))
         return 0;
     *result = get_result;
@@ -456,7 +457,7 @@ int au_obj_dict_get(struct au_obj_dict *obj_dict, const au_value_t key,
 
 int au_obj_dict_set(struct au_obj_dict *obj_dict, au_value_t key,
                     au_value_t value) {
-    hm_put(&obj_dict->hashmap, key, value);
+    dict_hm_put(&obj_dict->hashmap, key, value);
     return 1;
 }
 
@@ -10,7 +10,42 @@
 #include "malloc.h"
 #endif
 
+/// Interned strings of a single byte. These are pinned, so that
+/// character-level string processing doesn't allocate.
+static AU_THREAD_LOCAL struct au_string *byte_strings[256];
+
+/// The interned empty string
+static AU_THREAD_LOCAL struct au_string *empty_string;
+
+static struct au_string *pinned_string(const char *s, size_t len) {
+    struct au_string *header =
+        au_obj_malloc(sizeof(struct au_string) + len, 0);
+    header->len = len;
+    memcpy(header->data, s, len);
+    au_obj_pin(header);
+    return header;
+}
+
+struct au_string *au_string_from_byte(char ch) {
+    struct au_string **slot = &byte_strings[(unsigned char)ch];
+    if (AU_UNLIKELY(*slot == 0))
+        *slot = pinned_string(&ch, 1);
+    au_obj_ref(*slot);
+    return *slot;
+}
+
+static struct au_string *short_string(const char *s, size_t len) {
+    if (len == 1)
+        return au_string_from_byte(s[0]);
+    if (AU_UNLIKELY(empty_string == 0))
+        empty_string = pinned_string("", 0);
+    au_obj_ref(empty_string);
+    return empty_string;
+}
+
 struct au_string *au_string_from_const(const char *s, size_t len) {
+    if (len <= 1)
+        return short_string(s, len);
     struct au_string *header =
         au_obj_malloc(sizeof(struct au_string) + len, 0);
     header->len = len;
@@ -21,6 +56,8 @@ struct au_string *au_string_from_const(const char *s, size_t len) {
 struct au_string *au_string_add(const struct au_string *left,
                                 const struct au_string *right) {
     const size_t len = left->len + right->len;
+    if (len <= 1)
+        return short_string(left->len ? left->data : right->data, len);
     struct au_string *header =
         au_obj_malloc(sizeof(struct au_string) + len, 0);
     header->len = len;
@@ -27,6 +27,12 @@ struct au_string {
 AU_PUBLIC struct au_string *au_string_from_const(const char *s,
                                                  size_t len);
 
+/// [func] Returns the string made of a single byte. These strings are
+///     interned, and never allocate after the first call.
+/// @param ch the byte
+/// @returns An au_string instance
+AU_PUBLIC struct au_string *au_string_from_byte(char ch);
+
 /// [func] Creates an au_string from concatenating 2 au_string(s)
 /// @param left First string
 /// @param right Second string
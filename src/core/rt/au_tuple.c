@@ -9,14 +9,8 @@
 #include "value.h"
 #endif
 
-struct au_obj_tuple {
-    struct au_struct header;
-    size_t len;
-    au_value_t data[];
-};
-
-AU_THREAD_LOCAL struct au_struct_vdata au_obj_tuple_vdata;
-static AU_THREAD_LOCAL int au_obj_tuple_vdata_inited = 0;
+struct au_struct_vdata au_obj_tuple_vdata;
+static int au_obj_tuple_vdata_inited = 0;
 static void au_obj_tuple_vdata_init() {
     if (!au_obj_tuple_vdata_inited) {
         au_obj_tuple_vdata = (struct au_struct_vdata){
@@ -50,12 +44,7 @@ void au_obj_tuple_del(struct au_obj_tuple *obj_tuple) {
 
 int au_obj_tuple_get(struct au_obj_tuple *obj_tuple, const au_value_t idx,
                      au_value_t *result) {
-    const size_t index = au_value_get_int(idx);
-    if (index >= obj_tuple->len)
-        return 0;
-    au_value_ref(obj_tuple->data[index]);
-    *result = obj_tuple->data[index];
-    return 1;
+    return au_obj_tuple_get_int(obj_tuple, au_value_get_int(idx), result);
 }
 
 int au_obj_tuple_set(struct au_obj_tuple *obj_tuple, au_value_t idx_val,
@@ -28,6 +28,12 @@ AU_PUBLIC int32_t au_obj_tuple_len(struct au_obj_tuple *obj_tuple);
 #ifdef _AUMENT_H
 AU_PUBLIC struct au_obj_tuple *au_obj_tuple_coerce(au_value_t value);
 #else
+struct au_obj_tuple {
+    struct au_struct header;
+    size_t len;
+    au_value_t data[];
+};
+
 extern struct au_struct_vdata au_obj_tuple_vdata;
 static inline struct au_obj_tuple *au_obj_tuple_coerce(au_value_t value) {
     if (au_value_get_type(value) != AU_VALUE_STRUCT ||
@@ -35,4 +41,18 @@ static inline struct au_obj_tuple *au_obj_tuple_coerce(au_value_t value) {
         return 0;
     return (struct au_obj_tuple *)au_value_get_struct(value);
 }
+
+/// [func] Gets an element of a tuple by an unboxed index
+/// @param obj_tuple the tuple
+/// @param idx the index
+/// @param result the element, with its reference count increased
+/// @return 1 if the index is in bounds, 0 otherwise
+static inline int au_obj_tuple_get_int(struct au_obj_tuple *obj_tuple,
+                                       int64_t idx, au_value_t *result) {
+    if (AU_UNLIKELY((size_t)idx >= obj_tuple->len))
+        return 0;
+    au_value_ref(obj_tuple->data[idx]);
+    *result = obj_tuple->data[idx];
+    return 1;
+}
 #endif
\ No newline at end of file
@@ -12,6 +12,7 @@
 #endif
 
 void au_fatal(const char *fmt, ...) {
+    fflush(stdout);
     va_list args;
     va_start(args, fmt);
     vfprintf(stderr, fmt, args);
@@ -18,11 +18,51 @@ typedef au_value_t (*au_extern_func_t)(struct au_vm_thread_local *tl,
 
 typedef au_value_t (*au_compiled_func_t)(const au_value_t *args);
 
+/// Signature of the typed fast path of a native function
+enum au_lib_func_sig {
+    /// The function has no fast path
+    AU_LIB_FUNC_SIG_NONE = 0,
+    /// double (*)(double)
+    AU_LIB_FUNC_SIG_D_D,
+    /// double (*)(double, double)
+    AU_LIB_FUNC_SIG_D_DD,
+    /// int64_t (*)(int64_t)
+    AU_LIB_FUNC_SIG_I_I,
+    /// int64_t (*)(int64_t, int64_t)
+    AU_LIB_FUNC_SIG_I_II,
+};
+
+/// [func] Returns the number of arguments a fast path signature takes
+static inline int32_t au_lib_func_sig_num_args(enum au_lib_func_sig sig) {
+    switch (sig) {
+    case AU_LIB_FUNC_SIG_D_D:
+    case AU_LIB_FUNC_SIG_I_I:
+        return 1;
+    case AU_LIB_FUNC_SIG_D_DD:
+    case AU_LIB_FUNC_SIG_I_II:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+/// Typed fast path of a native function. It must be cast to the type
+///     described by its au_lib_func_sig before it is called.
+typedef void (*au_extern_fast_func_t)(void);
+
 struct au_lib_func {
     int32_t num_args;
     au_extern_func_t func;
     const char *name;
     const char *symbol;
+    /// Signature of fast_func. The fast path is only called when every
+    ///     argument already has the type given by the signature;
+    ///     otherwise func is called.
+    enum au_lib_func_sig fast_sig;
+    au_extern_fast_func_t fast_func;
+    /// Symbol of fast_func used by the C compiler, or NULL if compiled
+    ///     programs should call func instead
+    const char *fast_symbol;
 };
 
 #define AU_EXTERN_FUNC_DECL(NAME)                                         \
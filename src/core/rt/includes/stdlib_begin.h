@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <limits.h>
 #include <stdalign.h>
 #include <stdarg.h>
 #include <stddef.h>
@@ -6,6 +8,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 #ifdef AU_FEAT_LIBDL
 #include <dlfcn.h>
 #endif
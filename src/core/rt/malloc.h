@@ -18,6 +18,11 @@ AU_PUBLIC void au_malloc_init();
 AU_PUBLIC void au_malloc_set_collect(int do_collect);
 AU_PUBLIC size_t au_malloc_heap_size();
 
+// [func] Adds data allocated by another thread, which the current thread
+// now owns, to the current thread's heap size. size is the change in the
+// other thread's au_malloc_heap_size.
+AU_PUBLIC void au_malloc_adopt_heap_size(size_t size);
+
 // ** objects **
 
 AU_PUBLIC void au_obj_malloc_collect();
@@ -33,6 +38,10 @@ AU_PUBLIC void au_obj_free(void *ptr);
 AU_PUBLIC void au_obj_ref(void *ptr);
 AU_PUBLIC void au_obj_deref(void *ptr);
 
+// [func] Keeps an object alive until the program exits. The object can
+// still be referenced and dereferenced, but it is never freed.
+AU_PUBLIC void au_obj_pin(void *ptr);
+
 // ** data **
 
 AU_PUBLIC __attribute__((malloc)) void *au_data_malloc(size_t size);
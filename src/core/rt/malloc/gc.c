@@ -75,6 +75,12 @@ void au_malloc_set_collect(int do_collect) {
 
 size_t au_malloc_heap_size() { return malloc_data.heap_size; }
 
+void au_malloc_adopt_heap_size(size_t size) {
+    // size_t arithmetic wraps around, so this stays correct even if the
+    // other thread freed more than it allocated
+    malloc_data.heap_size += size;
+}
+
 static void collect_if_needed(size_t size) {
     if (malloc_data.do_collect &&
         malloc_data.heap_size + size > malloc_data.heap_threshold) {
@@ -216,6 +222,27 @@ void au_obj_deref(void *ptr) {
     }
 }
 
+void au_obj_pin(void *ptr) {
+    // Unlinked objects are never collected
+    struct au_obj_malloc_header *header = PTR_TO_OBJ_HEADER(ptr);
+    struct au_obj_malloc_header *prev = 0;
+    struct au_obj_malloc_header *cur = malloc_data.obj_list;
+    while (cur != 0) {
+        if (cur == header) {
+            if (prev) {
+                prev->next = cur->next;
+            } else {
+                malloc_data.obj_list = cur->next;
+            }
+            cur->next = 0;
+            malloc_data.heap_size -= cur->size;
+            return;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+}
+
 // ** data **
 
 void *au_data_malloc(size_t size) {
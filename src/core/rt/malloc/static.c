@@ -17,6 +17,7 @@
 void au_malloc_init() {}
 void au_malloc_set_collect(int collect) { (void)collect; }
 size_t au_malloc_heap_size() { return 0; }
+void au_malloc_adopt_heap_size(size_t size) { (void)size; }
 
 // ** objects **
 
@@ -79,6 +80,12 @@ void au_obj_deref(void *ptr) {
         au_obj_free(ptr);
 }
 
+void au_obj_pin(void *ptr) {
+    // Far enough from zero that dereferencing never frees the object
+    struct au_obj_malloc_header *header = PTR_TO_OBJ_HEADER(ptr);
+    header->rc = MAX_RC / 2;
+}
+
 // ** data **
 
 void *au_data_malloc(size_t size) { return malloc(size); }
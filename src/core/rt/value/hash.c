@@ -3,8 +3,10 @@
 //
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
+#ifdef AU_IS_INTERPRETER
 #include "core/hash.h"
 #include "main.h"
+#endif
 
 uint32_t au_hash_value(au_value_t key) {
 #ifdef AU_USE_NAN_TAGGING
@@ -27,8 +29,10 @@ uint32_t au_hash_value(au_value_t key) {
         return 2;
     }
     case AU_VALUE_INT: {
-        int32_t value = au_value_get_int(key);
-        return au_hash_u32((uint32_t)value);
+        const int64_t value = au_value_get_int(key);
+        if (value == (int32_t)value)
+            return au_hash_u32((uint32_t)value);
+        return au_hash_u64((uint64_t)value);
     }
     case AU_VALUE_BOOL: {
         return au_value_get_bool(key);
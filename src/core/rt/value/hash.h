@@ -3,7 +3,9 @@
 //
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
+#ifdef AU_IS_INTERPRETER
 #pragma once
 #include "main.h"
+#endif
 
 uint32_t au_hash_value(au_value_t key);
\ No newline at end of file
@@ -43,7 +43,7 @@ typedef union {
 } au_value_t;
 #else
 union au_value_data {
-    int32_t d_int;
+    int64_t d_int;
     void *d_ptr;
     double d_double;
 };
@@ -57,8 +57,10 @@ typedef struct _au_value au_value_t;
 static enum au_vtype au_value_get_type(const au_value_t v);
 static au_value_t au_value_none();
 static au_value_t au_value_error();
-static au_value_t au_value_int(int32_t n);
-static int32_t au_value_get_int(const au_value_t v);
+/// [func] Creates an integer value. Integers outside of the range
+///     [AU_INT_MIN, AU_INT_MAX] are wrapped into it.
+static au_value_t au_value_int(int64_t n);
+static int64_t au_value_get_int(const au_value_t v);
 static au_value_t au_value_double(double n);
 static double au_value_get_double(const au_value_t v);
 static au_value_t au_value_bool(int32_t n);
@@ -114,15 +116,15 @@ static AU_ALWAYS_INLINE au_value_t au_value_none() {
     return v;
 }
 
-static AU_ALWAYS_INLINE au_value_t au_value_int(int32_t n) {
+static AU_ALWAYS_INLINE au_value_t au_value_int(int64_t n) {
     au_value_t v;
     v._raw = AU_REPR_BOXED(AU_VALUE_INT, (uint64_t)n);
     return v;
 }
-static AU_ALWAYS_INLINE int32_t au_value_get_int(const au_value_t v) {
+static AU_ALWAYS_INLINE int64_t au_value_get_int(const au_value_t v) {
     if (au_value_get_type(v) != AU_VALUE_INT)
         abort();
-    return (int32_t)(AU_REPR_GET_POINTER(v._raw));
+    return au_platform_iwrap((int64_t)AU_REPR_GET_POINTER(v._raw));
 }
 
 static AU_ALWAYS_INLINE au_value_t au_value_double(double n) {
@@ -217,13 +219,13 @@ static AU_ALWAYS_INLINE int au_value_is_error(au_value_t v) {
     return AU_UNLIKELY(v._type == AU_VALUE_ERROR);
 }
 
-static AU_ALWAYS_INLINE au_value_t au_value_int(int32_t n) {
+static AU_ALWAYS_INLINE au_value_t au_value_int(int64_t n) {
     au_value_t v = {0};
     v._type = AU_VALUE_INT;
-    v._data.d_int = n;
+    v._data.d_int = au_platform_iwrap(n);
     return v;
 }
-static AU_ALWAYS_INLINE int32_t au_value_get_int(const au_value_t v) {
+static AU_ALWAYS_INLINE int64_t au_value_get_int(const au_value_t v) {
     if (au_value_get_type(v) != AU_VALUE_INT)
         abort();
     return v._data.d_int;
@@ -331,9 +333,13 @@ static AU_ALWAYS_INLINE au_value_t au_value_add(au_value_t lhs,
     switch (au_value_get_type(lhs)) {
     case AU_VALUE_INT: {
         switch (au_value_get_type(rhs)) {
-        case AU_VALUE_INT:
-            return au_value_int(au_platform_iadd_wrap(
-                au_value_get_int(lhs), au_value_get_int(rhs)));
+        case AU_VALUE_INT: {
+            int64_t res;
+            if (AU_UNLIKELY(au_platform_iadd_overflow(
+                    au_value_get_int(lhs), au_value_get_int(rhs), &res)))
+                return au_value_error();
+            return au_value_int(res);
+        }
         case AU_VALUE_DOUBLE:
             return au_value_double((double)au_value_get_int(lhs) +
                                    au_value_get_double(rhs));
@@ -370,9 +376,13 @@ static AU_ALWAYS_INLINE au_value_t au_value_sub(au_value_t lhs,
     switch (au_value_get_type(lhs)) {
     case AU_VALUE_INT: {
         switch (au_value_get_type(rhs)) {
-        case AU_VALUE_INT:
-            return au_value_int(au_platform_isub_wrap(
-                au_value_get_int(lhs), au_value_get_int(rhs)));
+        case AU_VALUE_INT: {
+            int64_t res;
+            if (AU_UNLIKELY(au_platform_isub_overflow(
+                    au_value_get_int(lhs), au_value_get_int(rhs), &res)))
+                return au_value_error();
+            return au_value_int(res);
+        }
         case AU_VALUE_DOUBLE:
             return au_value_double((double)au_value_get_int(lhs) -
                                    au_value_get_double(rhs));
@@ -403,9 +413,13 @@ static AU_ALWAYS_INLINE au_value_t au_value_mul(au_value_t lhs,
     switch (au_value_get_type(lhs)) {
     case AU_VALUE_INT: {
         switch (au_value_get_type(rhs)) {
-        case AU_VALUE_INT:
-            return au_value_int(au_platform_imul_wrap(
-                au_value_get_int(lhs), au_value_get_int(rhs)));
+        case AU_VALUE_INT: {
+            int64_t res;
+            if (AU_UNLIKELY(au_platform_imul_overflow(
+                    au_value_get_int(lhs), au_value_get_int(rhs), &res)))
+                return au_value_error();
+            return au_value_int(res);
+        }
         case AU_VALUE_DOUBLE:
             return au_value_double((double)au_value_get_int(lhs) *
                                    au_value_get_double(rhs));
@@ -501,7 +515,11 @@ static AU_ALWAYS_INLINE au_value_t au_value_bshl(au_value_t lhs,
     if (AU_UNLIKELY(au_value_get_type(lhs) != AU_VALUE_INT ||
                     au_value_get_type(rhs) != AU_VALUE_INT))
         return au_value_error();
-    return au_value_int(au_value_get_int(lhs) << au_value_get_int(rhs));
+    int64_t res;
+    if (AU_UNLIKELY(au_platform_ishl_overflow(
+            au_value_get_int(lhs), au_value_get_int(rhs), &res)))
+        return au_value_error();
+    return au_value_int(res);
 }
 
 static AU_ALWAYS_INLINE au_value_t au_value_bshr(au_value_t lhs,
@@ -521,7 +539,11 @@ static AU_ALWAYS_INLINE au_value_t au_value_bnot(au_value_t value) {
 static AU_ALWAYS_INLINE au_value_t au_value_neg(au_value_t value) {
     if (AU_UNLIKELY(au_value_get_type(value) != AU_VALUE_INT))
         return au_value_error();
-    return au_value_int(-au_value_get_int(value));
+    int64_t res;
+    if (AU_UNLIKELY(
+            au_platform_isub_overflow(0, au_value_get_int(value), &res)))
+        return au_value_error();
+    return au_value_int(res);
 }
 
 #define _BIN_OP_BOOL_GENERIC(NAME, OP)                                    \
@@ -600,6 +622,9 @@ static AU_ALWAYS_INLINE au_value_t au_value_neq(au_value_t lhs,
     if (AU_UNLIKELY(au_value_get_type(lhs) != au_value_get_type(rhs)))
         return au_value_bool(1);
     switch (au_value_get_type(lhs)) {
+    case AU_VALUE_NONE: {
+        return au_value_bool(0);
+    }
     case AU_VALUE_INT: {
         return au_value_bool(au_value_get_int(lhs) !=
                              au_value_get_int(rhs));
@@ -618,4 +643,13 @@ static AU_ALWAYS_INLINE au_value_t au_value_neq(au_value_t lhs,
     return au_value_bool(1);
 }
 
+/// [func] Prints a value to stdout
+/// @param value the value to be printed
 void au_value_print(au_value_t value);
+
+/// [func] Sets up the buffering of stdout for au_value_print. If stdout
+///     isn't a terminal, it is fully buffered with a buffer large enough
+///     that printing many short values takes few system calls. Terminals
+///     are left line buffered. This must be called before anything is
+///     written to stdout.
+void au_value_print_init();
@@ -5,30 +5,52 @@
 // See LICENSE.txt for license information
 #ifdef AU_IS_INTERPRETER
 #include "main.h"
+#include "platform/fmt.h"
 #include <stdio.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#endif
+
+#define AU_PRINT_BUFFER_SIZE 65536
+
+void au_value_print_init() {
+#ifdef _WIN32
+    const int is_tty = _isatty(_fileno(stdout));
+#else
+    const int is_tty = isatty(fileno(stdout));
 #endif
+    if (!is_tty)
+        setvbuf(stdout, 0, _IOFBF, AU_PRINT_BUFFER_SIZE);
+}
 
 void au_value_print(au_value_t value) {
     switch (au_value_get_type(value)) {
     case AU_VALUE_NONE: {
-        printf("(none)");
+        fputs("(none)", stdout);
         break;
     }
     case AU_VALUE_INT: {
-        printf("%d", au_value_get_int(value));
+        char buf[AU_FMT_INT_MAX_LEN];
+        fwrite(buf, 1, au_fmt_int(au_value_get_int(value), buf), stdout);
         break;
     }
     case AU_VALUE_DOUBLE: {
-        printf("%g", au_value_get_double(value));
+        char buf[AU_FMT_DOUBLE_MAX_LEN];
+        fwrite(buf, 1, au_fmt_double(au_value_get_double(value), buf),
+               stdout);
         break;
     }
     case AU_VALUE_BOOL: {
-        printf("%s", au_value_get_bool(value) ? "(true)" : "(false)");
+        fputs(au_value_get_bool(value) ? "(true)" : "(false)", stdout);
         break;
     }
     case AU_VALUE_STR: {
         struct au_string *str = au_value_get_string(value);
-        printf("%.*s", str->len, str->data);
+        fwrite(str->data, 1, str->len, stdout);
         break;
     }
     case AU_VALUE_STRUCT: {
@@ -36,7 +58,7 @@ void au_value_print(au_value_t value) {
         break;
     }
     default: {
-        printf("(unknown)");
+        fputs("(unknown)", stdout);
         break;
     }
     }
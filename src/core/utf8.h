@@ -4,8 +4,16 @@
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "platform/platform.h"
 
@@ -85,33 +93,210 @@ static inline AU_UNUSED const char *utf8_next(const char *s,
     return s;
 }
 
-static inline AU_UNUSED const char *utf8_str(const char *h,
-                                             const char *h_max,
-                                             const char *n,
-                                             const char *n_max) {
-    while (h != h_max) {
-        const char *maybe_match = h;
+/// Needles at least this long are searched for with the two-way
+///     algorithm, whose running time doesn't depend on how often the
+///     needle's first and last bytes occur in the haystack
+#define UTF8_STR_TWO_WAY_MIN 64
+
+/// Checks if p is at the start of a code point or at the end of the
+///     string
+static inline AU_UNUSED int utf8_is_boundary(const char *p,
+                                             const char *max) {
+    return p == max || (*p & 0xc0) != 0x80;
+}
+
+/// Checks if a match of needle_len bytes at p starts and ends at code
+///     point boundaries
+static inline AU_UNUSED int
+utf8_is_match_boundary(const char *p, size_t needle_len, const char *max) {
+    return utf8_is_boundary(p, max) &&
+           utf8_is_boundary(p + needle_len, max);
+}
 
-        while (*h == *n && (h != h_max && n != n_max)) {
-            n++;
-            h++;
+/// Searches for the needle by comparing its first and last bytes with
+///     every position of the haystack, and only comparing the rest of
+///     the needle on candidates. n_len must be at least 2.
+static inline AU_UNUSED const char *utf8_str_filter(const char *h,
+                                                    size_t h_len,
+                                                    const char *n,
+                                                    size_t n_len) {
+    const char *h_max = &h[h_len];
+    size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+#define UTF8_VEC __m256i
+#define UTF8_VEC_SIZE 32
+#define UTF8_VEC_SPLAT(x) _mm256_set1_epi8(x)
+#define UTF8_VEC_MATCHES(first, last, h_first, h_last)                   \
+    (uint32_t) _mm256_movemask_epi8(                                      \
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, h_first),               \
+                         _mm256_cmpeq_epi8(last, h_last)))
+#define UTF8_VEC_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#else
+#define UTF8_VEC __m128i
+#define UTF8_VEC_SIZE 16
+#define UTF8_VEC_SPLAT(x) _mm_set1_epi8(x)
+#define UTF8_VEC_MATCHES(first, last, h_first, h_last)                   \
+    (uint32_t) _mm_movemask_epi8(_mm_and_si128(                           \
+        _mm_cmpeq_epi8(first, h_first), _mm_cmpeq_epi8(last, h_last)))
+#define UTF8_VEC_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#endif
+    const UTF8_VEC first = UTF8_VEC_SPLAT(n[0]);
+    const UTF8_VEC last = UTF8_VEC_SPLAT(n[n_len - 1]);
+    while (i + n_len - 1 + UTF8_VEC_SIZE <= h_len) {
+        const UTF8_VEC h_first = UTF8_VEC_LOAD(&h[i]);
+        const UTF8_VEC h_last = UTF8_VEC_LOAD(&h[i + n_len - 1]);
+        uint32_t mask = UTF8_VEC_MATCHES(first, last, h_first, h_last);
+        while (mask != 0) {
+            const size_t pos = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(&h[pos + 1], &n[1], n_len - 2) == 0 &&
+                utf8_is_match_boundary(&h[pos], n_len, h_max))
+                return &h[pos];
+            mask &= mask - 1;
         }
+        i += UTF8_VEC_SIZE;
+    }
+#undef UTF8_VEC
+#undef UTF8_VEC_SIZE
+#undef UTF8_VEC_SPLAT
+#undef UTF8_VEC_MATCHES
+#undef UTF8_VEC_LOAD
+#endif
+    while (i + n_len <= h_len) {
+        const char *candidate = memchr(&h[i], n[0], h_len - n_len - i + 1);
+        if (candidate == 0)
+            return 0;
+        if (candidate[n_len - 1] == n[n_len - 1] &&
+            memcmp(&candidate[1], &n[1], n_len - 2) == 0 &&
+            utf8_is_match_boundary(candidate, n_len, h_max))
+            return candidate;
+        i = (size_t)(candidate - h) + 1;
+    }
+    return 0;
+}
 
-        if (n == n_max) {
-            // we found the whole utf8 string for needle in haystack at
-            // maybeMatch, so return it
-            return maybe_match;
+/// Returns the start of the maximal suffix of the needle, and its
+///     period, with bytes ordered by < if reverse is 0, and by >
+///     otherwise
+static inline AU_UNUSED ptrdiff_t utf8_max_suffix(const uint8_t *n,
+                                                  ptrdiff_t n_len,
+                                                  ptrdiff_t *period,
+                                                  int reverse) {
+    ptrdiff_t ms = -1, j = 0, k = 1;
+    *period = 1;
+    while (j + k < n_len) {
+        const uint8_t a = n[j + k], b = n[ms + k];
+        if (a == b) {
+            if (k != *period) {
+                k++;
+            } else {
+                j += *period;
+                k = 1;
+            }
+        } else if ((a < b) != reverse) {
+            j += k;
+            k = 1;
+            *period = j - ms;
         } else {
-            // h could be in the middle of an unmatching utf8 codepoint,
-            // so we need to march it on to the next character beginning
-            // starting from the current character
-            int throwaway;
-            h = (const char *)utf8_next(h, h_max, &throwaway);
-            if (h == 0)
-                return 0;
+            ms = j;
+            j = ms + 1;
+            k = *period = 1;
         }
     }
+    return ms;
+}
 
-    // no match
+/// Searches for the needle with the two-way string matching algorithm
+///     by Crochemore and Perrin, which runs in linear time and constant
+///     space
+static inline AU_UNUSED const char *utf8_str_two_way(const char *h,
+                                                     size_t h_len,
+                                                     const char *n,
+                                                     size_t n_len) {
+    const uint8_t *y = (const uint8_t *)h, *x = (const uint8_t *)n;
+    const char *h_max = &h[h_len];
+    const ptrdiff_t m = (ptrdiff_t)n_len, hl = (ptrdiff_t)h_len;
+
+    ptrdiff_t p, q;
+    const ptrdiff_t i_lt = utf8_max_suffix(x, m, &p, 0);
+    const ptrdiff_t i_gt = utf8_max_suffix(x, m, &q, 1);
+    ptrdiff_t ell, per;
+    if (i_lt > i_gt) {
+        ell = i_lt;
+        per = p;
+    } else {
+        ell = i_gt;
+        per = q;
+    }
+
+    ptrdiff_t i, j = 0;
+    if (memcmp(x, x + per, (size_t)(ell + 1)) == 0) {
+        // The needle is periodic, so the part of it that was matched
+        // before a shift by the period doesn't need to be compared again
+        ptrdiff_t memory = -1;
+        while (j <= hl - m) {
+            i = (ell > memory ? ell : memory) + 1;
+            while (i < m && x[i] == y[i + j])
+                i++;
+            if (i >= m) {
+                i = ell;
+                while (i > memory && x[i] == y[i + j])
+                    i--;
+                if (i <= memory &&
+                    utf8_is_match_boundary(&h[j], n_len, h_max))
+                    return &h[j];
+                j += per;
+                memory = m - per - 1;
+            } else {
+                j += i - ell;
+                memory = -1;
+            }
+        }
+    } else {
+        per = (ell + 1 > m - ell - 1 ? ell + 1 : m - ell - 1) + 1;
+        while (j <= hl - m) {
+            i = ell + 1;
+            while (i < m && x[i] == y[i + j])
+                i++;
+            if (i >= m) {
+                i = ell;
+                while (i >= 0 && x[i] == y[i + j])
+                    i--;
+                if (i < 0 && utf8_is_match_boundary(&h[j], n_len, h_max))
+                    return &h[j];
+                j += per;
+            } else {
+                j += i - ell;
+            }
+        }
+    }
     return 0;
 }
+
+/// Finds the first occurrence of the needle [n, n_max) in the haystack
+///     [h, h_max) which starts and ends at code point boundaries
+/// @return the start of the occurrence, or NULL if there isn't one
+static inline AU_UNUSED const char *utf8_str(const char *h,
+                                             const char *h_max,
+                                             const char *n,
+                                             const char *n_max) {
+    const size_t h_len = (size_t)(h_max - h);
+    const size_t n_len = (size_t)(n_max - n);
+    if (n_len == 0)
+        return h != h_max ? h : 0;
+    if (n_len > h_len)
+        return 0;
+    if (n_len == 1) {
+        const char *found = h;
+        while ((found = memchr(found, n[0], (size_t)(h_max - found))) !=
+               0) {
+            if (utf8_is_match_boundary(found, 1, h_max))
+                return found;
+            found++;
+        }
+        return 0;
+    }
+    if (n_len >= UTF8_STR_TWO_WAY_MIN)
+        return utf8_str_two_way(h, h_len, n, n_len);
+    return utf8_str_filter(h, h_len, n, n_len);
+}
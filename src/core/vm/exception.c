@@ -7,16 +7,82 @@
 #include "os/mmap.h"
 #include "vm.h"
 
+/// Finds the innermost entry among a function's source map entries that
+/// contains the instruction at pc, or returns AU_SM_NO_PARENT
+static size_t locate_entry(const size_t pc,
+                           const struct au_program_source_map *source_map,
+                           size_t start, size_t len) {
+    const struct au_program_source_map *maps = &source_map[start];
+
+    // Find the last entry that starts at or before pc
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (maps[mid].bc_from <= pc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return AU_SM_NO_PARENT;
+
+    // The entry may end before pc, in which case pc lies in one of the
+    // entries enclosing it
+    size_t idx = start + lo - 1;
+    while (idx != AU_SM_NO_PARENT && pc >= source_map[idx].bc_to)
+        idx = source_map[idx].parent;
+    return idx;
+}
+
 size_t au_vm_locate_error(const size_t pc, const struct au_bc_storage *bcs,
                           const struct au_program_data *p_data) {
-    for (size_t i = 0; i < p_data->source_map.len; i++) {
-        const struct au_program_source_map map =
-            p_data->source_map.data[i];
-        if (map.func_idx == bcs->func_idx && map.bc_from <= pc &&
-            pc <= map.bc_to) {
-            return map.source_start;
+    const size_t idx =
+        locate_entry(pc, p_data->source_map.data, bcs->source_map_start,
+                     bcs->source_map_len);
+    if (idx == AU_SM_NO_PARENT)
+        return 0;
+    return p_data->source_map.data[idx].source_start;
+}
+
+/// Returns the source position of a frame, and appends an item for every
+/// inlined call containing it
+static size_t resolve_frame(const struct au_vm_trace_frame *frame,
+                            struct au_vm_trace_item_array *backtrace) {
+    size_t idx = locate_entry(frame->pc, frame->source_map,
+                              frame->source_map_start,
+                              frame->source_map_len);
+    const size_t pos = idx == AU_SM_NO_PARENT
+                           ? 0
+                           : frame->source_map[idx].source_start;
+    while (idx != AU_SM_NO_PARENT) {
+        const struct au_program_source_map *map = &frame->source_map[idx];
+        if (map->inlined_call) {
+            struct au_vm_trace_item item;
+            item.file = frame->file;
+            item.pos = map->source_start;
+            au_vm_trace_item_array_add(backtrace, item);
         }
+        idx = map->parent;
     }
+    return pos;
+}
 
-    return 0;
+struct au_interpreter_result
+au_vm_resolve_error(const struct au_vm_thread_local *tl,
+                    struct au_vm_trace_item_array *backtrace) {
+    struct au_interpreter_result result = tl->error.result;
+    if (tl->error.frame.file != 0)
+        result.pos = resolve_frame(&tl->error.frame, backtrace);
+    for (size_t i = 0; i < tl->backtrace.len; i++) {
+        const struct au_vm_trace_frame *frame = &tl->backtrace.data[i];
+        struct au_vm_trace_item item;
+        item.file = frame->file;
+        item.pos = 0;
+        // The item is added before the inlined calls of the frame
+        const size_t idx = backtrace->len;
+        au_vm_trace_item_array_add(backtrace, item);
+        const size_t pos = resolve_frame(frame, backtrace);
+        backtrace->data[idx].pos = pos;
+    }
+    return result;
 }
@@ -11,6 +11,7 @@ struct au_vm_thread_local;
 struct au_bc_storage;
 struct au_program_data;
 struct au_vm_frame;
+struct au_vm_trace_item_array;
 
 #define X(NAME) AU_INT_ERR_##NAME
 enum au_interpreter_result_type {
@@ -27,6 +28,7 @@ enum au_interpreter_result_type {
     X(UNKNOWN_CONST) = 10,
     X(WRONG_ARGS) = 11,
     X(RAISED_ERROR) = 12,
+    X(INT_OVERFLOW) = 13,
 };
 #undef X
 
@@ -59,6 +61,22 @@ struct au_interpreter_result {
     enum au_interpreter_result_type type;
 };
 
+/// [func] Locates the statement containing an instruction
+/// @param pc offset of the instruction
+/// @param bcs bytecode storage of the function
+/// @param p_data program data
+/// @return the source position of the innermost statement containing
+///     the instruction, or 0 if there is none
 AU_PRIVATE size_t au_vm_locate_error(const size_t pc,
                                      const struct au_bc_storage *bcs,
-                                     const struct au_program_data *p_data);
\ No newline at end of file
+                                     const struct au_program_data *p_data);
+
+/// [func] Looks up the source positions of the current error and of the
+///     calls it propagated through
+/// @param tl the current thread
+/// @param backtrace array the backtrace is appended to, innermost call
+///     first. Calls that were inlined get their own items.
+/// @return the error, with its source position filled in
+AU_PRIVATE struct au_interpreter_result
+au_vm_resolve_error(const struct au_vm_thread_local *tl,
+                    struct au_vm_trace_item_array *backtrace);
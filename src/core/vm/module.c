@@ -5,14 +5,17 @@
 // See LICENSE.txt for license information
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
 #include <errhandlingapi.h>
+#include <fileapi.h>
 #include <libloaderapi.h>
 #include <sys/stat.h>
 #define AU_MODULE_LIB_EXT ".dll"
 #else
+#include <limits.h>
 #include <sys/stat.h>
 #define AU_MODULE_LIB_EXT ".so"
 #ifdef AU_FEAT_LIBDL
@@ -78,8 +81,28 @@ void au_module_lib_perror() {
 #endif
 }
 
-int au_module_resolve(struct au_module_resolve_result *result,
-                      const char *import_path, const char *parent_dir) {
+/// Canonicalizes an absolute path, so that a module imported through
+/// different relative paths (./a.au and ../dir/a.au) is only loaded once.
+/// Paths that don't exist are returned as they are, and fail to import
+/// later on.
+static char *canonicalize_path(char *path) {
+#ifdef _WIN32
+    char buf[MAX_PATH];
+    const DWORD len = GetFullPathNameA(path, MAX_PATH, buf, 0);
+    if (len == 0 || len >= MAX_PATH)
+        return path;
+#else
+    char buf[PATH_MAX];
+    if (realpath(path, buf) == 0)
+        return path;
+#endif
+    au_data_free(path);
+    return au_data_strdup(buf);
+}
+
+int au_module_resolve_lexical(struct au_module_resolve_result *result,
+                              const char *import_path,
+                              const char *parent_dir) {
     const char *canon_path = 0;
     if (import_path[0] == '.' && import_path[1] == '/') {
         canon_path = &import_path[2];
@@ -125,6 +148,14 @@ int au_module_resolve(struct au_module_resolve_result *result,
     return 1;
 }
 
+int au_module_resolve(struct au_module_resolve_result *result,
+                      const char *import_path, const char *parent_dir) {
+    if (!au_module_resolve_lexical(result, import_path, parent_dir))
+        return 0;
+    result->abspath = canonicalize_path(result->abspath);
+    return 1;
+}
+
 typedef struct au_program_data *module_load_fn_ret_t;
 
 #ifdef _WIN32
@@ -170,6 +201,13 @@ fail:
     return 0;
 }
 
+int au_module_is_source(const struct au_module_resolve_result *resolved) {
+    const size_t abspath_len = strlen(resolved->abspath);
+    return !endswith(resolved->abspath, abspath_len,
+                     AU_MODULE_UNIV_LIB_EXT) &&
+           !endswith(resolved->abspath, abspath_len, AU_MODULE_LIB_EXT);
+}
+
 enum au_module_import_result
 au_module_import(struct au_module *module,
                  const struct au_module_resolve_result *resolved) {
@@ -41,6 +41,13 @@ AU_PUBLIC int au_module_resolve(struct au_module_resolve_result *result,
                                 const char *import_path,
                                 const char *parent_dir);
 
+/// [func] Resolves an import path like au_module_resolve, without
+///     canonicalizing the absolute path. The result only depends on
+///     import_path and parent_dir, and not on the file system.
+AU_PRIVATE int
+au_module_resolve_lexical(struct au_module_resolve_result *result,
+                          const char *import_path, const char *parent_dir);
+
 enum au_module_import_result {
     AU_MODULE_IMPORT_SUCCESS = 0,
     AU_MODULE_IMPORT_SUCCESS_NO_MODULE = 1,
@@ -50,6 +57,11 @@ enum au_module_import_result {
 
 AU_PRIVATE void au_module_lib_perror();
 
+/// [func] Checks if a resolved module is an aument source file rather
+///     than a native library
+AU_PRIVATE int
+au_module_is_source(const struct au_module_resolve_result *resolved);
+
 AU_PUBLIC enum au_module_import_result
 au_module_import(struct au_module *module,
                  const struct au_module_resolve_result *resolved);
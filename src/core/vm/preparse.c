@@ -0,0 +1,220 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/array.h"
+#include "core/hm_vars.h"
+#include "core/int_error/error_printer.h"
+#include "core/parser/parser.h"
+#include "core/program.h"
+#include "core/rt/malloc.h"
+#include "core/str_array.h"
+#include "os/mmap.h"
+#include "os/path.h"
+#include "os/thread.h"
+
+#include "module.h"
+#include "preparse.h"
+#include "tl.h"
+
+struct preparse_job {
+    char *abspath;
+    /// Lexically resolved paths the module is imported with
+    struct au_str_array import_paths;
+    struct au_program program;
+    int parsed;
+    /// Source of a module that failed to parse, kept for the error
+    struct au_mmap_info mmap;
+    int mapped;
+    struct au_parser_result parse_res;
+};
+
+AU_ARRAY_COPY(struct preparse_job *, preparse_job_array, 1)
+
+/// Queues the source modules imported by p_data that haven't been
+/// seen before, and records the paths they are imported with
+static void add_imports(struct preparse_job_array *jobs,
+                        struct au_hm_vars *seen,
+                        const struct au_program_data *p_data,
+                        const char *cwd) {
+    for (size_t i = 0; i < p_data->imports.len; i++) {
+        const struct au_program_import *import =
+            &p_data->imports.data[i];
+        struct au_module_resolve_result resolved;
+        if (!au_module_resolve(&resolved, import->path, cwd))
+            continue;
+        if (resolved.subpath != 0 || !au_module_is_source(&resolved)) {
+            au_module_resolve_result_del(&resolved);
+            continue;
+        }
+        struct au_module_resolve_result lexical;
+        if (!au_module_resolve_lexical(&lexical, import->path, cwd))
+            abort();
+
+        struct preparse_job *job;
+        const au_hm_var_value_t *old_idx =
+            au_hm_vars_add(seen, resolved.abspath,
+                           strlen(resolved.abspath), jobs->len);
+        if (old_idx != 0) {
+            job = jobs->data[*old_idx];
+        } else {
+            job = au_data_calloc(1, sizeof(struct preparse_job));
+            job->abspath = resolved.abspath;
+            resolved.abspath = 0;
+            preparse_job_array_add(jobs, job);
+        }
+        au_module_resolve_result_del(&resolved);
+
+        au_str_array_add(&job->import_paths, lexical.abspath);
+        lexical.abspath = 0;
+        au_module_resolve_result_del(&lexical);
+    }
+}
+
+static void parse_job(struct preparse_job *job) {
+    if (!au_mmap_read(job->abspath, &job->mmap))
+        return;
+    job->mapped = 1;
+    job->parse_res =
+        au_parse(job->mmap.bytes, job->mmap.size, &job->program);
+    job->parsed = job->parse_res.type == AU_PARSER_RES_OK;
+    if (job->parsed) {
+        au_mmap_del(&job->mmap);
+        job->mapped = 0;
+    }
+}
+
+struct preparse_worker {
+    struct preparse_job **jobs;
+    size_t len;
+    size_t start;
+    size_t stride;
+    struct au_thread thread;
+    int started;
+    /// Change in the heap size of the worker's thread while it parsed.
+    /// Allocations are counted per thread, so the bytes of a started
+    /// worker are handed over to the calling thread, which frees them.
+    size_t heap_size;
+};
+
+static void worker_main(void *arg) {
+    struct preparse_worker *worker = arg;
+    const size_t heap_size = au_malloc_heap_size();
+    for (size_t i = worker->start; i < worker->len; i += worker->stride)
+        parse_job(worker->jobs[i]);
+    worker->heap_size = au_malloc_heap_size() - heap_size;
+}
+
+/// Parses jobs in parallel, on at most max_threads threads
+static void parse_jobs(struct preparse_job **jobs, size_t len,
+                       size_t max_threads) {
+    const size_t num_workers = len < max_threads ? len : max_threads;
+    if (num_workers <= 1) {
+        for (size_t i = 0; i < len; i++)
+            parse_job(jobs[i]);
+        return;
+    }
+
+    struct preparse_worker *workers =
+        au_data_calloc(num_workers, sizeof(struct preparse_worker));
+    for (size_t i = 0; i < num_workers; i++) {
+        workers[i] = (struct preparse_worker){
+            .jobs = jobs,
+            .len = len,
+            .start = i,
+            .stride = num_workers,
+        };
+    }
+    // The calling thread takes the first worker's share
+    for (size_t i = 1; i < num_workers; i++) {
+        workers[i].started =
+            au_thread_start(&workers[i].thread, worker_main, &workers[i]);
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        if (!workers[i].started)
+            worker_main(&workers[i]);
+    }
+    for (size_t i = 1; i < num_workers; i++) {
+        if (workers[i].started) {
+            au_thread_join(&workers[i].thread);
+            au_malloc_adopt_heap_size(workers[i].heap_size);
+        }
+    }
+    au_data_free(workers);
+}
+
+int au_vm_preparse_imports(struct au_vm_thread_local *tl,
+                           const struct au_program_data *p_data,
+                           int print_errors) {
+    struct au_hm_vars seen = {0};
+    au_hm_vars_init(&seen);
+    struct preparse_job_array jobs = {0};
+    add_imports(&jobs, &seen, p_data, p_data->cwd);
+
+    size_t max_threads = au_thread_num_cpus();
+#ifdef AU_TEST_EXE
+    // Tests also run on machines with a single processor, and should
+    // still parse on several threads
+    if (max_threads < 4)
+        max_threads = 4;
+#endif
+    size_t depth_start = 0;
+    while (depth_start < jobs.len) {
+        const size_t depth_end = jobs.len;
+        parse_jobs(&jobs.data[depth_start], depth_end - depth_start,
+                   max_threads);
+        for (size_t i = depth_start; i < depth_end; i++) {
+            const struct preparse_job *job = jobs.data[i];
+            if (!job->parsed)
+                continue;
+            char *file = 0, *cwd = 0;
+            if (!au_split_path(job->abspath, &file, &cwd))
+                continue;
+            add_imports(&jobs, &seen, &job->program.data, cwd);
+            au_data_free(file);
+            au_data_free(cwd);
+        }
+        depth_start = depth_end;
+    }
+
+    int success = 1;
+    for (size_t i = 0; i < jobs.len; i++) {
+        struct preparse_job *job = jobs.data[i];
+        if (job->parsed) {
+            struct au_program *program =
+                au_data_malloc(sizeof(struct au_program));
+            memcpy(program, &job->program, sizeof(struct au_program));
+            au_vm_thread_local_add_preparsed(tl, job->abspath, program);
+            for (size_t j = 0; j < job->import_paths.len; j++)
+                au_vm_thread_local_add_preparsed_import(
+                    tl, job->import_paths.data[j], job->abspath);
+        } else {
+            success = 0;
+            if (print_errors && job->mapped) {
+                au_print_parser_error(job->parse_res,
+                                      (struct au_error_location){
+                                          .src = job->mmap.bytes,
+                                          .len = job->mmap.size,
+                                          .path = job->abspath,
+                                      });
+            } else if (print_errors) {
+                fprintf(stderr, "unable to read %s\n", job->abspath);
+            }
+        }
+        if (job->mapped)
+            au_mmap_del(&job->mmap);
+        for (size_t j = 0; j < job->import_paths.len; j++)
+            au_data_free(job->import_paths.data[j]);
+        au_data_free(job->import_paths.data);
+        au_data_free(job->abspath);
+        au_data_free(job);
+    }
+    au_data_free(jobs.data);
+    au_hm_vars_del(&seen);
+    return success;
+}
@@ -0,0 +1,26 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#pragma once
+
+#include "platform/platform.h"
+
+struct au_vm_thread_local;
+struct au_program_data;
+
+/// [func] Parses every source module that a program imports, directly
+///     or through other modules, before the program is executed.
+///     Modules at the same depth of the import graph are parsed in
+///     parallel. The parsed modules are stored in tl, and AU_OP_IMPORT
+///     takes them instead of parsing the module itself. Modules that
+///     fail to parse are skipped, so that AU_OP_IMPORT reports the
+///     error when it reaches them.
+/// @param tl the thread local instance the program will be executed with
+/// @param p_data the program's data
+/// @param print_errors whether to print why modules failed to parse
+/// @return 1 if every imported source module was parsed
+AU_PRIVATE int au_vm_preparse_imports(struct au_vm_thread_local *tl,
+                                      const struct au_program_data *p_data,
+                                      int print_errors);
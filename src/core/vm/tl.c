@@ -35,6 +35,8 @@ void au_vm_thread_local_init(struct au_vm_thread_local *tl,
     }
     tl->print_fn = au_value_print;
     au_hm_vars_init(&tl->loaded_modules_map);
+    au_hm_vars_init(&tl->preparsed_modules_map);
+    au_hm_vars_init(&tl->preparsed_imports_map);
     tl->stack_max = (size_t)-1;
 }
 
@@ -49,6 +51,19 @@ void au_vm_thread_local_del(struct au_vm_thread_local *tl) {
         au_data_free(ptr);
     }
     au_data_free(tl->loaded_modules.data);
+    au_hm_vars_del(&tl->preparsed_modules_map);
+    for (size_t i = 0; i < tl->preparsed_modules.len; i++) {
+        struct au_program *ptr = tl->preparsed_modules.data[i];
+        if (ptr == 0)
+            continue;
+        au_program_del(ptr);
+        au_data_free(ptr);
+    }
+    au_data_free(tl->preparsed_modules.data);
+    for (size_t i = 0; i < tl->preparsed_paths.len; i++)
+        au_data_free(tl->preparsed_paths.data[i]);
+    au_data_free(tl->preparsed_paths.data);
+    au_hm_vars_del(&tl->preparsed_imports_map);
     au_data_free(tl->backtrace.data);
     memset(tl, 0, sizeof(struct au_vm_thread_local));
 }
@@ -105,6 +120,52 @@ au_vm_thread_local_get_module(const struct au_vm_thread_local *tl,
     return au_program_data_array_at(&tl->loaded_modules, *value);
 }
 
+void au_vm_thread_local_add_preparsed(struct au_vm_thread_local *tl,
+                                      const char *abspath,
+                                      struct au_program *program) {
+    au_hm_var_value_t value = tl->preparsed_modules.len;
+    if (au_hm_vars_add(&tl->preparsed_modules_map, abspath,
+                       strlen(abspath), value) != 0)
+        abort();
+    au_program_array_add(&tl->preparsed_modules, program);
+    au_str_array_add(&tl->preparsed_paths, au_data_strdup(abspath));
+}
+
+void au_vm_thread_local_add_preparsed_import(
+    struct au_vm_thread_local *tl, const char *import_path,
+    const char *abspath) {
+    const au_hm_var_value_t *value = au_hm_vars_get(
+        &tl->preparsed_modules_map, abspath, strlen(abspath));
+    if (value == 0)
+        abort();
+    au_hm_vars_add(&tl->preparsed_imports_map, import_path,
+                   strlen(import_path), *value);
+}
+
+const char *
+au_vm_thread_local_get_preparsed_path(const struct au_vm_thread_local *tl,
+                                      const char *import_path) {
+    const au_hm_var_value_t *value =
+        au_hm_vars_get(&tl->preparsed_imports_map, import_path,
+                       strlen(import_path));
+    if (value == 0)
+        return 0;
+    return au_str_array_at(&tl->preparsed_paths, *value);
+}
+
+struct au_program *
+au_vm_thread_local_take_preparsed(struct au_vm_thread_local *tl,
+                                  const char *abspath) {
+    const au_hm_var_value_t *value = au_hm_vars_get(
+        &tl->preparsed_modules_map, abspath, strlen(abspath));
+    if (value == 0)
+        return 0;
+    struct au_program *program =
+        au_program_array_at(&tl->preparsed_modules, *value);
+    au_program_array_set(&tl->preparsed_modules, *value, 0);
+    return program;
+}
+
 void au_vm_thread_local_install_stdlib(struct au_vm_thread_local *tl) {
     for (size_t i = 0; i < au_stdlib_modules_len; i++) {
         au_program_data_array_add(&tl->stdlib_modules,
@@ -11,6 +11,7 @@
 #include "core/hm_vars.h"
 #include "core/int_error/error_location.h"
 #include "core/rt/value.h"
+#include "core/str_array.h"
 #include "core/vm/exception.h"
 #include "core/vm/frame_link.h"
 
@@ -21,9 +22,33 @@ typedef void (*au_vm_print_fn_t)(au_value_t);
 struct au_program_data;
 AU_ARRAY_COPY(struct au_program_data *, au_program_data_array, 1)
 
+struct au_program;
+AU_ARRAY_COPY(struct au_program *, au_program_array, 1)
+
+struct au_program_source_map;
+
+/// Location of an error, or of a call it propagated through. Source
+/// positions are only looked up once the error is printed (see
+/// au_vm_resolve_error), so errors that get caught stay cheap.
+struct au_vm_trace_frame {
+    /// File of the frame's program, or NULL if there is no frame
+    const char *file;
+    /// Source map of the frame's program
+    const struct au_program_source_map *source_map;
+    /// Source map entries of the frame's function
+    size_t source_map_start;
+    size_t source_map_len;
+    /// Offset of the instruction that raised the error or made the call
+    size_t pc;
+};
+AU_ARRAY_COPY(struct au_vm_trace_frame, au_vm_trace_frame_array, 1)
+
 struct au_vm_trace_main {
     const char *file;
     struct au_interpreter_result result;
+    /// Where the error was raised. If the frame's file is NULL,
+    /// result.pos is used instead.
+    struct au_vm_trace_frame frame;
 };
 
 struct au_vm_trace_item {
@@ -39,11 +64,20 @@ struct au_vm_thread_local {
     struct au_hm_vars loaded_modules_map;
     struct au_program_data_array loaded_modules;
     struct au_program_data_array stdlib_modules;
+    /// Imported modules parsed ahead of execution (see
+    ///     au_vm_preparse_imports), indexed by their absolute path
+    struct au_hm_vars preparsed_modules_map;
+    struct au_program_array preparsed_modules;
+    /// Absolute paths of the preparsed modules
+    struct au_str_array preparsed_paths;
+    /// Indices of preparsed modules, by the lexically resolved paths
+    ///     (see au_module_resolve_lexical) they are imported with
+    struct au_hm_vars preparsed_imports_map;
     struct au_vm_frame_link current_frame;
     uintptr_t stack_start;
     size_t stack_max;
     struct au_vm_trace_main error;
-    struct au_vm_trace_item_array backtrace;
+    struct au_vm_trace_frame_array backtrace;
 };
 
 /// [func] Gets the current thread's au_vm_thread_local instance
@@ -87,5 +121,47 @@ AU_PRIVATE struct au_program_data *
 au_vm_thread_local_get_module(const struct au_vm_thread_local *tl,
                               const char *abspath);
 
+/// [func] Stores a module parsed ahead of execution
+/// @param tl the thread local instance
+/// @param abspath absolute path of the module
+/// @param program the parsed module. tl takes ownership of it.
+AU_PRIVATE void
+au_vm_thread_local_add_preparsed(struct au_vm_thread_local *tl,
+                                 const char *abspath,
+                                 struct au_program *program);
+
+/// [func] Takes a module stored by au_vm_thread_local_add_preparsed
+/// @param tl the thread local instance
+/// @param abspath absolute path of the module
+/// @return the parsed module, which the caller now owns, or NULL if
+///     the module wasn't parsed ahead of execution
+AU_PRIVATE struct au_program *
+au_vm_thread_local_take_preparsed(struct au_vm_thread_local *tl,
+                                  const char *abspath);
+
+/// [func] Records that a module stored by
+///     au_vm_thread_local_add_preparsed is imported through a path,
+///     so that importing it doesn't need to resolve the path on the
+///     file system
+/// @param tl the thread local instance
+/// @param import_path the import's path, resolved by
+///     au_module_resolve_lexical
+/// @param abspath absolute path of the module
+AU_PRIVATE void
+au_vm_thread_local_add_preparsed_import(struct au_vm_thread_local *tl,
+                                        const char *import_path,
+                                        const char *abspath);
+
+/// [func] Gets the absolute path of a preparsed module from the path
+///     of an import of it
+/// @param tl the thread local instance
+/// @param import_path the import's path, resolved by
+///     au_module_resolve_lexical
+/// @return the module's absolute path, or NULL if no preparsed module
+///     is imported through import_path
+AU_PRIVATE const char *
+au_vm_thread_local_get_preparsed_path(const struct au_vm_thread_local *tl,
+                                      const char *import_path);
+
 AU_PUBLIC void
 au_vm_thread_local_install_stdlib(struct au_vm_thread_local *tl);
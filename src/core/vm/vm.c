@@ -163,8 +163,20 @@ end:
 
 // * Error functions *
 
+static struct au_interpreter_result int_overflow_error() {
+    return (struct au_interpreter_result){
+        .type = AU_INT_ERR_INT_OVERFLOW,
+        .pos = 0,
+    };
+}
+
+/// Operations on 2 integers only fail if their result overflows, so
+/// these are reported as integer overflows
 static struct au_interpreter_result bin_op_error(au_value_t left,
                                                  au_value_t right) {
+    if (au_value_get_type(left) == AU_VALUE_INT &&
+        au_value_get_type(right) == AU_VALUE_INT)
+        return int_overflow_error();
     au_value_ref(left);
     au_value_ref(right);
     return (struct au_interpreter_result){
@@ -234,13 +246,56 @@ static au_value_t extract_error_value(struct au_vm_thread_local *tl) {
     tl->error.file = 0;
     tl->error.result.type = AU_INT_ERR_OK;
     tl->error.result.pos = 0;
-    au_data_free(tl->backtrace.data);
-    tl->backtrace.data = 0;
+    tl->error.frame.file = 0;
+    // The backtrace's memory is kept for the next error
     tl->backtrace.len = 0;
-    tl->backtrace.cap = 0;
     return retval;
 }
 
+/// Looks up a field through the inline cache of an instruction when the
+/// cached class or field name doesn't match
+static AU_NO_INLINE int field_cache_miss(struct au_field_cache *cache,
+                                         const struct au_obj_class *obj,
+                                         struct au_string *name,
+                                         size_t *field_idx) {
+    if (cache->interface == obj->interface && cache->name != 0 &&
+        au_string_cmp(cache->name, name) == 0) {
+        // Same field, but the name was built at runtime
+        *field_idx = cache->field_idx;
+    } else if (!au_class_interface_field_idx(obj->interface, name,
+                                             field_idx)) {
+        return 0;
+    }
+    au_obj_ref(name);
+    if (cache->name != 0)
+        au_obj_deref(cache->name);
+    cache->interface = obj->interface;
+    cache->name = name;
+    cache->field_idx = *field_idx;
+    return 1;
+}
+
+/// Looks up the index of a class field by its name, using the inline
+/// cache of the instruction at offset pos
+static AU_ALWAYS_INLINE int
+field_cache_lookup(const struct au_bc_storage *bcs, size_t pos,
+                   const struct au_obj_class *obj, struct au_string *name,
+                   size_t *field_idx) {
+    if (AU_UNLIKELY(bcs->field_caches == 0)) {
+        // Bytecode storage is mutated the same way quickened
+        // instructions are
+        ((struct au_bc_storage *)bcs)->field_caches =
+            au_data_calloc(bcs->bc.len / 4, sizeof(struct au_field_cache));
+    }
+    struct au_field_cache *cache = &bcs->field_caches[pos / 4];
+    if (AU_LIKELY(cache->interface == obj->interface &&
+                  cache->name == name)) {
+        *field_idx = cache->field_idx;
+        return 1;
+    }
+    return field_cache_miss(cache, obj, name, field_idx);
+}
+
 // * Implementation *
 
 au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
@@ -272,6 +327,11 @@ au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
     }
 #endif
 
+    // The size of the frame. This can be larger than the size of the
+    // function being executed if a tail call reuses the frame
+    const int frame_num_registers = bcs->num_registers;
+    const int frame_num_locals = bcs->num_locals;
+
 #ifdef AU_USE_ALLOCA
     au_value_t *alloca_values = 0;
     if (AU_LIKELY(bcs->num_values < ALLOCA_MAX_VALUES)) {
@@ -309,13 +369,23 @@ au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
 #define DEF_BC16(VAR, OFFSET)                                             \
     const uint16_t VAR = *((uint16_t *)(&bc[OFFSET]))
 
+// Source positions are looked up by au_vm_resolve_error once the error
+// is printed
+#define TRACE_FRAME(PC)                                                   \
+    ((struct au_vm_trace_frame){                                          \
+        .file = p_data->file,                                             \
+        .source_map = p_data->source_map.data,                            \
+        .source_map_start = bcs->source_map_start,                        \
+        .source_map_len = bcs->source_map_len,                            \
+        .pc = (PC),                                                       \
+    })
+
 #define RAISE(ERROR)                                                      \
     do {                                                                  \
         FLUSH_BC();                                                       \
         tl->error.file = p_data->file;                                    \
         tl->error.result = (ERROR);                                       \
-        const size_t pc = frame.bc - frame.bc_start;                      \
-        tl->error.result.pos = au_vm_locate_error(pc, bcs, p_data);       \
+        tl->error.frame = TRACE_FRAME(frame.bc - frame.bc_start);         \
         frame.retval = au_value_error();                                  \
         goto end;                                                         \
     } while (0)
@@ -323,16 +393,14 @@ au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
 #define RAISE_BT()                                                        \
     do {                                                                  \
         FLUSH_BC();                                                       \
-        const size_t pc = frame.bc - frame.bc_start;                      \
+        /* pc points past the call instruction */                         \
+        const size_t pc = frame.bc - frame.bc_start - 1;                  \
         if (tl->error.result.type == 0) {                                 \
             tl->error.file = p_data->file;                                \
             tl->error.result.type = AU_INT_ERR_INCOMPAT_CALL;             \
-            tl->error.result.pos = au_vm_locate_error(pc, bcs, p_data);   \
+            tl->error.frame = TRACE_FRAME(pc);                            \
         } else {                                                          \
-            struct au_vm_trace_item item;                                 \
-            item.file = p_data->file;                                     \
-            item.pos = au_vm_locate_error(pc, bcs, p_data);               \
-            au_vm_trace_item_array_add(&tl->backtrace, item);             \
+            au_vm_trace_frame_array_add(&tl->backtrace, TRACE_FRAME(pc)); \
         }                                                                 \
         frame.retval = au_value_error();                                  \
         goto end;                                                         \
@@ -556,8 +624,11 @@ au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
                                 AU_VALUE_INT))
                     RAISE(call_error());
 
-                frame.regs[ret] =
-                    au_value_int(-au_value_get_int(frame.regs[reg]));
+                int64_t negated;
+                if (AU_UNLIKELY(au_platform_isub_overflow(
+                        0, au_value_get_int(frame.regs[reg]), &negated)))
+                    RAISE(int_overflow_error());
+                frame.regs[ret] = au_value_int(negated);
 
                 DISPATCH;
             }
@@ -661,16 +732,38 @@ au_value_t au_vm_exec_unverified(struct au_vm_thread_local *tl,
             bc[0] = NAME;                                                 \
             goto _##NAME;                                                 \
         }                                                                 \
-        const int32_t li = au_value_get_int(lhs),                         \
+        const int64_t li = au_value_get_int(lhs),                         \
                       ri = au_value_get_int(rhs);                         \
         const au_value_t result = EXPR;                                   \
         FAST_MOVE_VALUE(frame.regs[res], result);                         \
                                                                           \
         DISPATCH;                                                         \
     }
-            BIN_OP(AU_OP_ADD, au_value_int(au_platform_iadd_wrap(li, ri)))
-            BIN_OP(AU_OP_SUB, au_value_int(au_platform_isub_wrap(li, ri)))
-            BIN_OP(AU_OP_MUL, au_value_int(au_platform_imul_wrap(li, ri)))
+#define CHECKED_BIN_OP(NAME, FN)                                          \
+    CASE(NAME##_INT) : {                                                  \
+        _##NAME##_INT:;                                                   \
+        const au_value_t lhs = frame.regs[bc[1]];                         \
+        const au_value_t rhs = frame.regs[bc[2]];                         \
+        const uint8_t res = bc[3];                                        \
+        PREFETCH_INSN;                                                    \
+                                                                          \
+        if (AU_UNLIKELY((au_value_get_type(lhs) != AU_VALUE_INT) ||       \
+                        (au_value_get_type(rhs) != AU_VALUE_INT))) {      \
+            bc[0] = NAME;                                                 \
+            goto _##NAME;                                                 \
+        }                                                                 \
+        int64_t result;                                                   \
+        if (AU_UNLIKELY(FN(au_value_get_int(lhs), au_value_get_int(rhs),  \
+                           &result)))                                     \
+            RAISE(int_overflow_error());                                  \
+        FAST_MOVE_VALUE(frame.regs[res], au_value_int(result));           \
+                                                                          \
+        DISPATCH;                                                         \
+    }
+            CHECKED_BIN_OP(AU_OP_ADD, au_platform_iadd_overflow)
+            CHECKED_BIN_OP(AU_OP_SUB, au_platform_isub_overflow)
+            CHECKED_BIN_OP(AU_OP_MUL, au_platform_imul_overflow)
+#undef CHECKED_BIN_OP
             BIN_OP(AU_OP_DIV, au_value_double((double)li / (double)ri))
             BIN_OP(AU_OP_MOD, au_value_int(li % ri))
             BIN_OP(AU_OP_EQ, au_value_bool(li == ri))
@@ -805,6 +898,7 @@ _AU_OP_JNIF:;
             CASE(AU_OP_CALL): 
             CASE(AU_OP_CALL_CATCH): // clang-format on
             {
+_AU_OP_CALL:;
                 const uint8_t opcode = bc[0];
                 const uint8_t ret_reg = bc[1];
                 DEF_BC16(func_id, 2);
@@ -813,11 +907,40 @@ _AU_OP_JNIF:;
                 const struct au_fn *call_fn = &p_data->fns.data[func_id];
                 size_t num_args = (size_t)au_fn_num_args(call_fn);
 
+                const struct au_lib_func *fast_fn =
+                    au_fn_fast_lib_func(call_fn);
+                if (fast_fn != 0) {
+                    // Fast paths take at most 2 arguments, which are in
+                    // the following AU_OP_PUSH_ARG instruction. They're
+                    // unboxed, so they don't need to be referenced.
+                    const au_value_t fast_args[2] = {
+                        frame.regs[bc[1]],
+                        num_args > 1 ? frame.regs[bc[2]] : au_value_none(),
+                    };
+                    au_value_t fast_retval;
+                    if (au_lib_func_call_fast(fast_fn, fast_args,
+                                              &fast_retval)) {
+                        if (AU_UNLIKELY(au_value_is_error(fast_retval)))
+                            RAISE(int_overflow_error());
+#ifdef AU_FEAT_DELAYED_RC // clang-format off
+                        frame.regs[ret_reg] = fast_retval;
+#else
+                        MOVE_VALUE(frame.regs[ret_reg], fast_retval);
+#endif // clang-format on
+                        bc += 4;
+                        DISPATCH_JMP;
+                    }
+                }
+
 #ifdef AU_USE_ALLOCA
+                // A fixed-size buffer is used instead of alloca, which
+                // would only release its memory once the function returns
+                // and overflow the stack in long-running loops
+                au_value_t stack_args[ALLOCA_MAX_ARGS];
                 int use_alloca = 0;
                 au_value_t *args;
                 if (AU_LIKELY(num_args <= ALLOCA_MAX_ARGS)) {
-                    args = alloca(num_args * sizeof(au_value_t));
+                    args = stack_args;
                     au_value_clear(args, num_args);
                     use_alloca = 1;
                 } else {
@@ -867,7 +990,12 @@ _AU_OP_JNIF:;
                         callee_retval = extract_error_value(tl);
                     }
                     if (au_value_is_error(callee_retval)) {
+#ifdef AU_USE_ALLOCA
+                        if (AU_UNLIKELY(!use_alloca))
+                            au_data_free(args);
+#else
                         au_data_free(args);
+#endif
                         RAISE_BT();
                     }
                 }
@@ -896,6 +1024,53 @@ _AU_OP_JNIF:;
 
                 DISPATCH_JMP;
             }
+            CASE(AU_OP_TAIL_CALL) : {
+                DEF_BC16(func_id, 2);
+
+                // Only bytecode functions in this module that fit inside
+                // the current frame can reuse it. Otherwise, this is a
+                // regular call followed by an AU_OP_RET.
+                const struct au_fn *call_fn = &p_data->fns.data[func_id];
+                if (call_fn->type != AU_FN_BC ||
+                    (call_fn->flags & AU_FN_FLAG_HAS_CLASS) != 0)
+                    goto _AU_OP_CALL;
+                const struct au_bc_storage *call_bcs =
+                    &call_fn->as.bc_func;
+                if (AU_UNLIKELY(
+                        call_bcs->num_registers > frame_num_registers ||
+                        call_bcs->num_locals > frame_num_locals))
+                    goto _AU_OP_CALL;
+
+                // Arguments are only read from registers, so they can be
+                // moved into the locals in place
+                const uint8_t *arg_regs = &bc[4];
+                for (int i = 0; i < call_bcs->num_args; i++) {
+                    const uint8_t reg = arg_regs[(i / 3) * 4 + 1 + i % 3];
+                    COPY_VALUE(frame.locals[i], frame.regs[reg]);
+                }
+#ifdef AU_FEAT_DELAYED_RC // clang-format off
+                for (int i = call_bcs->num_args; i < bcs->num_locals; i++)
+                    frame.locals[i] = au_value_none();
+                au_value_clear(frame.regs, bcs->num_registers);
+                // INVARIANT(GC): we don't hold a ref to self
+                frame.self = 0;
+#else
+                for (int i = call_bcs->num_args; i < bcs->num_locals; i++)
+                    MOVE_VALUE(frame.locals[i], au_value_none());
+                for (int i = 0; i < bcs->num_registers; i++)
+                    MOVE_VALUE(frame.regs[i], au_value_none());
+                if (frame.self != 0) {
+                    au_obj_deref(frame.self);
+                    frame.self = 0;
+                }
+#endif // clang-format on
+
+                bcs = call_bcs;
+                tl->current_frame.bcs = bcs;
+                bc = (uint8_t *)bcs->bc.data;
+                frame.bc_start = bc;
+                DISPATCH_JMP;
+            }
             // Function values
             CASE(AU_OP_LOAD_FUNC) : {
                 const uint8_t reg = bc[1];
@@ -937,6 +1112,7 @@ _AU_OP_JNIF:;
             CASE(AU_OP_CALL_FUNC_VALUE):
             CASE(AU_OP_CALL_FUNC_VALUE_CATCH): // clang-format on
             {
+                uint8_t *const call_bc = bc;
                 const uint8_t opcode = bc[0];
                 const uint8_t func_reg = bc[1];
                 const uint8_t num_args = bc[2];
@@ -986,6 +1162,7 @@ _AU_OP_JNIF:;
                         }
                         if (au_value_is_error(callee_retval)) {
                             au_data_free(args);
+                            bc = call_bc;
                             RAISE(call_error(p_data, &frame));
                         }
                     }
@@ -1068,6 +1245,7 @@ _AU_OP_JNIF:;
                 DISPATCH;
             }
             CASE(AU_OP_IDX_GET) : {
+                _AU_OP_IDX_GET:;
                 const au_value_t col_val = frame.regs[bc[1]];
                 const au_value_t idx_val = frame.regs[bc[2]];
                 PREFETCH_INSN;
@@ -1075,6 +1253,25 @@ _AU_OP_JNIF:;
                 const uint8_t ret_reg = bc[3];
                 struct au_struct *collection = au_struct_coerce(col_val);
                 if (AU_LIKELY(collection != 0)) {
+                    const int is_int_idx =
+                        au_value_get_type(idx_val) == AU_VALUE_INT;
+                    if (collection->vdata == &au_obj_array_vdata &&
+                        is_int_idx) {
+                        bc[0] = AU_OP_IDX_GET_ARRAY_INT;
+                        goto _AU_OP_IDX_GET_ARRAY_INT;
+                    } else if (collection->vdata == &au_obj_tuple_vdata &&
+                               is_int_idx) {
+                        bc[0] = AU_OP_IDX_GET_TUPLE_INT;
+                        goto _AU_OP_IDX_GET_TUPLE_INT;
+                    } else if (collection->vdata == &au_obj_dict_vdata) {
+                        bc[0] = AU_OP_IDX_GET_DICT;
+                        goto _AU_OP_IDX_GET_DICT;
+                    } else if (collection->vdata == &au_obj_class_vdata &&
+                               au_value_get_type(idx_val) ==
+                                   AU_VALUE_STR) {
+                        bc[0] = AU_OP_IDX_GET_CLASS;
+                        goto _AU_OP_IDX_GET_CLASS;
+                    }
                     au_value_t value;
                     if (!collection->vdata->idx_get_fn(collection, idx_val,
                                                        &value)) {
@@ -1088,6 +1285,7 @@ _AU_OP_JNIF:;
                 DISPATCH;
             }
             CASE(AU_OP_IDX_SET) : {
+                _AU_OP_IDX_SET:;
                 const au_value_t col_val = frame.regs[bc[1]];
                 const au_value_t idx_val = frame.regs[bc[2]];
                 const au_value_t value_val = frame.regs[bc[3]];
@@ -1095,6 +1293,19 @@ _AU_OP_JNIF:;
 
                 struct au_struct *collection = au_struct_coerce(col_val);
                 if (AU_LIKELY(collection != 0)) {
+                    if (collection->vdata == &au_obj_array_vdata &&
+                        au_value_get_type(idx_val) == AU_VALUE_INT) {
+                        bc[0] = AU_OP_IDX_SET_ARRAY_INT;
+                        goto _AU_OP_IDX_SET_ARRAY_INT;
+                    } else if (collection->vdata == &au_obj_dict_vdata) {
+                        bc[0] = AU_OP_IDX_SET_DICT;
+                        goto _AU_OP_IDX_SET_DICT;
+                    } else if (collection->vdata == &au_obj_class_vdata &&
+                               au_value_get_type(idx_val) ==
+                                   AU_VALUE_STR) {
+                        bc[0] = AU_OP_IDX_SET_CLASS;
+                        goto _AU_OP_IDX_SET_CLASS;
+                    }
                     if (AU_UNLIKELY(collection->vdata->idx_set_fn(
                                         collection, idx_val, value_val) ==
                                     0)) {
@@ -1106,6 +1317,163 @@ _AU_OP_JNIF:;
 
                 DISPATCH;
             }
+            // Indexing instructions (specialized on collection type)
+            CASE(AU_OP_IDX_GET_ARRAY_INT) : {
+                _AU_OP_IDX_GET_ARRAY_INT:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                PREFETCH_INSN;
+
+                struct au_obj_array *obj_array =
+                    au_obj_array_coerce(col_val);
+                if (AU_UNLIKELY(obj_array == 0 ||
+                                au_value_get_type(idx_val) !=
+                                    AU_VALUE_INT)) {
+                    bc[0] = AU_OP_IDX_GET;
+                    goto _AU_OP_IDX_GET;
+                }
+                au_value_t value;
+                if (AU_UNLIKELY(!au_obj_array_get_int(
+                        obj_array, au_value_get_int(idx_val), &value))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+                COPY_VALUE(frame.regs[bc[3]], value);
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_GET_TUPLE_INT) : {
+                _AU_OP_IDX_GET_TUPLE_INT:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                PREFETCH_INSN;
+
+                struct au_obj_tuple *obj_tuple =
+                    au_obj_tuple_coerce(col_val);
+                if (AU_UNLIKELY(obj_tuple == 0 ||
+                                au_value_get_type(idx_val) !=
+                                    AU_VALUE_INT)) {
+                    bc[0] = AU_OP_IDX_GET;
+                    goto _AU_OP_IDX_GET;
+                }
+                au_value_t value;
+                if (AU_UNLIKELY(!au_obj_tuple_get_int(
+                        obj_tuple, au_value_get_int(idx_val), &value))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+                COPY_VALUE(frame.regs[bc[3]], value);
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_GET_DICT) : {
+                _AU_OP_IDX_GET_DICT:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                PREFETCH_INSN;
+
+                struct au_obj_dict *obj_dict = au_obj_dict_coerce(col_val);
+                if (AU_UNLIKELY(obj_dict == 0)) {
+                    bc[0] = AU_OP_IDX_GET;
+                    goto _AU_OP_IDX_GET;
+                }
+                au_value_t value;
+                if (AU_UNLIKELY(!au_obj_dict_get(obj_dict, idx_val,
+                                                 &value))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+                COPY_VALUE(frame.regs[bc[3]], value);
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_SET_ARRAY_INT) : {
+                _AU_OP_IDX_SET_ARRAY_INT:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                const au_value_t value_val = frame.regs[bc[3]];
+                PREFETCH_INSN;
+
+                struct au_obj_array *obj_array =
+                    au_obj_array_coerce(col_val);
+                if (AU_UNLIKELY(obj_array == 0 ||
+                                au_value_get_type(idx_val) !=
+                                    AU_VALUE_INT)) {
+                    bc[0] = AU_OP_IDX_SET;
+                    goto _AU_OP_IDX_SET;
+                }
+                const int64_t idx = au_value_get_int(idx_val);
+                if (AU_UNLIKELY(!au_obj_array_set_int(obj_array, idx,
+                                                      value_val))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_SET_DICT) : {
+                _AU_OP_IDX_SET_DICT:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                const au_value_t value_val = frame.regs[bc[3]];
+                PREFETCH_INSN;
+
+                struct au_obj_dict *obj_dict = au_obj_dict_coerce(col_val);
+                if (AU_UNLIKELY(obj_dict == 0)) {
+                    bc[0] = AU_OP_IDX_SET;
+                    goto _AU_OP_IDX_SET;
+                }
+                au_obj_dict_set(obj_dict, idx_val, value_val);
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_GET_CLASS) : {
+                _AU_OP_IDX_GET_CLASS:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                PREFETCH_INSN;
+
+                struct au_obj_class *obj_class =
+                    au_obj_class_coerce(col_val);
+                if (AU_UNLIKELY(obj_class == 0 ||
+                                au_value_get_type(idx_val) !=
+                                    AU_VALUE_STR)) {
+                    bc[0] = AU_OP_IDX_GET;
+                    goto _AU_OP_IDX_GET;
+                }
+                size_t field_idx;
+                if (AU_UNLIKELY(!field_cache_lookup(
+                        bcs, bc - frame.bc_start, obj_class,
+                        au_value_get_string(idx_val), &field_idx))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+                COPY_VALUE(frame.regs[bc[3]], obj_class->data[field_idx]);
+
+                DISPATCH;
+            }
+            CASE(AU_OP_IDX_SET_CLASS) : {
+                _AU_OP_IDX_SET_CLASS:;
+                const au_value_t col_val = frame.regs[bc[1]];
+                const au_value_t idx_val = frame.regs[bc[2]];
+                const au_value_t value_val = frame.regs[bc[3]];
+                PREFETCH_INSN;
+
+                struct au_obj_class *obj_class =
+                    au_obj_class_coerce(col_val);
+                if (AU_UNLIKELY(obj_class == 0 ||
+                                au_value_get_type(idx_val) !=
+                                    AU_VALUE_STR)) {
+                    bc[0] = AU_OP_IDX_SET;
+                    goto _AU_OP_IDX_SET;
+                }
+                size_t field_idx;
+                if (AU_UNLIKELY(!field_cache_lookup(
+                        bcs, bc - frame.bc_start, obj_class,
+                        au_value_get_string(idx_val), &field_idx))) {
+                    RAISE(invalid_index_error(col_val, idx_val));
+                }
+                au_value_ref(value_val);
+                au_value_deref(obj_class->data[field_idx]);
+                obj_class->data[field_idx] = value_val;
+
+                DISPATCH;
+            }
             // Tuple instructions
             CASE(AU_OP_TUPLE_NEW) : {
                 const uint8_t reg = bc[1];
@@ -1244,9 +1612,27 @@ _AU_OP_JNIF:;
                     p_data->imports.data[idx].module_idx;
                 const char *relpath = p_data->imports.data[idx].path;
 
+                // Preparsed modules are looked up without touching the
+                // file system, so that images run without their sources
                 struct au_module_resolve_result resolve_res;
-                if (!au_module_resolve(&resolve_res, relpath, p_data->cwd))
+                if (!au_module_resolve_lexical(&resolve_res, relpath,
+                                               p_data->cwd))
                     RAISE(import_path_resolve_error());
+                const char *preparsed_path =
+                    resolve_res.subpath == 0
+                        ? au_vm_thread_local_get_preparsed_path(
+                              tl, resolve_res.abspath)
+                        : 0;
+                au_module_resolve_result_del(&resolve_res);
+                if (preparsed_path != 0) {
+                    resolve_res = (struct au_module_resolve_result){
+                        .abspath = au_data_strdup(preparsed_path),
+                        .subpath = 0,
+                    };
+                } else if (!au_module_resolve(&resolve_res, relpath,
+                                              p_data->cwd)) {
+                    RAISE(import_path_resolve_error());
+                }
 
                 const char *module_path = resolve_res.abspath;
 
@@ -1291,53 +1677,80 @@ _AU_OP_JNIF:;
                     au_data_free(module_path_with_subpath);
                 module_path = 0;
 
+                struct au_program *preparsed = 0;
+                if (resolve_res.subpath == 0)
+                    preparsed = au_vm_thread_local_take_preparsed(
+                        tl, resolve_res.abspath);
+
                 struct au_module module;
-                switch (au_module_import(&module, &resolve_res)) {
-                case AU_MODULE_IMPORT_SUCCESS: {
-                    break;
-                }
-                case AU_MODULE_IMPORT_SUCCESS_NO_MODULE: {
-                    goto _import_dispatch;
-                }
-                case AU_MODULE_IMPORT_FAIL:
-                case AU_MODULE_IMPORT_FAIL_DL: {
-                    RAISE(import_path_resolve_error());
-                    break;
-                }
+                if (preparsed != 0) {
+                    module.type = AU_MODULE_SOURCE;
+                } else {
+                    switch (au_module_import(&module, &resolve_res)) {
+                    case AU_MODULE_IMPORT_SUCCESS: {
+                        break;
+                    }
+                    case AU_MODULE_IMPORT_SUCCESS_NO_MODULE: {
+                        goto _import_dispatch;
+                    }
+                    case AU_MODULE_IMPORT_FAIL:
+                    case AU_MODULE_IMPORT_FAIL_DL: {
+                        RAISE(import_path_resolve_error());
+                        break;
+                    }
+                    }
                 }
 
                 switch (module.type) {
                 case AU_MODULE_SOURCE: {
-                    struct au_mmap_info mmap = module.data.source;
-
                     struct au_program program;
-                    struct au_parser_result parse_res =
-                        au_parse(mmap.bytes, mmap.size, &program);
-                    if (parse_res.type != AU_PARSER_RES_OK) {
-                        au_print_parser_error(
-                            parse_res, (struct au_error_location){
-                                           .src = mmap.bytes,
-                                           .len = mmap.size,
-                                           .path = resolve_res.abspath,
-                                       });
-                        RAISE_BT();
+                    int from_preparsed = 0;
+                    if (preparsed != 0) {
+                        program = *preparsed;
+                        au_data_free(preparsed);
+                        from_preparsed = 1;
+                    } else {
+                        struct au_mmap_info mmap = module.data.source;
+                        struct au_parser_result parse_res =
+                            au_parse(mmap.bytes, mmap.size, &program);
+                        if (parse_res.type != AU_PARSER_RES_OK) {
+                            au_print_parser_error(
+                                parse_res,
+                                (struct au_error_location){
+                                    .src = mmap.bytes,
+                                    .len = mmap.size,
+                                    .path = resolve_res.abspath,
+                                });
+                            // RAISE_BT expects bc to point past the
+                            // instruction
+                            bc += 4;
+                            RAISE_BT();
+                        }
                     }
 
                     program.data.tl_constant_start = tl->const_len;
                     au_vm_thread_local_add_const_cache(
                         tl, program.data.data_val.len);
 
-                    if (!au_split_path(resolve_res.abspath,
-                                       &program.data.file,
-                                       &program.data.cwd))
+                    const int split =
+                        from_preparsed
+                            ? au_split_abspath(resolve_res.abspath,
+                                               &program.data.file,
+                                               &program.data.cwd)
+                            : au_split_path(resolve_res.abspath,
+                                            &program.data.file,
+                                            &program.data.cwd);
+                    if (!split)
                         RAISE(import_path_resolve_error());
 
                     au_module_resolve_result_del(&resolve_res);
 
                     // FIXME: deallocate
                     if (au_value_is_error(
-                            au_vm_exec_unverified_main(tl, &program)))
+                            au_vm_exec_unverified_main(tl, &program))) {
+                        bc += 4;
                         RAISE_BT();
+                    }
 
                     au_bc_storage_del(&program.main);
 
@@ -1412,16 +1825,16 @@ end:
 #ifdef AU_USE_ALLOCA
     if (AU_LIKELY(alloca_values != 0)) {
 #ifndef AU_FEAT_DELAYED_RC
-        for (int i = 0; i < bcs->num_values; i++) {
+        for (int i = 0; i < frame_num_registers + frame_num_locals; i++) {
             au_value_deref(alloca_values[i]);
         }
 #endif
     } else {
 #ifndef AU_FEAT_DELAYED_RC
-        for (int i = 0; i < bcs->num_registers; i++) {
+        for (int i = 0; i < frame_num_registers; i++) {
             au_value_deref(frame.regs[i]);
         }
-        for (int i = 0; i < bcs->num_locals; i++) {
+        for (int i = 0; i < frame_num_locals; i++) {
             au_value_deref(frame.locals[i]);
         }
 #endif
@@ -1432,10 +1845,10 @@ end:
     }
 #else
 #ifndef AU_FEAT_DELAYED_RC
-    for (int i = 0; i < bcs->num_registers; i++) {
+    for (int i = 0; i < frame_num_registers; i++) {
         au_value_deref(frame.regs[i]);
     }
-    for (int i = 0; i < bcs->num_locals; i++) {
+    for (int i = 0; i < frame_num_locals; i++) {
         au_value_deref(frame.locals[i]);
     }
 #endif
@@ -1471,6 +1884,7 @@ au_value_t au_vm_exec_unverified_main(struct au_vm_thread_local *tl,
                 tl->error.result = res;
                 tl->error.file = program->data.file;
                 tl->error.result.pos = 0;
+                tl->error.frame.file = 0;
                 return au_value_error();
             }
         }
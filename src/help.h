@@ -5,8 +5,9 @@
 static const char *AU_HELP_MAIN =
     "Usage:\n    aument [command] [options] file...\n\nCommands:\n    "
     "build       builds source code into a single binary\n    help        "
-    "shows this help screen\n    run         runs a program\n    version  "
-    "   print aument version\n\nUse aument help [command] for more "
+    "shows this help screen\n    run         runs a program\n    snapshot "
+    "   stores a parsed program into an image\n    version     print "
+    "aument version\n\nUse aument help [command] for more "
     "information.\n\nCopyright (c) 2021 the aument contributors.\nProject "
     "link: https://github.com/aument-lang/aument\n";
 static const char *AU_HELP_BUILD =
@@ -19,8 +20,15 @@ static const char *AU_HELP_BUILD =
     "invokes the C compiler\nwith the following arguments:\n\n```\n-flto "
     "-O2\n```\n\nPassing `-b` will make aument output bytecode before it "
     "is compiled to C.\n\nPassing `-c` will make aument write C code into "
-    "*output-file* instead\nof outputting a compiled binary.\n\nPassing "
-    "`-g` will add the `-g` flag to the C compiler call.\n";
+    "*output-file* instead\nof outputting a compiled binary.\n\nEvery "
+    "module is compiled into its own object file. Up to *N* C "
+    "compilers\nare run in parallel if `-jN` is passed, defaulting to the "
+    "number of\nprocessors. Object files are cached in the directory "
+    "named by the\n`AU_CACHE_DIR` environment variable, or in `aument` "
+    "inside the user's\ncache directory, and are reused by later builds "
+    "of the same module\nwith the same compiler flags. Passing "
+    "`--no-cache` disables the cache.\n\nPassing `-g` will add the `-g` "
+    "flag to the C compiler call.\n";
 static const char *AU_HELP_HELP =
     "Usage:\n    aument help [command] [command]\n\nSummary:\n    Shows "
     "the documentation for a specified command if given.\nElse, a general "
@@ -29,6 +37,22 @@ static const char *AU_HELP_RUN =
     "Usage:\n    aument run input-file input-file\n\nSummary:\n    Runs "
     "*input-file* through an interpreter.\n\nPassing `-b` will make "
     "aument output bytecode before it is interpreted.\n";
+static const char *AU_HELP_SNAPSHOT =
+    "Usage:\n    aument snapshot input-file output-file input-file "
+    "output-file\n\nSummary:\n    Parses *input-file* and every source "
+    "module it imports, and stores the\nparsed programs into an image "
+    "file named *output-file*.\n\nRunning the image with `aument run "
+    "output-file` skips parsing, and runs\nthe program as if *input-file* "
+    "was run. The image holds the parsed\nsource modules, so it runs "
+    "without their source files, and changes to\nthe source files only "
+    "take effect once a new image is made. Modules\nthat weren't parsed "
+    "when the image was made, such as native libraries,\nare loaded when "
+    "they are imported. Images can only be run by the\nversion of aument "
+    "that made them.\n\nImages hold parsed modules only, not initialized "
+    "globals or the\nheap. The top-level code of the program and of its "
+    "modules runs each\ntime the image is run. Images that are corrupted "
+    "or truncated are\nrejected.\n\nIf *input-file* or a source module it "
+    "imports can't be parsed, no\nimage is written.\n";
 static const char *AU_HELP_VERSION =
     "Usage:\n    aument version  \n\nSummary:\n    Prints aument's "
     "current version number.\n";
@@ -41,6 +65,8 @@ static const char *help_text(const char *action) {
         return AU_HELP_HELP;
     if (strcmp(action, "run") == 0)
         return AU_HELP_RUN;
+    if (strcmp(action, "snapshot") == 0)
+        return AU_HELP_SNAPSHOT;
     if (strcmp(action, "version") == 0)
         return AU_HELP_VERSION;
     return AU_HELP_MAIN;
@@ -54,6 +54,42 @@ int au_extern_module_add_fn(au_extern_module_t p_data, const char *name,
     }
 }
 
+/// [func] Declares an exported function with a typed fast path in the
+///     external module. The fast path is called with unboxed arguments
+///     when every argument has the type given by the signature, and
+///     must then behave like the boxed function.
+/// @param p_data the module
+/// @param name null-terminated string representing the name of the
+/// function
+/// @param func the pointer to the external function
+/// @param num_args the number of arguments the external function takes
+/// @param fast_sig the signature of fast_func
+/// @param fast_func the fast path, cast to au_extern_fast_func_t
+/// @return 0 if a function by that name already exists or num_args
+///     doesn't match fast_sig, 1 if successful
+static AU_UNUSED inline int
+au_extern_module_add_fast_fn(au_extern_module_t p_data, const char *name,
+                             au_extern_func_t func, int32_t num_args,
+                             enum au_lib_func_sig fast_sig,
+                             au_extern_fast_func_t fast_func);
+
+int au_extern_module_add_fast_fn(au_extern_module_t p_data,
+                                 const char *name, au_extern_func_t func,
+                                 int32_t num_args,
+                                 enum au_lib_func_sig fast_sig,
+                                 au_extern_fast_func_t fast_func) {
+    if (fast_sig == AU_LIB_FUNC_SIG_NONE ||
+        num_args != au_lib_func_sig_num_args(fast_sig))
+        return 0;
+    if (!au_extern_module_add_fn(p_data, name, func, num_args))
+        return 0;
+    struct au_lib_func *lib_func =
+        &p_data->fns.data[p_data->fns.len - 1].as.lib_func;
+    lib_func->fast_sig = fast_sig;
+    lib_func->fast_func = fast_func;
+    return 1;
+}
+
 #define AU_EXTERN_MODULE_MAIN(OPTIONS_ID)                                 \
     au_extern_module_t au_extern_module_load(                             \
         struct au_extern_module_options *OPTIONS_ID)
@@ -13,14 +13,15 @@
 
 #include "os/mmap.h"
 #include "os/path.h"
-#include "os/tmpfile.h"
 
 #include "core/bc.h"
+#include "core/image.h"
 #include "core/int_error/error_printer.h"
 #include "core/parser/parser.h"
 #include "core/program.h"
 #include "core/rt/exception.h"
 #include "core/rt/malloc.h"
+#include "core/vm/preparse.h"
 #include "core/vm/vm.h"
 
 #ifdef AU_FEAT_COMPILER
@@ -38,6 +39,7 @@
 #define FLAG_DUMP_BYTECODE (1 << 1)
 #define FLAG_GENERATE_DEBUG (1 << 2)
 #define FLAG_NO_OPT (1 << 3)
+#define FLAG_NO_CACHE (1 << 4)
 
 #include "core/int_error/error_printer.h"
 
@@ -48,10 +50,33 @@
 
 #define AU_STACK_MAX 4194304
 
-enum au_action { ACTION_BUILD, ACTION_RUN };
+enum au_action { ACTION_BUILD, ACTION_RUN, ACTION_SNAPSHOT };
+
+/// Prints a runtime error along with the line it was raised on. Images
+/// are run without their sources, so the line is left out if the
+/// source file can't be read.
+static void print_runtime_error(struct au_interpreter_result error,
+                                const char *file) {
+    struct au_mmap_info mmap;
+    if (!au_mmap_read(file, &mmap)) {
+        au_print_interpreter_error(error, (struct au_error_location){
+                                              .src = 0,
+                                              .len = 0,
+                                              .path = file,
+                                          });
+        return;
+    }
+    au_print_interpreter_error(error, (struct au_error_location){
+                                          .src = mmap.bytes,
+                                          .len = mmap.size,
+                                          .path = file,
+                                      });
+    au_mmap_del(&mmap);
+}
 
 int main(int argc, char **argv) {
     uint32_t flags = 0;
+    int jobs = 0;
 
     char *action = NULL;
     char *input_file = NULL;
@@ -71,10 +96,18 @@ int main(int argc, char **argv) {
                 flags |= FLAG_GENERATE_DEBUG;
                 break;
             }
+            case 'j': {
+                jobs = atoi(&argv[i][2]);
+                if (jobs <= 0)
+                    au_fatal("invalid number of jobs\n");
+                break;
+            }
             case '-': {
                 char *full_opt = &argv[i][2];
                 if (strcmp(full_opt, "no-opt") == 0) {
                     flags |= FLAG_NO_OPT;
+                } else if (strcmp(full_opt, "no-cache") == 0) {
+                    flags |= FLAG_NO_CACHE;
                 }
 #if defined(AU_INCLUDEDIR)
                 else if (strcmp(full_opt, "cflags") == 0) {
@@ -133,6 +166,14 @@ int main(int argc, char **argv) {
         if (!output_file) {
             au_fatal("no output file\n");
         }
+    } else if (strcmp(action, "snapshot") == 0) {
+        action_id = ACTION_SNAPSHOT;
+        if (!input_file) {
+            au_fatal("no input file\n");
+        }
+        if (!output_file) {
+            au_fatal("no output file\n");
+        }
     }
 #ifndef AU_COVERAGE
     else if (strcmp(action, "help") == 0) {
@@ -159,29 +200,42 @@ int main(int argc, char **argv) {
         au_perror("mmap");
 
     struct au_program program;
-    struct au_parser_result parse_res =
-        au_parse(mmap.bytes, mmap.size, &program);
+    struct au_image_module_array image_modules = {0};
+    const int from_image = au_image_is_image(mmap.bytes, mmap.size);
+    if (from_image) {
+        if (!au_image_read(mmap.bytes, mmap.size, &program,
+                           &image_modules))
+            au_fatal("%s is corrupted or isn't an image of this "
+                     "version of aument\n",
+                     input_file);
+        au_mmap_del(&mmap);
+    } else {
+        struct au_parser_result parse_res =
+            au_parse(mmap.bytes, mmap.size, &program);
 #ifdef AU_FUZZ_PARSER
-    return 0;
+        return 0;
 #endif
-    if (parse_res.type != AU_PARSER_RES_OK) {
+        if (parse_res.type != AU_PARSER_RES_OK) {
 #ifdef AU_FUZZ_VM
-        return 0;
+            return 0;
 #endif
-        au_print_parser_error(parse_res, (struct au_error_location){
-                                             .src = mmap.bytes,
-                                             .len = mmap.size,
-                                             .path = input_file,
-                                         });
+            au_print_parser_error(parse_res,
+                                  (struct au_error_location){
+                                      .src = mmap.bytes,
+                                      .len = mmap.size,
+                                      .path = input_file,
+                                  });
+            au_mmap_del(&mmap);
+            return 1;
+        }
         au_mmap_del(&mmap);
-        return 1;
-    }
-    au_mmap_del(&mmap);
 
-    program.data.file = 0;
-    program.data.cwd = 0;
-    if (!au_split_path(input_file, &program.data.file, &program.data.cwd))
-        au_perror("au_split_path");
+        program.data.file = 0;
+        program.data.cwd = 0;
+        if (!au_split_path(input_file, &program.data.file,
+                           &program.data.cwd))
+            au_perror("au_split_path");
+    }
 
     if ((flags & FLAG_DUMP_BYTECODE) != 0)
         au_program_dbg(&program);
@@ -197,40 +251,47 @@ int main(int argc, char **argv) {
         tl.stack_max = AU_STACK_MAX;
 
         au_vm_thread_local_install_stdlib(&tl);
+        if (from_image) {
+            for (size_t i = 0; i < image_modules.len; i++) {
+                struct au_image_module *module = &image_modules.data[i];
+                au_vm_thread_local_add_preparsed(&tl, module->abspath,
+                                                 module->program);
+                for (size_t j = 0; j < module->import_paths.len; j++) {
+                    au_vm_thread_local_add_preparsed_import(
+                        &tl, module->import_paths.data[j],
+                        module->abspath);
+                    au_data_free(module->import_paths.data[j]);
+                }
+                au_data_free(module->import_paths.data);
+                au_data_free(module->abspath);
+            }
+            au_data_free(image_modules.data);
+        } else {
+            au_vm_preparse_imports(&tl, &program.data, 0);
+        }
         au_malloc_set_collect(1);
+        au_value_print_init();
 
         au_value_t retval = au_vm_exec_unverified_main(&tl, &program);
         if (au_value_is_error(retval)) {
             fflush(stdout);
 
-            struct au_mmap_info mmap;
-            if (!au_mmap_read(tl.error.file, &mmap))
-                au_perror("mmap");
-            au_print_interpreter_error(tl.error.result,
-                                       (struct au_error_location){
-                                           .src = mmap.bytes,
-                                           .len = mmap.size,
-                                           .path = tl.error.file,
-                                       });
-            au_mmap_del(&mmap);
+            struct au_vm_trace_item_array backtrace =
+                (struct au_vm_trace_item_array){0};
+            const struct au_interpreter_result error =
+                au_vm_resolve_error(&tl, &backtrace);
 
-            for (size_t i = 0; i < tl.backtrace.len; i++) {
-                const struct au_vm_trace_item item = tl.backtrace.data[i];
-                struct au_mmap_info mmap;
-                if (!au_mmap_read(item.file, &mmap))
-                    au_perror("mmap");
-                au_print_interpreter_error(
+            print_runtime_error(error, tl.error.file);
+            for (size_t i = 0; i < backtrace.len; i++) {
+                const struct au_vm_trace_item item = backtrace.data[i];
+                print_runtime_error(
                     (struct au_interpreter_result){
                         .type = AU_INT_ERR_BACKTRACE,
                         .pos = item.pos,
                     },
-                    (struct au_error_location){
-                        .src = mmap.bytes,
-                        .len = mmap.size,
-                        .path = item.file,
-                    });
-                au_mmap_del(&mmap);
+                    item.file);
             }
+            au_data_free(backtrace.data);
             return 1;
         }
 
@@ -245,6 +306,42 @@ int main(int argc, char **argv) {
         au_vm_thread_local_del(&tl);
         au_vm_thread_local_set(0);
 #endif
+    } else if (action_id == ACTION_SNAPSHOT) {
+        if (from_image)
+            au_fatal("%s is already an image\n", input_file);
+
+        struct au_vm_thread_local tl;
+        au_vm_thread_local_init(&tl, &program.data);
+        if (!au_vm_preparse_imports(&tl, &program.data, 1)) {
+            au_program_del(&program);
+            au_vm_thread_local_del(&tl);
+            return 1;
+        }
+
+        for (size_t i = 0; i < tl.preparsed_modules.len; i++) {
+            struct au_image_module module = {0};
+            module.abspath = tl.preparsed_paths.data[i];
+            module.program = tl.preparsed_modules.data[i];
+            au_image_module_array_add(&image_modules, module);
+        }
+        AU_HM_VARS_FOREACH_PAIR(&tl.preparsed_imports_map, path, idx, {
+            au_str_array_add(&image_modules.data[idx].import_paths,
+                             au_data_strndup(path, path_len));
+        })
+        const int success =
+            au_image_write(output_file, &program, &image_modules);
+        for (size_t i = 0; i < image_modules.len; i++) {
+            struct au_image_module *module = &image_modules.data[i];
+            for (size_t j = 0; j < module->import_paths.len; j++)
+                au_data_free(module->import_paths.data[j]);
+            au_data_free(module->import_paths.data);
+        }
+        au_data_free(image_modules.data);
+
+        au_program_del(&program);
+        au_vm_thread_local_del(&tl);
+        if (!success)
+            au_fatal("unable to write image %s\n", output_file);
     }
 #ifdef AU_FEAT_COMPILER
     else if (action_id == ACTION_BUILD) {
@@ -277,13 +374,14 @@ int main(int argc, char **argv) {
             au_c_comp_state_del(&c_state);
             au_program_del(&program);
         } else {
-            struct au_tmpfile tmp;
-            if (!au_tmpfile_new(&tmp))
-                au_perror("unable to create tmpfile");
-
             struct au_cc_options cc;
             au_cc_options_default(&cc);
+            if (jobs > 0)
+                cc.jobs = jobs;
+            if ((flags & FLAG_NO_CACHE) != 0)
+                cc.use_cache = 0;
 
+            options.split_units = 1;
             struct au_c_comp_state c_state = {0};
             struct au_interpreter_result result =
                 au_c_comp(&c_state, &program, &options, &cc);
@@ -301,11 +399,6 @@ int main(int argc, char **argv) {
                 return 1;
             }
 
-            fwrite(c_state.str.data, 1, c_state.str.len, tmp.f);
-            fflush(tmp.f);
-            au_tmpfile_close(&tmp);
-
-            au_c_comp_state_del(&c_state);
             au_program_del(&program);
 
             if ((flags & FLAG_NO_OPT) == 0) {
@@ -330,11 +423,13 @@ int main(int argc, char **argv) {
             au_str_array_add(&cc.ldflags, "-lm");
 #endif
 
-            int retval = au_spawn_cc(&cc, output_file, tmp.path);
+            int retval =
+                au_cc_build(&cc, output_file, c_state.units.data,
+                            c_state.units.len);
             if (retval != 0) {
                 printf("c compiler returned with exit code %d\n", retval);
             }
-            au_tmpfile_del(&tmp);
+            au_c_comp_state_del(&c_state);
             au_cc_options_del(&cc);
             return retval;
         }
@@ -3,12 +3,16 @@
 //
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #ifdef _WIN32
+#include <direct.h>
 #include <windows.h>
 #else
 #include <libgen.h>
@@ -22,15 +26,30 @@
 #include "cc.h"
 #include "path.h"
 #include "spawn.h"
+#include "tmpfile.h"
+
+static int default_jobs() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long jobs = (long)info.dwNumberOfProcessors;
+#else
+    const long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return jobs > 0 ? (int)jobs : 1;
+}
 
 void au_cc_options_default(struct au_cc_options *cc) {
     *cc = (struct au_cc_options){0};
     cc->use_stdlib = 1;
+    cc->jobs = default_jobs();
+    cc->use_cache = 1;
 }
 
 void au_cc_options_del(struct au_cc_options *cc) {
     au_data_free(cc->_stdlib_cache);
     au_data_free(cc->cflags.data);
+    au_data_free(cc->ldflags.data);
 }
 
 char *au_get_cc() {
@@ -42,8 +61,8 @@ char *au_get_cc() {
 
 static const char au_lib_file[] = "/libau_runtime.a";
 
-int au_spawn_cc(struct au_cc_options *cc, char *output_file,
-                char *input_file) {
+static int spawn_cc(struct au_cc_options *cc, char *output_file,
+                    char **input_files, size_t num_input_files) {
     struct au_str_array args = {0};
 
     char *cc_exec = au_get_cc();
@@ -56,7 +75,8 @@ int au_spawn_cc(struct au_cc_options *cc, char *output_file,
 
     au_str_array_add(&args, "-o");
     au_str_array_add(&args, output_file);
-    au_str_array_add(&args, input_file);
+    for (size_t i = 0; i < num_input_files; i++)
+        au_str_array_add(&args, input_files[i]);
 
     if (cc->use_stdlib) {
         if (!cc->_stdlib_cache) {
@@ -99,4 +119,301 @@ int au_spawn_cc(struct au_cc_options *cc, char *output_file,
 fail:
     au_data_free(args.data);
     return 1;
-}
\ No newline at end of file
+}
+
+int au_spawn_cc(struct au_cc_options *cc, char *output_file,
+                char *input_file) {
+    return spawn_cc(cc, output_file, &input_file, 1);
+}
+
+// ** Object cache **
+
+#ifdef _WIN32
+#define PATH_SEP "\\"
+#else
+#define PATH_SEP "/"
+#endif
+
+static char *join_path(const char *dir, const char *file) {
+    const size_t dir_len = strlen(dir);
+    const size_t file_len = strlen(file);
+    char *path = au_data_malloc(dir_len + 1 + file_len + 1);
+    memcpy(path, dir, dir_len);
+    path[dir_len] = PATH_SEP[0];
+    memcpy(&path[dir_len + 1], file, file_len);
+    path[dir_len + 1 + file_len] = 0;
+    return path;
+}
+
+static int make_dir(const char *path) {
+#ifdef _WIN32
+    if (_mkdir(path) == 0)
+        return 1;
+#else
+    if (mkdir(path, 0755) == 0)
+        return 1;
+#endif
+    struct stat st;
+    return stat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+char *au_cc_cache_dir() {
+    const char *dir = getenv("AU_CACHE_DIR");
+    if (dir != 0) {
+        if (dir[0] == 0 || !make_dir(dir))
+            return 0;
+        return au_data_strdup(dir);
+    }
+
+    char *parent = 0;
+#ifdef _WIN32
+    const char *local_app_data = getenv("LOCALAPPDATA");
+    if (local_app_data == 0)
+        return 0;
+    parent = au_data_strdup(local_app_data);
+#else
+    const char *xdg_cache = getenv("XDG_CACHE_HOME");
+    if (xdg_cache != 0 && xdg_cache[0] != 0) {
+        parent = au_data_strdup(xdg_cache);
+    } else {
+        const char *home = getenv("HOME");
+        if (home == 0 || home[0] == 0)
+            return 0;
+        parent = join_path(home, ".cache");
+    }
+#endif
+    char *path = 0;
+    if (make_dir(parent)) {
+        path = join_path(parent, "aument");
+        if (!make_dir(path)) {
+            au_data_free(path);
+            path = 0;
+        }
+    }
+    au_data_free(parent);
+    return path;
+}
+
+/// A 128-bit FNV-1a style hash. This isn't cryptographically secure,
+///     but collisions between object files are practically impossible.
+struct cache_hash {
+    uint64_t lo;
+    uint64_t hi;
+};
+
+static void cache_hash_update(struct cache_hash *hash, const void *data,
+                              size_t len) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash->lo = (hash->lo ^ bytes[i]) * 0x100000001b3ULL;
+        hash->hi = (hash->hi ^ bytes[i] ^ (hash->lo >> 32)) *
+                   0x9e3779b97f4a7c15ULL;
+    }
+    // Separates consecutive fields, so that ("ab", "c") and ("a", "bc")
+    // don't hash to the same value
+    const uint64_t len64 = (uint64_t)len;
+    const uint8_t *len_bytes = (const uint8_t *)&len64;
+    for (size_t i = 0; i < sizeof(len64); i++) {
+        hash->lo = (hash->lo ^ len_bytes[i]) * 0x100000001b3ULL;
+        hash->hi = (hash->hi ^ len_bytes[i] ^ (hash->lo >> 32)) *
+                   0x9e3779b97f4a7c15ULL;
+    }
+}
+
+static void cache_hash_str(struct cache_hash *hash, const char *str) {
+    cache_hash_update(hash, str, strlen(str));
+}
+
+/// Hashes the size and modification time of the C compiler's
+///     executable, so that objects built by another version of the
+///     compiler aren't reused
+static void cache_hash_cc_exec(struct cache_hash *hash,
+                               const char *cc_exec) {
+    struct stat st;
+    if (strchr(cc_exec, PATH_SEP[0]) != 0) {
+        if (stat(cc_exec, &st) != 0)
+            return;
+    } else {
+        const char *path_env = getenv("PATH");
+        if (path_env == 0)
+            return;
+#ifdef _WIN32
+        const char path_list_sep = ';';
+#else
+        const char path_list_sep = ':';
+#endif
+        int found = 0;
+        while (!found) {
+            const char *end = strchr(path_env, path_list_sep);
+            const size_t len =
+                end == 0 ? strlen(path_env) : (size_t)(end - path_env);
+            char *dir = au_data_strndup(path_env, len);
+            char *path = join_path(dir, cc_exec);
+            found = stat(path, &st) == 0;
+            au_data_free(path);
+            au_data_free(dir);
+            if (end == 0)
+                break;
+            path_env = end + 1;
+        }
+        if (!found)
+            return;
+    }
+    const uint64_t size = (uint64_t)st.st_size;
+    const uint64_t mtime = (uint64_t)st.st_mtime;
+    cache_hash_update(hash, &size, sizeof(size));
+    cache_hash_update(hash, &mtime, sizeof(mtime));
+}
+
+struct cc_unit {
+    struct au_tmpfile source;
+    /// Path of the object file passed to the linker
+    char *object;
+    /// Path the object file is compiled into before it is moved into
+    ///     the cache, or NULL
+    char *object_tmp;
+    au_process_t process;
+    int spawned;
+};
+
+static int cc_unit_spawn(struct au_cc_options *cc, struct cc_unit *unit) {
+    struct au_str_array args = {0};
+    au_str_array_add(&args, au_get_cc());
+    for (size_t i = 0; i < cc->cflags.len; i++)
+        au_str_array_add(&args, cc->cflags.data[i]);
+    au_str_array_add(&args, "-c");
+    au_str_array_add(&args, "-o");
+    au_str_array_add(&args,
+                     unit->object_tmp ? unit->object_tmp : unit->object);
+    au_str_array_add(&args, unit->source.path);
+    unit->spawned = au_spawn_async(&args, &unit->process);
+    au_data_free(args.data);
+    return unit->spawned;
+}
+
+static int cc_unit_wait(struct cc_unit *unit) {
+    unit->spawned = 0;
+    int retval = au_spawn_wait(unit->process);
+    if (unit->object_tmp == 0)
+        return retval;
+    if (retval == 0 && rename(unit->object_tmp, unit->object) != 0) {
+        // Another build may have stored the same object file
+        FILE *f = fopen(unit->object, "rb");
+        if (f != 0)
+            fclose(f);
+        else
+            retval = 1;
+    }
+    remove(unit->object_tmp);
+    return retval;
+}
+
+int au_cc_build(struct au_cc_options *cc, char *output_file,
+                const struct au_char_array *sources, size_t num_sources) {
+    char *cc_exec = au_get_cc();
+    char *cache_dir = cc->use_cache ? au_cc_cache_dir() : 0;
+
+    struct cache_hash flags_hash = {
+        .lo = 0xcbf29ce484222325ULL,
+        .hi = 0x6c62272e07bb0142ULL,
+    };
+    if (cache_dir != 0) {
+        cache_hash_str(&flags_hash, cc_exec);
+        cache_hash_cc_exec(&flags_hash, cc_exec);
+        for (size_t i = 0; i < cc->cflags.len; i++)
+            cache_hash_str(&flags_hash, cc->cflags.data[i]);
+    }
+
+    struct cc_unit *units =
+        au_data_calloc(num_sources, sizeof(struct cc_unit));
+    char **objects = au_data_calloc(num_sources, sizeof(char *));
+
+    int retval = 0;
+    const int jobs = cc->jobs > 0 ? cc->jobs : 1;
+    int running = 0;
+    size_t oldest = 0;
+    for (size_t i = 0; i < num_sources && retval == 0; i++) {
+        struct cc_unit *unit = &units[i];
+        const struct au_char_array *source = &sources[i];
+
+        if (cache_dir != 0) {
+            struct cache_hash hash = flags_hash;
+            cache_hash_update(&hash, source->data, source->len);
+            char name[64];
+            snprintf(name, sizeof(name), "%016llx%016llx.o",
+                     (unsigned long long)hash.hi,
+                     (unsigned long long)hash.lo);
+            unit->object = join_path(cache_dir, name);
+            objects[i] = unit->object;
+
+            FILE *f = fopen(unit->object, "rb");
+            if (f != 0) {
+                fclose(f);
+                continue;
+            }
+
+            char tmp_name[96];
+            snprintf(tmp_name, sizeof(tmp_name), "%s.%ld.tmp", name,
+                     (long)getpid());
+            unit->object_tmp = join_path(cache_dir, tmp_name);
+        } else {
+            struct au_tmpfile object;
+            if (!au_tmpfile_obj(&object)) {
+                retval = 1;
+                break;
+            }
+            au_tmpfile_close(&object);
+            unit->object = object.path;
+            objects[i] = unit->object;
+        }
+
+        if (!au_tmpfile_new(&unit->source)) {
+            retval = 1;
+            break;
+        }
+        fwrite(source->data, 1, source->len, unit->source.f);
+        au_tmpfile_close(&unit->source);
+
+        while (running >= jobs) {
+            if (units[oldest].spawned) {
+                const int unit_retval = cc_unit_wait(&units[oldest]);
+                if (retval == 0)
+                    retval = unit_retval;
+                running--;
+            }
+            oldest++;
+        }
+        if (retval != 0)
+            break;
+        if (!cc_unit_spawn(cc, unit)) {
+            retval = 1;
+            break;
+        }
+        running++;
+    }
+
+    for (size_t i = 0; i < num_sources; i++) {
+        if (units[i].spawned) {
+            const int unit_retval = cc_unit_wait(&units[i]);
+            if (retval == 0)
+                retval = unit_retval;
+        }
+    }
+
+    if (retval == 0)
+        retval = spawn_cc(cc, output_file, objects, num_sources);
+
+    for (size_t i = 0; i < num_sources; i++) {
+        struct cc_unit *unit = &units[i];
+        if (unit->source.path != 0)
+            au_tmpfile_del(&unit->source);
+        if (cache_dir == 0 && unit->object != 0)
+            remove(unit->object);
+        au_data_free(unit->object);
+        au_data_free(unit->object_tmp);
+    }
+    au_data_free(objects);
+    au_data_free(units);
+    au_data_free(cache_dir);
+    return retval;
+}
@@ -5,6 +5,7 @@
 // See LICENSE.txt for license information
 #pragma once
 
+#include "core/char_array.h"
 #include "core/str_array.h"
 #include "platform/platform.h"
 
@@ -14,6 +15,10 @@ struct au_cc_options {
     char *_stdlib_cache;
     int use_stdlib;
     int loads_dl;
+    /// Maximum number of C compiler processes run at the same time
+    int jobs;
+    /// Set if object files are to be reused from the object cache
+    int use_cache;
 };
 
 /// [func] Initializes an au_cc_options instance with default parameters
@@ -34,4 +39,26 @@ AU_PRIVATE char *au_get_cc();
 /// @param input_file path to the input file
 /// @return exit code of the C compiler
 AU_PUBLIC int au_spawn_cc(struct au_cc_options *cc, char *output_file,
-                          char *input_file);
\ No newline at end of file
+                          char *input_file);
+
+/// [func] Returns the path of the object cache directory, creating it if
+///     it doesn't exist. The path is taken from the `AU_CACHE_DIR`
+///     environment variable, or defaults to `aument` inside the user's
+///     cache directory.
+/// @return the path, which must be freed by the caller, or NULL if no
+///     cache directory is available
+AU_PRIVATE char *au_cc_cache_dir();
+
+/// [func] Compiles C translation units into object files, running up to
+///     cc->jobs compilers in parallel, and links them into an executable.
+///     If cc->use_cache is set, object files are stored in the object
+///     cache, keyed by a hash of the compiler, its flags and the
+///     source code, and are reused by later builds.
+/// @param cc options passed into the compiler
+/// @param output_file path to the output file
+/// @param sources source code of each translation unit
+/// @param num_sources number of translation units
+/// @return exit code of the first C compiler that failed, or 0
+AU_PUBLIC int au_cc_build(struct au_cc_options *cc, char *output_file,
+                          const struct au_char_array *sources,
+                          size_t num_sources);
@@ -59,6 +59,21 @@ fail:
     return 0;
 }
 
+int au_split_abspath(const char *path, char **file, char **wd) {
+#ifdef _WIN32
+    // GetFullPathNameA doesn't access the file system
+    return au_split_path(path, file, wd);
+#else
+    if (path[0] != '/')
+        return 0;
+    char *dir = au_data_strdup(path);
+    *wd = au_data_strdup(dirname(dir));
+    au_data_free(dir);
+    *file = au_data_strdup(path);
+    return 1;
+#endif
+}
+
 struct au_char_array au_binary_path() {
 #ifdef _WIN32
     char buffer[PATH_MAX];
@@ -85,8 +100,11 @@ struct au_char_array au_binary_path() {
     my_path[my_path_len + my_drive_len] = 0;
 #else
     char buffer[PATH_MAX];
-    if (readlink("/proc/self/exe", buffer, PATH_MAX) < 0)
+    const ssize_t buffer_len =
+        readlink("/proc/self/exe", buffer, PATH_MAX - 1);
+    if (buffer_len < 0)
         goto fail;
+    buffer[buffer_len] = 0;
     char *my_path = dirname(buffer);
 #endif
     const size_t ret_path_len = strlen(my_path);
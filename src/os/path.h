@@ -14,5 +14,14 @@
 /// @return 1 if successful, 0 if failed
 AU_PRIVATE int au_split_path(const char *path, char **file, char **wd);
 
+/// [func] Splits a canonical absolute path into file and directory
+///     components like au_split_path, without accessing the file system
+/// @param path the path to be split
+/// @param file output pointer to the file component
+/// @param wd output pointer to the directory component
+/// @return 1 if successful, 0 if failed
+AU_PRIVATE int au_split_abspath(const char *path, char **file,
+                                char **wd);
+
 /// [func] Gets the path containing the currently running Aument executable
 AU_PRIVATE struct au_char_array au_binary_path();
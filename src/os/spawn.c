@@ -3,10 +3,12 @@
 //
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
+#include <stdlib.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #ifdef _WIN32
+#include <process.h>
 #include <windows.h>
 #else
 #include <sys/wait.h>
@@ -15,24 +17,47 @@
 #include "spawn.h"
 
 int au_spawn(struct au_str_array *args) {
+    au_process_t process;
+    if (!au_spawn_async(args, &process))
+        return -1;
+    return au_spawn_wait(process);
+}
+
+int au_spawn_async(struct au_str_array *args, au_process_t *process) {
     au_str_array_add(args, 0);
 #ifdef _WIN32
-    return (int)_spawnvp(P_WAIT, au_str_array_at(args, 0),
-                         (const char *const *)args->data);
+    *process = _spawnvp(P_NOWAIT, au_str_array_at(args, 0),
+                        (const char *const *)args->data);
+    args->len--;
+    return *process != -1;
 #else
     pid_t pid = fork();
     if (pid == -1) {
         au_perror("fork");
     } else if (pid > 0) {
-        int status;
-        waitpid(pid, &status, 0);
         args->len--;
-        if (WIFEXITED(status))
-            return WEXITSTATUS(status);
-        return -1;
+        *process = pid;
+        return 1;
     } else {
         execvp(au_str_array_at(args, 0), args->data);
         exit(1);
     }
+    return 0;
+#endif
+}
+
+int au_spawn_wait(au_process_t process) {
+#ifdef _WIN32
+    int status;
+    if (_cwait(&status, process, 0) == -1)
+        return -1;
+    return status;
+#else
+    int status;
+    if (waitpid(process, &status, 0) == -1)
+        return -1;
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return -1;
 #endif
-}
\ No newline at end of file
+}
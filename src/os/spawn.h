@@ -5,8 +5,30 @@
 // See LICENSE.txt for license information
 #pragma once
 
+#include <stdint.h>
+#include <sys/types.h>
+
 #include "core/str_array.h"
 #include "platform/platform.h"
 
+#ifdef _WIN32
+typedef intptr_t au_process_t;
+#else
+typedef pid_t au_process_t;
+#endif
+
 /// [func] Spawns a program with arguments specified
-AU_PUBLIC int au_spawn(struct au_str_array *args);
\ No newline at end of file
+AU_PUBLIC int au_spawn(struct au_str_array *args);
+
+/// [func] Spawns a program with arguments specified without waiting
+///     for it to exit
+/// @param args the program and its arguments
+/// @param process output pointer to the spawned process
+/// @return 1 if successful, 0 if failed
+AU_PUBLIC int au_spawn_async(struct au_str_array *args,
+                             au_process_t *process);
+
+/// [func] Waits for a process spawned by au_spawn_async to exit
+/// @param process the process
+/// @return exit code of the process
+AU_PUBLIC int au_spawn_wait(au_process_t process);
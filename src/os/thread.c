@@ -0,0 +1,63 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "thread.h"
+
+#if defined(AU_FEAT_THREADS) && defined(_WIN32)
+static DWORD WINAPI thread_main(LPVOID arg) {
+    struct au_thread *thread = arg;
+    thread->fn(thread->arg);
+    return 0;
+}
+#elif defined(AU_FEAT_THREADS)
+static void *thread_main(void *arg) {
+    struct au_thread *thread = arg;
+    thread->fn(thread->arg);
+    return 0;
+}
+#endif
+
+int au_thread_start(struct au_thread *thread, au_thread_fn_t fn,
+                    void *arg) {
+    thread->fn = fn;
+    thread->arg = arg;
+#if !defined(AU_FEAT_THREADS)
+    return 0;
+#elif defined(_WIN32)
+    thread->_handle = CreateThread(0, 0, thread_main, thread, 0, 0);
+    return thread->_handle != 0;
+#else
+    return pthread_create(&thread->_handle, 0, thread_main, thread) == 0;
+#endif
+}
+
+void au_thread_join(struct au_thread *thread) {
+#if !defined(AU_FEAT_THREADS)
+    (void)thread;
+#elif defined(_WIN32)
+    WaitForSingleObject(thread->_handle, INFINITE);
+    CloseHandle(thread->_handle);
+#else
+    pthread_join(thread->_handle, 0);
+#endif
+}
+
+int au_thread_num_cpus() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long cpus = (long)info.dwNumberOfProcessors;
+#else
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return cpus > 0 ? (int)cpus : 1;
+}
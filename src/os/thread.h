@@ -0,0 +1,40 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#pragma once
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "platform/platform.h"
+
+typedef void (*au_thread_fn_t)(void *arg);
+
+struct au_thread {
+    au_thread_fn_t fn;
+    void *arg;
+#ifdef _WIN32
+    void *_handle;
+#else
+    pthread_t _handle;
+#endif
+};
+
+/// [func] Starts a thread that calls fn(arg). The au_thread instance
+///     must last until the thread is joined.
+/// @param thread the thread
+/// @param fn the function to be run
+/// @param arg argument passed to fn
+/// @return 1 if successful, 0 if failed
+AU_PRIVATE int au_thread_start(struct au_thread *thread,
+                               au_thread_fn_t fn, void *arg);
+
+/// [func] Waits for a thread started by au_thread_start to exit
+/// @param thread the thread
+AU_PRIVATE void au_thread_join(struct au_thread *thread);
+
+/// [func] Returns the number of processors that threads can run on
+AU_PRIVATE int au_thread_num_cpus();
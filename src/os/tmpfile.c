@@ -88,6 +88,10 @@ int au_tmpfile_new(struct au_tmpfile *tmp) {
 int au_tmpfile_exec(struct au_tmpfile *tmp) {
     return new_tmpfile(tmp, ".exe");
 }
+
+int au_tmpfile_obj(struct au_tmpfile *tmp) {
+    return new_tmpfile(tmp, ".obj");
+}
 #else
 #define TMPFILE_TEMPLATE "/tmp/au-XXXXXX"
 
@@ -117,4 +121,8 @@ int au_tmpfile_new(struct au_tmpfile *tmp) {
 int au_tmpfile_exec(struct au_tmpfile *tmp) {
     return new_tmpfile(tmp, "");
 }
+
+int au_tmpfile_obj(struct au_tmpfile *tmp) {
+    return new_tmpfile(tmp, ".o");
+}
 #endif
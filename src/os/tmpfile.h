@@ -26,3 +26,6 @@ AU_PUBLIC int au_tmpfile_new(struct au_tmpfile *tmp);
 
 /// [func] Creates an empty executable file
 AU_PUBLIC int au_tmpfile_exec(struct au_tmpfile *tmp);
+
+/// [func] Creates an empty object file
+AU_PUBLIC int au_tmpfile_obj(struct au_tmpfile *tmp);
@@ -5,23 +5,67 @@
 // See LICENSE.txt for license information
 #ifdef AU_IS_INTERPRETER
 #pragma once
+#include <stdint.h>
+
 #include "platform.h"
 #endif
 
-static AU_UNUSED AU_ALWAYS_INLINE int au_platform_iadd_wrap(int a, int b) {
-    int res;
-    __builtin_sadd_overflow(a, b, &res);
-    return res;
+/// Number of bits in an integer value. Integers are stored inline in the
+/// 48 data bits of a NaN-tagged value, and every value representation
+/// uses the same range so that programs behave the same way.
+#define AU_INT_BITS 48
+
+/// Smallest integer that fits in a value
+#define AU_INT_MIN (-(INT64_C(1) << (AU_INT_BITS - 1)))
+
+/// Largest integer that fits in a value
+#define AU_INT_MAX ((INT64_C(1) << (AU_INT_BITS - 1)) - 1)
+
+/// [func] Wraps an integer into the range of integers that fit in a value
+static AU_UNUSED AU_ALWAYS_INLINE int64_t au_platform_iwrap(int64_t a) {
+    return (int64_t)((uint64_t)a << (64 - AU_INT_BITS)) >>
+           (64 - AU_INT_BITS);
+}
+
+/// [func] Checks if an integer fits in a value
+static AU_UNUSED AU_ALWAYS_INLINE int au_platform_ifits(int64_t a) {
+    return au_platform_iwrap(a) == a;
+}
+
+/// [func] Adds two integers
+/// @param res the sum
+/// @return 1 if the sum doesn't fit in a value, 0 otherwise
+static AU_UNUSED AU_ALWAYS_INLINE int
+au_platform_iadd_overflow(int64_t a, int64_t b, int64_t *res) {
+    return __builtin_add_overflow(a, b, res) | !au_platform_ifits(*res);
+}
+
+/// [func] Subtracts two integers
+/// @param res the difference
+/// @return 1 if the difference doesn't fit in a value, 0 otherwise
+static AU_UNUSED AU_ALWAYS_INLINE int
+au_platform_isub_overflow(int64_t a, int64_t b, int64_t *res) {
+    return __builtin_sub_overflow(a, b, res) | !au_platform_ifits(*res);
 }
 
-static AU_UNUSED AU_ALWAYS_INLINE int au_platform_isub_wrap(int a, int b) {
-    int res;
-    __builtin_ssub_overflow(a, b, &res);
-    return res;
+/// [func] Multiplies two integers
+/// @param res the product
+/// @return 1 if the product doesn't fit in a value, 0 otherwise
+static AU_UNUSED AU_ALWAYS_INLINE int
+au_platform_imul_overflow(int64_t a, int64_t b, int64_t *res) {
+    return __builtin_mul_overflow(a, b, res) | !au_platform_ifits(*res);
 }
 
-static AU_UNUSED AU_ALWAYS_INLINE int au_platform_imul_wrap(int a, int b) {
-    int res;
-    __builtin_smul_overflow(a, b, &res);
-    return res;
+/// [func] Shifts an integer to the left
+/// @param res the shifted integer
+/// @return 1 if the shifted integer doesn't fit in a value or b is
+///     negative, 0 otherwise
+static AU_UNUSED AU_ALWAYS_INLINE int
+au_platform_ishl_overflow(int64_t a, int64_t b, int64_t *res) {
+    if (b < 0 || b >= AU_INT_BITS) {
+        *res = 0;
+        return b < 0 || a != 0;
+    }
+    *res = (int64_t)((uint64_t)a << b);
+    return (*res >> b) != a || !au_platform_ifits(*res);
 }
@@ -243,7 +243,8 @@ typedef uint64_t ULLong;
 #define PRIVATE_MEM 2304
 #endif
 #define PRIVATE_mem ((PRIVATE_MEM + sizeof(double) - 1) / sizeof(double))
-static double private_mem[PRIVATE_mem], *pmem_next = private_mem;
+static AU_THREAD_LOCAL double private_mem[PRIVATE_mem];
+static AU_THREAD_LOCAL size_t pmem_next = 0;
 
 typedef union {
     double d;
@@ -422,7 +423,7 @@ typedef struct Bigint Bigint;
    Bfree to PyMem_Free.  Investigate whether this has any significant
    performance on impact. */
 
-static Bigint *freelist[Kmax + 1];
+static AU_THREAD_LOCAL Bigint *freelist[Kmax + 1];
 
 /* Allocate space for a Bigint with up to 1<<k digits */
 
@@ -439,8 +440,8 @@ static Bigint *Balloc(int k) {
                1) /
               sizeof(double);
         if (k <= Kmax &&
-            pmem_next - private_mem + len <= (ssize_t)PRIVATE_mem) {
-            rv = (Bigint *)pmem_next;
+            pmem_next + len <= PRIVATE_mem) {
+            rv = (Bigint *)&private_mem[pmem_next];
             pmem_next += len;
         } else {
             rv = (Bigint *)MALLOC(len * sizeof(double));
@@ -735,7 +736,7 @@ static Bigint *mult(Bigint *a, Bigint *b) {
 
 /* p5s is a linked list of powers of 5 of the form 5**(2**i), i >= 2 */
 
-static Bigint *p5s;
+static AU_THREAD_LOCAL Bigint *p5s;
 
 /* multiply the Bigint b by 5**k.  Returns a pointer to the result, or NULL
    on failure; if the returned pointer is distinct from b then the original
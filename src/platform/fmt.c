@@ -0,0 +1,432 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#include <stdint.h>
+#include <string.h>
+
+#include "dconv.h"
+#include "fmt.h"
+
+// ** Integers **
+
+static const char digit_pairs[201] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+/// Writes the digits of num backwards, ending right before end
+/// @return pointer to the first digit
+static char *fmt_digits_backwards(uint64_t num, char *end) {
+    while (num >= 100) {
+        const size_t pair = (size_t)(num % 100) * 2;
+        num /= 100;
+        end -= 2;
+        end[0] = digit_pairs[pair];
+        end[1] = digit_pairs[pair + 1];
+    }
+    if (num >= 10) {
+        end -= 2;
+        end[0] = digit_pairs[num * 2];
+        end[1] = digit_pairs[num * 2 + 1];
+    } else {
+        end--;
+        end[0] = (char)('0' + num);
+    }
+    return end;
+}
+
+size_t au_fmt_int(int64_t num, char *buf) {
+    char tmp[AU_FMT_INT_MAX_LEN];
+    char *end = &tmp[AU_FMT_INT_MAX_LEN];
+    // The absolute value is computed in unsigned arithmetic so that
+    // INT64_MIN doesn't overflow
+    const uint64_t abs_num = num < 0 ? 0 - (uint64_t)num : (uint64_t)num;
+    char *start = fmt_digits_backwards(abs_num, end);
+    if (num < 0) {
+        start--;
+        start[0] = '-';
+    }
+    const size_t len = (size_t)(end - start);
+    memcpy(buf, start, len);
+    return len;
+}
+
+// ** Doubles **
+// The shortest digits of a double are generated with Grisu3 (Florian
+// Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+// Integers", 2010). Grisu3 finds out by itself when it can't guarantee
+// the shortest result, which happens for about 0.5% of doubles. Those
+// fall back to the slower au_dconv_dtoa.
+
+/// A floating-point number f * 2^e with a 64-bit significand
+struct diy_fp {
+    uint64_t f;
+    int e;
+};
+
+#define DIY_FP_SIGNIFICAND_SIZE 64
+#define DOUBLE_SIGNIFICAND_SIZE 53
+#define DOUBLE_EXPONENT_BIAS (0x3FF + DOUBLE_SIGNIFICAND_SIZE - 1)
+#define DOUBLE_DENORMAL_EXPONENT (-DOUBLE_EXPONENT_BIAS + 1)
+#define DOUBLE_SIGNIFICAND_MASK UINT64_C(0x000FFFFFFFFFFFFF)
+#define DOUBLE_EXPONENT_MASK UINT64_C(0x7FF0000000000000)
+#define DOUBLE_HIDDEN_BIT UINT64_C(0x0010000000000000)
+
+/// Range of binary exponents that the scaled number must be in for the
+/// digit generation to work with 32-bit integral parts
+#define MIN_TARGET_EXPONENT (-60)
+#define MAX_TARGET_EXPONENT (-32)
+
+static struct diy_fp diy_fp_mul(struct diy_fp x, struct diy_fp y) {
+    const uint64_t mask = UINT64_C(0xFFFFFFFF);
+    const uint64_t a = x.f >> 32, b = x.f & mask;
+    const uint64_t c = y.f >> 32, d = y.f & mask;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    // The lower half of the product only matters for rounding
+    uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+    tmp += UINT64_C(1) << 31;
+    return (struct diy_fp){
+        .f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32),
+        .e = x.e + y.e + 64,
+    };
+}
+
+static struct diy_fp diy_fp_normalize(struct diy_fp x) {
+    while ((x.f & (UINT64_C(1) << 63)) == 0) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+struct cached_power {
+    uint64_t f;
+    int16_t e;
+    int16_t decimal_e;
+};
+
+/// Normalized approximations of 10^-348, 10^-340, ..., 10^340
+static const struct cached_power cached_powers[] = {
+    {UINT64_C(0xfa8fd5a0081c0288), -1220, -348},
+    {UINT64_C(0xbaaee17fa23ebf76), -1193, -340},
+    {UINT64_C(0x8b16fb203055ac76), -1166, -332},
+    {UINT64_C(0xcf42894a5dce35ea), -1140, -324},
+    {UINT64_C(0x9a6bb0aa55653b2d), -1113, -316},
+    {UINT64_C(0xe61acf033d1a45df), -1087, -308},
+    {UINT64_C(0xab70fe17c79ac6ca), -1060, -300},
+    {UINT64_C(0xff77b1fcbebcdc4f), -1034, -292},
+    {UINT64_C(0xbe5691ef416bd60c), -1007, -284},
+    {UINT64_C(0x8dd01fad907ffc3c), -980, -276},
+    {UINT64_C(0xd3515c2831559a83), -954, -268},
+    {UINT64_C(0x9d71ac8fada6c9b5), -927, -260},
+    {UINT64_C(0xea9c227723ee8bcb), -901, -252},
+    {UINT64_C(0xaecc49914078536d), -874, -244},
+    {UINT64_C(0x823c12795db6ce57), -847, -236},
+    {UINT64_C(0xc21094364dfb5637), -821, -228},
+    {UINT64_C(0x9096ea6f3848984f), -794, -220},
+    {UINT64_C(0xd77485cb25823ac7), -768, -212},
+    {UINT64_C(0xa086cfcd97bf97f4), -741, -204},
+    {UINT64_C(0xef340a98172aace5), -715, -196},
+    {UINT64_C(0xb23867fb2a35b28e), -688, -188},
+    {UINT64_C(0x84c8d4dfd2c63f3b), -661, -180},
+    {UINT64_C(0xc5dd44271ad3cdba), -635, -172},
+    {UINT64_C(0x936b9fcebb25c996), -608, -164},
+    {UINT64_C(0xdbac6c247d62a584), -582, -156},
+    {UINT64_C(0xa3ab66580d5fdaf6), -555, -148},
+    {UINT64_C(0xf3e2f893dec3f126), -529, -140},
+    {UINT64_C(0xb5b5ada8aaff80b8), -502, -132},
+    {UINT64_C(0x87625f056c7c4a8b), -475, -124},
+    {UINT64_C(0xc9bcff6034c13053), -449, -116},
+    {UINT64_C(0x964e858c91ba2655), -422, -108},
+    {UINT64_C(0xdff9772470297ebd), -396, -100},
+    {UINT64_C(0xa6dfbd9fb8e5b88f), -369, -92},
+    {UINT64_C(0xf8a95fcf88747d94), -343, -84},
+    {UINT64_C(0xb94470938fa89bcf), -316, -76},
+    {UINT64_C(0x8a08f0f8bf0f156b), -289, -68},
+    {UINT64_C(0xcdb02555653131b6), -263, -60},
+    {UINT64_C(0x993fe2c6d07b7fac), -236, -52},
+    {UINT64_C(0xe45c10c42a2b3b06), -210, -44},
+    {UINT64_C(0xaa242499697392d3), -183, -36},
+    {UINT64_C(0xfd87b5f28300ca0e), -157, -28},
+    {UINT64_C(0xbce5086492111aeb), -130, -20},
+    {UINT64_C(0x8cbccc096f5088cc), -103, -12},
+    {UINT64_C(0xd1b71758e219652c), -77, -4},
+    {UINT64_C(0x9c40000000000000), -50, 4},
+    {UINT64_C(0xe8d4a51000000000), -24, 12},
+    {UINT64_C(0xad78ebc5ac620000), 3, 20},
+    {UINT64_C(0x813f3978f8940984), 30, 28},
+    {UINT64_C(0xc097ce7bc90715b3), 56, 36},
+    {UINT64_C(0x8f7e32ce7bea5c70), 83, 44},
+    {UINT64_C(0xd5d238a4abe98068), 109, 52},
+    {UINT64_C(0x9f4f2726179a2245), 136, 60},
+    {UINT64_C(0xed63a231d4c4fb27), 162, 68},
+    {UINT64_C(0xb0de65388cc8ada8), 189, 76},
+    {UINT64_C(0x83c7088e1aab65db), 216, 84},
+    {UINT64_C(0xc45d1df942711d9a), 242, 92},
+    {UINT64_C(0x924d692ca61be758), 269, 100},
+    {UINT64_C(0xda01ee641a708dea), 295, 108},
+    {UINT64_C(0xa26da3999aef774a), 322, 116},
+    {UINT64_C(0xf209787bb47d6b85), 348, 124},
+    {UINT64_C(0xb454e4a179dd1877), 375, 132},
+    {UINT64_C(0x865b86925b9bc5c2), 402, 140},
+    {UINT64_C(0xc83553c5c8965d3d), 428, 148},
+    {UINT64_C(0x952ab45cfa97a0b3), 455, 156},
+    {UINT64_C(0xde469fbd99a05fe3), 481, 164},
+    {UINT64_C(0xa59bc234db398c25), 508, 172},
+    {UINT64_C(0xf6c69a72a3989f5c), 534, 180},
+    {UINT64_C(0xb7dcbf5354e9bece), 561, 188},
+    {UINT64_C(0x88fcf317f22241e2), 588, 196},
+    {UINT64_C(0xcc20ce9bd35c78a5), 614, 204},
+    {UINT64_C(0x98165af37b2153df), 641, 212},
+    {UINT64_C(0xe2a0b5dc971f303a), 667, 220},
+    {UINT64_C(0xa8d9d1535ce3b396), 694, 228},
+    {UINT64_C(0xfb9b7cd9a4a7443c), 720, 236},
+    {UINT64_C(0xbb764c4ca7a44410), 747, 244},
+    {UINT64_C(0x8bab8eefb6409c1a), 774, 252},
+    {UINT64_C(0xd01fef10a657842c), 800, 260},
+    {UINT64_C(0x9b10a4e5e9913129), 827, 268},
+    {UINT64_C(0xe7109bfba19c0c9d), 853, 276},
+    {UINT64_C(0xac2820d9623bf429), 880, 284},
+    {UINT64_C(0x80444b5e7aa7cf85), 907, 292},
+    {UINT64_C(0xbf21e44003acdd2d), 933, 300},
+    {UINT64_C(0x8e679c2f5e44ff8f), 960, 308},
+    {UINT64_C(0xd433179d9c8cb841), 986, 316},
+    {UINT64_C(0x9e19db92b4e31ba9), 1013, 324},
+    {UINT64_C(0xeb96bf6ebadf77d9), 1039, 332},
+    {UINT64_C(0xaf87023b9bf0ee6b), 1066, 340},
+};
+
+#define CACHED_POWERS_OFFSET 348
+#define CACHED_POWERS_DISTANCE 8
+
+/// Finds a cached power of ten c such that the binary exponent of
+///     c * 2^e lies between MIN_TARGET_EXPONENT and MAX_TARGET_EXPONENT
+/// @param e binary exponent of a normalized number
+static struct cached_power cached_power_for(int e) {
+    const int min_e = MIN_TARGET_EXPONENT - (e + DIY_FP_SIGNIFICAND_SIZE);
+    // k = ceil((min_e + 63) * log10(2))
+    const double k_approx =
+        (min_e + DIY_FP_SIGNIFICAND_SIZE - 1) * 0.30102999566398114;
+    int k = (int)k_approx;
+    if (k_approx > (double)k)
+        k++;
+    const int idx =
+        (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_DISTANCE + 1;
+    return cached_powers[idx];
+}
+
+/// Moves the last digit towards w while the result stays inside the
+///     safe interval, and checks if the result is guaranteed to be the
+///     closest shortest representation
+static int grisu_round_weed(char *buf, size_t len,
+                            uint64_t distance_too_high_w,
+                            uint64_t unsafe_interval, uint64_t rest,
+                            uint64_t ten_kappa, uint64_t unit) {
+    const uint64_t small_distance = distance_too_high_w - unit;
+    const uint64_t big_distance = distance_too_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance ||
+            small_distance - rest >= rest + ten_kappa - small_distance)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance ||
+         big_distance - rest > rest + ten_kappa - big_distance))
+        return 0;
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static const uint32_t small_powers_of_ten[] = {
+    0,      1,       10,       100,       1000,
+    10000,  100000,  1000000,  10000000,  100000000,
+    1000000000,
+};
+
+/// Generates the digits of w, which is scaled so that its binary
+///     exponent lies between MIN_TARGET_EXPONENT and MAX_TARGET_EXPONENT
+/// @param low lower boundary of w
+/// @param high upper boundary of w
+/// @param kappa set to the decimal exponent of the last digit
+/// @return 1 if the digits are the shortest representation, 0 if
+///     Grisu3 can't tell
+static int grisu_digit_gen(struct diy_fp low, struct diy_fp w,
+                           struct diy_fp high, char *buf, size_t *len,
+                           int *kappa) {
+    uint64_t unit = 1;
+    const struct diy_fp too_low = {.f = low.f - unit, .e = low.e};
+    const struct diy_fp too_high = {.f = high.f + unit, .e = high.e};
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    const int one_e = -w.e;
+    const uint64_t one_f = UINT64_C(1) << one_e;
+    uint32_t integrals = (uint32_t)(too_high.f >> one_e);
+    uint64_t fractionals = too_high.f & (one_f - 1);
+
+    // Find the largest power of ten that is smaller than or equal to
+    // integrals
+    const int integral_bits = DIY_FP_SIGNIFICAND_SIZE - one_e;
+    int divisor_exponent = ((integral_bits + 1) * 1233 >> 12) + 1;
+    if (integrals < small_powers_of_ten[divisor_exponent])
+        divisor_exponent--;
+    uint32_t divisor = small_powers_of_ten[divisor_exponent];
+
+    *kappa = divisor_exponent;
+    *len = 0;
+    while (*kappa > 0) {
+        buf[(*len)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        (*kappa)--;
+        const uint64_t rest =
+            ((uint64_t)integrals << one_e) + fractionals;
+        if (rest < unsafe_interval)
+            return grisu_round_weed(buf, *len, too_high.f - w.f,
+                                    unsafe_interval, rest,
+                                    (uint64_t)divisor << one_e, unit);
+        divisor /= 10;
+    }
+    while (1) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buf[(*len)++] = (char)('0' + (fractionals >> one_e));
+        fractionals &= one_f - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval)
+            return grisu_round_weed(buf, *len, (too_high.f - w.f) * unit,
+                                    unsafe_interval, fractionals, one_f,
+                                    unit);
+    }
+}
+
+/// Generates the shortest digits of a positive, finite double
+/// @param buf buffer of at least 18 bytes
+/// @param decimal_e set so that num = digits * 10^decimal_e
+/// @return 1 on success, 0 if the result isn't guaranteed to be the
+///     shortest
+static int grisu3(double num, char *buf, size_t *len, int *decimal_e) {
+    uint64_t bits;
+    memcpy(&bits, &num, sizeof(bits));
+    const int biased_e = (int)((bits & DOUBLE_EXPONENT_MASK) >>
+                               (DOUBLE_SIGNIFICAND_SIZE - 1));
+    struct diy_fp v;
+    if (biased_e == 0) {
+        v.f = bits & DOUBLE_SIGNIFICAND_MASK;
+        v.e = DOUBLE_DENORMAL_EXPONENT;
+    } else {
+        v.f = (bits & DOUBLE_SIGNIFICAND_MASK) + DOUBLE_HIDDEN_BIT;
+        v.e = biased_e - DOUBLE_EXPONENT_BIAS;
+    }
+
+    // Boundaries halfway between num and its neighbours. The lower
+    // neighbour is closer if num is a power of two.
+    const struct diy_fp plus = diy_fp_normalize(
+        (struct diy_fp){.f = (v.f << 1) + 1, .e = v.e - 1});
+    struct diy_fp minus;
+    if ((bits & DOUBLE_SIGNIFICAND_MASK) == 0 && biased_e > 1)
+        minus = (struct diy_fp){.f = (v.f << 2) - 1, .e = v.e - 2};
+    else
+        minus = (struct diy_fp){.f = (v.f << 1) - 1, .e = v.e - 1};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    const struct diy_fp w = diy_fp_normalize(v);
+    const struct cached_power power = cached_power_for(w.e);
+    const struct diy_fp c_mk = {.f = power.f, .e = power.e};
+
+    int kappa;
+    const int ok =
+        grisu_digit_gen(diy_fp_mul(minus, c_mk), diy_fp_mul(w, c_mk),
+                        diy_fp_mul(plus, c_mk), buf, len, &kappa);
+    *decimal_e = -power.decimal_e + kappa;
+    return ok;
+}
+
+/// Writes digits with the decimal point at position decpt, so that the
+///     number is 0.digits * 10^decpt
+static size_t fmt_decimal(const char *digits, int len, int decpt,
+                          char *buf) {
+    char *out = buf;
+    if (len <= decpt && decpt <= 21) {
+        // Integer: 1230000
+        memcpy(out, digits, len);
+        out += len;
+        memset(out, '0', decpt - len);
+        out += decpt - len;
+    } else if (0 < decpt && decpt <= 21) {
+        // 12.34
+        memcpy(out, digits, decpt);
+        out += decpt;
+        *out++ = '.';
+        memcpy(out, &digits[decpt], len - decpt);
+        out += len - decpt;
+    } else if (-6 < decpt && decpt <= 0) {
+        // 0.001234
+        *out++ = '0';
+        *out++ = '.';
+        memset(out, '0', -decpt);
+        out += -decpt;
+        memcpy(out, digits, len);
+        out += len;
+    } else {
+        // 1.234e+21
+        *out++ = digits[0];
+        if (len > 1) {
+            *out++ = '.';
+            memcpy(out, &digits[1], len - 1);
+            out += len - 1;
+        }
+        *out++ = 'e';
+        const int exponent = decpt - 1;
+        *out++ = exponent < 0 ? '-' : '+';
+        out += au_fmt_int(exponent < 0 ? -exponent : exponent, out);
+    }
+    return (size_t)(out - buf);
+}
+
+size_t au_fmt_double(double num, char *buf) {
+    uint64_t bits;
+    memcpy(&bits, &num, sizeof(bits));
+    char *out = buf;
+    if ((bits >> 63) != 0) {
+        *out++ = '-';
+        bits &= ~(UINT64_C(1) << 63);
+        memcpy(&num, &bits, sizeof(bits));
+    }
+
+    if ((bits & DOUBLE_EXPONENT_MASK) == DOUBLE_EXPONENT_MASK) {
+        if ((bits & DOUBLE_SIGNIFICAND_MASK) != 0) {
+            // NaN is printed without a sign
+            memcpy(buf, "nan", 3);
+            return 3;
+        }
+        memcpy(out, "inf", 3);
+        return (size_t)(out - buf) + 3;
+    }
+    if (bits == 0) {
+        *out++ = '0';
+        return (size_t)(out - buf);
+    }
+
+    char digits[18];
+    size_t len;
+    int decimal_e;
+    if (grisu3(num, digits, &len, &decimal_e))
+        return (size_t)(out - buf) +
+               fmt_decimal(digits, (int)len, (int)len + decimal_e, out);
+
+    int decpt, sign;
+    char *end;
+    char *dtoa_digits = au_dconv_dtoa(num, 0, 0, &decpt, &sign, &end);
+    const size_t dtoa_len =
+        fmt_decimal(dtoa_digits, (int)(end - dtoa_digits), decpt, out);
+    au_dconv_freedtoa(dtoa_digits);
+    return (size_t)(out - buf) + dtoa_len;
+}
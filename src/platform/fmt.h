@@ -0,0 +1,34 @@
+// This source file is part of the Aument language
+// Copyright (c) 2021 the aument contributors
+//
+// Licensed under Apache License v2.0 with Runtime Library Exception
+// See LICENSE.txt for license information
+#ifdef AU_IS_INTERPRETER
+#pragma once
+#include "platform.h"
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+/// Size of a buffer that can hold any string written by au_fmt_int
+#define AU_FMT_INT_MAX_LEN 20
+
+/// Size of a buffer that can hold any string written by au_fmt_double
+#define AU_FMT_DOUBLE_MAX_LEN 32
+
+/// [func] Writes the base-10 representation of an integer into a buffer
+/// @param num the integer
+/// @param buf buffer of at least AU_FMT_INT_MAX_LEN bytes. The string
+///     isn't null-terminated.
+/// @return the length of the string
+AU_PRIVATE size_t au_fmt_int(int64_t num, char *buf);
+
+/// [func] Writes the shortest string that parses back into the same
+///     double into a buffer. Numbers with a decimal exponent between -7
+///     and 21 are written in fixed notation, and other numbers in
+///     scientific notation (1e+21).
+/// @param num the number
+/// @param buf buffer of at least AU_FMT_DOUBLE_MAX_LEN bytes. The string
+///     isn't null-terminated.
+/// @return the length of the string
+AU_PRIVATE size_t au_fmt_double(double num, char *buf);
@@ -25,6 +25,12 @@
 #define AU_ALWAYS_INLINE __attribute__((always_inline)) inline
 #endif
 
+#ifdef _MSC_VER
+#define AU_NO_INLINE __declspec(noinline)
+#else
+#define AU_NO_INLINE __attribute__((noinline))
+#endif
+
 #ifdef _MSC_VER
 #define AU_UNREACHABLE __assume(0)
 #else
@@ -34,7 +40,9 @@
 #define AU_LIKELY(x) __builtin_expect(!!(x), 1)
 #define AU_UNLIKELY(x) __builtin_expect(!!(x), 0)
 
-#ifdef _Thread_local
+#if defined(_MSC_VER)
+#define AU_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
 #define AU_THREAD_LOCAL _Thread_local
 #else
 #define AU_THREAD_LOCAL
@@ -4,9 +4,11 @@
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
 
+#include <math.h>
 #include <stdio.h>
 
 #include "core/rt/au_array.h"
+#include "core/rt/au_fn_value.h"
 #include "core/rt/extern_fn.h"
 #include "core/rt/value.h"
 #include "core/vm/vm.h"
@@ -25,11 +27,11 @@ AU_EXTERN_FUNC_DECL(au_std_array_repeat) {
     const au_value_t times_value = _args[1];
     if (au_value_get_type(times_value) != AU_VALUE_INT)
         goto fail;
-    const int32_t times = au_value_get_int(times_value);
+    const int64_t times = au_value_get_int(times_value);
 
     struct au_obj_array *array = au_obj_array_new(times);
 
-    for (int32_t i = 0; i < times; i++) {
+    for (int64_t i = 0; i < times; i++) {
         au_value_ref(repeat_value);
         au_obj_array_push(array, repeat_value);
     }
@@ -84,7 +86,7 @@ AU_EXTERN_FUNC_DECL(au_std_array_insert) {
 
     if (au_value_get_type(idx_value) != AU_VALUE_INT)
         goto fail;
-    const int32_t idx = au_value_get_int(idx_value);
+    const int64_t idx = au_value_get_int(idx_value);
 
     if (!au_obj_array_insert(array, idx, item_value))
         goto fail;
@@ -97,4 +99,399 @@ fail:
     au_value_deref(idx_value);
     au_value_deref(item_value);
     return au_value_none();
-}
\ No newline at end of file
+}
+
+// ** Sorting **
+
+// Arrays are sorted using introsort: quicksort with a median-of-3 pivot,
+// which falls back to heapsort when it recurses too deeply, and to
+// insertion sort on short ranges. The scans are bounds-checked, so
+// inconsistent comparators can't read out of bounds.
+
+#define INSERTION_SORT_MAX 16
+
+#define DEF_SORT(NAME, T, CTX, LESS)                                      \
+    static void NAME##_insertion(T *data, size_t len, CTX ctx) {          \
+        for (size_t i = 1; i < len; i++) {                                \
+            const T x = data[i];                                          \
+            size_t j = i;                                                 \
+            while (j > 0 && LESS(ctx, x, data[j - 1])) {                  \
+                data[j] = data[j - 1];                                    \
+                j--;                                                      \
+            }                                                             \
+            data[j] = x;                                                  \
+        }                                                                 \
+    }                                                                     \
+    static void NAME##_sift_down(T *data, size_t root, size_t len,        \
+                                 CTX ctx) {                               \
+        for (;;) {                                                        \
+            size_t child = 2 * root + 1;                                  \
+            if (child >= len)                                             \
+                break;                                                    \
+            if (child + 1 < len &&                                        \
+                LESS(ctx, data[child], data[child + 1]))                  \
+                child++;                                                  \
+            if (!LESS(ctx, data[root], data[child]))                      \
+                break;                                                    \
+            const T tmp = data[root];                                     \
+            data[root] = data[child];                                     \
+            data[child] = tmp;                                            \
+            root = child;                                                 \
+        }                                                                 \
+    }                                                                     \
+    static void NAME##_heapsort(T *data, size_t len, CTX ctx) {           \
+        for (size_t i = len / 2; i-- > 0;)                                \
+            NAME##_sift_down(data, i, len, ctx);                          \
+        for (size_t i = len; i-- > 1;) {                                  \
+            const T tmp = data[0];                                        \
+            data[0] = data[i];                                            \
+            data[i] = tmp;                                                \
+            NAME##_sift_down(data, 0, i, ctx);                            \
+        }                                                                 \
+    }                                                                     \
+    static void NAME##_intro(T *data, size_t len, int depth, CTX ctx) {   \
+        while (len > INSERTION_SORT_MAX) {                                \
+            if (depth-- == 0) {                                           \
+                NAME##_heapsort(data, len, ctx);                          \
+                return;                                                   \
+            }                                                             \
+            T tmp;                                                        \
+            /* Moves the median of the first, middle and last elements */ \
+            /* to data[0] */                                              \
+            const size_t mid = len / 2, last = len - 1;                   \
+            if (LESS(ctx, data[mid], data[0])) {                          \
+                tmp = data[mid], data[mid] = data[0], data[0] = tmp;      \
+            }                                                             \
+            if (LESS(ctx, data[last], data[mid])) {                       \
+                tmp = data[last], data[last] = data[mid];                 \
+                data[mid] = tmp;                                          \
+                if (LESS(ctx, data[mid], data[0])) {                      \
+                    tmp = data[mid], data[mid] = data[0], data[0] = tmp;  \
+                }                                                         \
+            }                                                             \
+            tmp = data[mid], data[mid] = data[0], data[0] = tmp;          \
+            const T pivot = data[0];                                      \
+            size_t i = 0, j = len;                                        \
+            for (;;) {                                                    \
+                do                                                        \
+                    i++;                                                  \
+                while (i < last && LESS(ctx, data[i], pivot));            \
+                do                                                        \
+                    j--;                                                  \
+                while (j > 0 && LESS(ctx, pivot, data[j]));               \
+                if (i >= j)                                               \
+                    break;                                                \
+                tmp = data[i], data[i] = data[j], data[j] = tmp;          \
+            }                                                             \
+            tmp = data[0], data[0] = data[j], data[j] = tmp;              \
+            /* Recurses into the smaller side, and loops on the */        \
+            /* larger one */                                              \
+            if (j < len - j - 1) {                                        \
+                NAME##_intro(data, j, depth, ctx);                        \
+                data += j + 1;                                            \
+                len -= j + 1;                                             \
+            } else {                                                      \
+                NAME##_intro(data + j + 1, len - j - 1, depth, ctx);      \
+                len = j;                                                  \
+            }                                                             \
+        }                                                                 \
+        NAME##_insertion(data, len, ctx);                                 \
+    }                                                                     \
+    static void NAME(T *data, size_t len, CTX ctx) {                      \
+        int depth = 0;                                                    \
+        for (size_t n = len; n > 1; n >>= 1)                              \
+            depth += 2;                                                   \
+        NAME##_intro(data, len, depth, ctx);                              \
+    }
+
+static inline double number_value(au_value_t value) {
+    if (au_value_get_type(value) == AU_VALUE_INT)
+        return (double)au_value_get_int(value);
+    return au_value_get_double(value);
+}
+
+#define INT_LESS(CTX, A, B) ((void)(CTX), (A) < (B))
+#define NUMBER_LESS(CTX, A, B)                                            \
+    ((void)(CTX), number_value(A) < number_value(B))
+#define STR_LESS(CTX, A, B)                                               \
+    ((void)(CTX),                                                         \
+     au_string_cmp(au_value_get_string(A), au_value_get_string(B)) < 0)
+#define FN_LESS(CTX, A, B) sort_by_less(CTX, A, B)
+
+struct sort_by_ctx {
+    struct au_vm_thread_local *tl;
+    const struct au_fn_value *fn_value;
+    int failed;
+};
+
+static int sort_by_less(struct sort_by_ctx *ctx, au_value_t left,
+                        au_value_t right) {
+    if (ctx->failed)
+        return 0;
+    au_value_t args[2] = {left, right};
+    au_value_ref(left);
+    au_value_ref(right);
+    int is_native = 0;
+    const au_value_t retval =
+        au_fn_value_call_vm(ctx->fn_value, ctx->tl, args, 2, &is_native);
+    if (au_value_is_error(retval)) {
+        ctx->failed = 1;
+        return 0;
+    }
+    const int is_less = au_value_is_truthy(retval);
+    au_value_deref(retval);
+    return is_less;
+}
+
+DEF_SORT(sort_ints, int64_t, void *, INT_LESS)
+DEF_SORT(sort_numbers, au_value_t, void *, NUMBER_LESS)
+DEF_SORT(sort_strs, au_value_t, void *, STR_LESS)
+DEF_SORT(sort_by_fn, au_value_t, struct sort_by_ctx *, FN_LESS)
+
+/// Sorts an array whose elements are all integers, floats or strings
+/// @return 1 if the elements could be compared, 0 otherwise
+static int sort_array(struct au_obj_array *array) {
+    if (array->shared != 0)
+        au_obj_array_unshare(array);
+    au_value_t *data = array->array.data;
+    const size_t len = array->array.len;
+    int has_int = 0, has_double = 0, has_str = 0;
+    for (size_t i = 0; i < len; i++) {
+        switch (au_value_get_type(data[i])) {
+        case AU_VALUE_INT:
+            has_int = 1;
+            break;
+        case AU_VALUE_DOUBLE:
+            has_double = 1;
+            break;
+        case AU_VALUE_STR:
+            has_str = 1;
+            break;
+        default:
+            return 0;
+        }
+    }
+    if (has_str) {
+        if (has_int || has_double)
+            return 0;
+        sort_strs(data, len, 0);
+    } else if (has_double) {
+        // NaNs aren't ordered, so they're moved to the end of the array
+        size_t num_ordered = 0;
+        for (size_t i = 0; i < len; i++) {
+            if (!isnan(number_value(data[i]))) {
+                const au_value_t tmp = data[num_ordered];
+                data[num_ordered++] = data[i];
+                data[i] = tmp;
+            }
+        }
+        sort_numbers(data, num_ordered, 0);
+    } else if (len > 1) {
+        // Integers are sorted unboxed
+        int64_t *keys = au_data_malloc(sizeof(int64_t) * len);
+        for (size_t i = 0; i < len; i++)
+            keys[i] = au_value_get_int(data[i]);
+        sort_ints(keys, len, 0);
+        for (size_t i = 0; i < len; i++)
+            data[i] = au_value_int(keys[i]);
+        au_data_free(keys);
+    }
+    return 1;
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_sort) {
+    const au_value_t array_value = _args[0];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0 || !sort_array(array))
+        goto fail;
+    return array_value;
+fail:
+    au_value_deref(array_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_sort_by) {
+    const au_value_t array_value = _args[0];
+    const au_value_t fn_value = _args[1];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    struct sort_by_ctx ctx = {
+        .tl = _tl,
+        .fn_value = au_fn_value_coerce(fn_value),
+        .failed = 0,
+    };
+    if (ctx.fn_value == 0)
+        goto fail;
+
+    // The comparator may modify the array, so a referenced copy of its
+    // elements is sorted. The copy replaces the elements unless the
+    // array was resized.
+    const size_t len = array->array.len;
+    au_value_t *values = au_value_calloc(len);
+    for (size_t i = 0; i < len; i++) {
+        values[i] = array->array.data[i];
+        au_value_ref(values[i]);
+    }
+    sort_by_fn(values, len, &ctx);
+    if (array->shared != 0)
+        au_obj_array_unshare(array);
+    for (size_t i = 0; i < len; i++) {
+        if (array->array.len == len) {
+            au_value_deref(array->array.data[i]);
+            array->array.data[i] = values[i];
+        } else {
+            au_value_deref(values[i]);
+        }
+    }
+    au_data_free(values);
+
+    au_value_deref(fn_value);
+    if (ctx.failed) {
+        au_value_deref(array_value);
+        return au_value_error();
+    }
+    return array_value;
+fail:
+    au_value_deref(array_value);
+    au_value_deref(fn_value);
+    return au_value_none();
+}
+
+static int value_less(au_value_t left, au_value_t right) {
+    return au_value_get_bool(au_value_lt(left, right));
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_binary_search) {
+    const au_value_t array_value = _args[0];
+    const au_value_t item = _args[1];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    size_t lo = 0, hi = array->array.len;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (value_less(array->array.data[mid], item))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    int64_t idx = -1;
+    if (lo < array->array.len && !value_less(item, array->array.data[lo]))
+        idx = (int64_t)lo;
+    au_value_deref(array_value);
+    au_value_deref(item);
+    return au_value_int(idx);
+fail:
+    au_value_deref(array_value);
+    au_value_deref(item);
+    return au_value_none();
+}
+
+// ** Bulk operations **
+
+AU_EXTERN_FUNC_DECL(au_std_array_copy) {
+    const au_value_t array_value = _args[0];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    struct au_obj_array *copy = au_obj_array_copy(array);
+    au_value_deref(array_value);
+    return au_value_struct((struct au_struct *)copy);
+fail:
+    au_value_deref(array_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_reverse) {
+    const au_value_t array_value = _args[0];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    if (array->shared != 0)
+        au_obj_array_unshare(array);
+    au_value_t *data = array->array.data;
+    for (size_t i = 0, j = array->array.len; i + 1 < j; i++, j--) {
+        const au_value_t tmp = data[i];
+        data[i] = data[j - 1];
+        data[j - 1] = tmp;
+    }
+    return array_value;
+fail:
+    au_value_deref(array_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_slice) {
+    const au_value_t array_value = _args[0];
+    const au_value_t start_value = _args[1];
+    const au_value_t end_value = _args[2];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    if (au_value_get_type(start_value) != AU_VALUE_INT ||
+        au_value_get_type(end_value) != AU_VALUE_INT)
+        goto fail;
+    const int64_t start = au_value_get_int(start_value);
+    const int64_t end = au_value_get_int(end_value);
+    if (start < 0 || start > end || (size_t)end > array->array.len)
+        goto fail;
+
+    struct au_obj_array *slice =
+        au_obj_array_slice(array, (size_t)start, (size_t)end);
+
+    au_value_deref(array_value);
+    au_value_deref(start_value);
+    au_value_deref(end_value);
+    return au_value_struct((struct au_struct *)slice);
+fail:
+    au_value_deref(array_value);
+    au_value_deref(start_value);
+    au_value_deref(end_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_concat) {
+    const au_value_t left_value = _args[0];
+    const au_value_t right_value = _args[1];
+    struct au_obj_array *left = au_obj_array_coerce(left_value);
+    struct au_obj_array *right = au_obj_array_coerce(right_value);
+    if (left == 0 || right == 0)
+        goto fail;
+
+    struct au_obj_array *array =
+        au_obj_array_new(left->array.len + right->array.len);
+    for (size_t i = 0; i < left->array.len; i++)
+        au_obj_array_push(array, left->array.data[i]);
+    for (size_t i = 0; i < right->array.len; i++)
+        au_obj_array_push(array, right->array.data[i]);
+
+    au_value_deref(left_value);
+    au_value_deref(right_value);
+    return au_value_struct((struct au_struct *)array);
+fail:
+    au_value_deref(left_value);
+    au_value_deref(right_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_array_extend) {
+    const au_value_t array_value = _args[0];
+    const au_value_t other_value = _args[1];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    struct au_obj_array *other = au_obj_array_coerce(other_value);
+    if (array == 0 || other == 0)
+        goto fail;
+
+    // The length is read first, as other may be the array itself
+    const size_t other_len = other->array.len;
+    for (size_t i = 0; i < other_len; i++)
+        au_obj_array_push(array, other->array.data[i]);
+
+    au_value_deref(other_value);
+    return array_value;
+fail:
+    au_value_deref(array_value);
+    au_value_deref(other_value);
+    return au_value_none();
+}
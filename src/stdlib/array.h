@@ -36,11 +36,72 @@ AU_EXTERN_FUNC_DECL(au_std_array_push);
 /// it returns nil.
 AU_EXTERN_FUNC_DECL(au_std_array_pop);
 
-/// [func-au] Pops an element from an array and returns it
+/// [func-au] Inserts an element into an array
 /// @name array::insert
-/// @param array array
-/// @param position position
-/// @param item item
-/// @return The popped element from the array. If the array is empty, then
-/// it returns nil.
+/// @param array the array
+/// @param position the index at which the element is inserted
+/// @param item the element
+/// @return The array, or nil if the position is out of bounds
 AU_EXTERN_FUNC_DECL(au_std_array_insert);
+
+/// [func-au] Sorts an array in ascending order, in the same order as the
+/// `<` operator. The sort isn't stable.
+/// @name array::sort
+/// @param array an array whose elements are all numbers
+///     (integers/floats) or all strings. NaNs are moved to the end.
+/// @return The array, or nil if its elements can't be compared
+AU_EXTERN_FUNC_DECL(au_std_array_sort);
+
+/// [func-au] Sorts an array using a comparator function. The sort isn't
+/// stable.
+/// @name array::sort_by
+/// @param array the array
+/// @param less a function taking 2 elements, which returns true if the
+///     first element goes before the second
+/// @return The array
+AU_EXTERN_FUNC_DECL(au_std_array_sort_by);
+
+/// [func-au] Searches for an element in a sorted array
+/// @name array::binary_search
+/// @param array an array sorted in ascending order
+/// @param item the element
+/// @return The index of an element equal to `item`, or -1 if there's
+/// none
+AU_EXTERN_FUNC_DECL(au_std_array_binary_search);
+
+/// [func-au] Copies an array. The copy takes constant time, as the
+/// elements are only copied once the array or its copy is modified.
+/// @name array::copy
+/// @param array the array
+/// @return The copy, or nil if the value isn't an array
+AU_EXTERN_FUNC_DECL(au_std_array_copy);
+
+/// [func-au] Reverses the order of the elements of an array
+/// @name array::reverse
+/// @param array the array
+/// @return The array
+AU_EXTERN_FUNC_DECL(au_std_array_reverse);
+
+/// [func-au] Copies a range of an array into a new array. Like
+/// array::copy, slices that cover a large part of the array share its
+/// elements until one of them is modified.
+/// @name array::slice
+/// @param array the array
+/// @param start index of the first element
+/// @param end index after the last element
+/// @return The new array, or nil if the range is out of bounds
+AU_EXTERN_FUNC_DECL(au_std_array_slice);
+
+/// [func-au] Joins 2 arrays into a new array
+/// @name array::concat
+/// @param a the first array
+/// @param b the second array
+/// @return The new array
+AU_EXTERN_FUNC_DECL(au_std_array_concat);
+
+/// [func-au] Appends the elements of an array to another array
+/// @name array::extend
+/// @param array the array that's extended
+/// @param other the array whose elements are appended
+/// @return The extended array
+AU_EXTERN_FUNC_DECL(au_std_array_extend);
@@ -23,11 +23,18 @@
 #include "test_fns.h"
 #endif
 
+#ifdef AU_FEAT_MATH_LIB
+#include <math.h>
+#endif
+
 struct std_module_fn {
     const char *name;
     const char *symbol;
     au_extern_func_t func;
     int32_t num_args;
+    enum au_lib_func_sig fast_sig;
+    au_extern_fast_func_t fast_func;
+    const char *fast_symbol;
 };
 
 struct std_module {
@@ -42,6 +49,16 @@ struct std_module {
         .num_args = NUM_ARGS                                              \
     }
 
+/// Declares a function with a typed fast path. FAST_SYMBOL must behave
+/// like SYMBOL when it's called with arguments of the types in SIG.
+#define AU_MODULE_FAST_FN(NAME, SYMBOL, NUM_ARGS, SIG, FAST_SYMBOL)       \
+    (struct std_module_fn) {                                              \
+        .name = NAME, .symbol = #SYMBOL, .func = SYMBOL,                  \
+        .num_args = NUM_ARGS, .fast_sig = AU_LIB_FUNC_SIG_##SIG,          \
+        .fast_func = (au_extern_fast_func_t)FAST_SYMBOL,                  \
+        .fast_symbol = #FAST_SYMBOL                                       \
+    }
+
 // * array.h *
 static const struct std_module_fn array_fns[] = {
     AU_MODULE_FN("is", au_std_array_is, 1),
@@ -49,6 +66,14 @@ static const struct std_module_fn array_fns[] = {
     AU_MODULE_FN("push", au_std_array_push, 2),
     AU_MODULE_FN("pop", au_std_array_pop, 1),
     AU_MODULE_FN("insert", au_std_array_insert, 3),
+    AU_MODULE_FN("sort", au_std_array_sort, 1),
+    AU_MODULE_FN("sort_by", au_std_array_sort_by, 2),
+    AU_MODULE_FN("binary_search", au_std_array_binary_search, 2),
+    AU_MODULE_FN("copy", au_std_array_copy, 1),
+    AU_MODULE_FN("reverse", au_std_array_reverse, 1),
+    AU_MODULE_FN("slice", au_std_array_slice, 3),
+    AU_MODULE_FN("concat", au_std_array_concat, 2),
+    AU_MODULE_FN("extend", au_std_array_extend, 2),
 };
 
 // * array.h *
@@ -85,6 +110,8 @@ static const struct std_module_fn io_fns[] = {
     AU_MODULE_FN("close", au_std_io_close, 1),
     AU_MODULE_FN("read", au_std_io_read, 1),
     AU_MODULE_FN("read_up_to", au_std_io_read_up_to, 2),
+    AU_MODULE_FN("read_line", au_std_io_read_line, 1),
+    AU_MODULE_FN("lines", au_std_io_lines, 1),
     AU_MODULE_FN("write", au_std_io_write, 2),
     AU_MODULE_FN("flush", au_std_io_flush, 1),
 };
@@ -98,42 +125,49 @@ static const struct std_module_fn list_fns[] = {
 #ifdef AU_FEAT_MATH_LIB
 // * math.h *
 static const struct std_module_fn math_fns[] = {
-    AU_MODULE_FN("abs", au_std_math_abs, 1),
+    AU_MODULE_FAST_FN("abs", au_std_math_abs, 1, D_D, fabs),
     AU_MODULE_FN("max", au_std_math_max, 2),
     AU_MODULE_FN("min", au_std_math_min, 2),
-    AU_MODULE_FN("exp", au_std_math_exp, 1),
-    AU_MODULE_FN("ln", au_std_math_ln, 1),
-    AU_MODULE_FN("log2", au_std_math_log2, 1),
-    AU_MODULE_FN("log10", au_std_math_log10, 1),
-    AU_MODULE_FN("sqrt", au_std_math_sqrt, 1),
-    AU_MODULE_FN("cbrt", au_std_math_cbrt, 1),
-    AU_MODULE_FN("hypot", au_std_math_hypot, 2),
-    AU_MODULE_FN("pow", au_std_math_pow, 2),
-    AU_MODULE_FN("sin", au_std_math_sin, 1),
-    AU_MODULE_FN("cos", au_std_math_cos, 1),
-    AU_MODULE_FN("tan", au_std_math_tan, 1),
-    AU_MODULE_FN("asin", au_std_math_asin, 1),
-    AU_MODULE_FN("acos", au_std_math_acos, 1),
-    AU_MODULE_FN("atan", au_std_math_atan, 1),
-    AU_MODULE_FN("atan2", au_std_math_atan2, 2),
-    AU_MODULE_FN("sinh", au_std_math_sinh, 1),
-    AU_MODULE_FN("cosh", au_std_math_cosh, 1),
-    AU_MODULE_FN("tanh", au_std_math_tanh, 1),
-    AU_MODULE_FN("asinh", au_std_math_asinh, 1),
-    AU_MODULE_FN("acosh", au_std_math_acosh, 1),
-    AU_MODULE_FN("atanh", au_std_math_atanh, 1),
-    AU_MODULE_FN("erf", au_std_math_erf, 1),
-    AU_MODULE_FN("erfc", au_std_math_erfc, 1),
-    AU_MODULE_FN("lgamma", au_std_math_lgamma, 1),
-    AU_MODULE_FN("tgamma", au_std_math_tgamma, 1),
-    AU_MODULE_FN("ceil", au_std_math_ceil, 1),
-    AU_MODULE_FN("floor", au_std_math_floor, 1),
-    AU_MODULE_FN("trunc", au_std_math_trunc, 1),
-    AU_MODULE_FN("round", au_std_math_round, 1),
+    AU_MODULE_FAST_FN("exp", au_std_math_exp, 1, D_D, exp),
+    AU_MODULE_FAST_FN("ln", au_std_math_ln, 1, D_D, log),
+    AU_MODULE_FAST_FN("log2", au_std_math_log2, 1, D_D, log2),
+    AU_MODULE_FAST_FN("log10", au_std_math_log10, 1, D_D, log10),
+    AU_MODULE_FAST_FN("sqrt", au_std_math_sqrt, 1, D_D, sqrt),
+    AU_MODULE_FAST_FN("cbrt", au_std_math_cbrt, 1, D_D, cbrt),
+    AU_MODULE_FAST_FN("hypot", au_std_math_hypot, 2, D_DD, hypot),
+    AU_MODULE_FAST_FN("pow", au_std_math_pow, 2, D_DD, pow),
+    AU_MODULE_FAST_FN("sin", au_std_math_sin, 1, D_D, sin),
+    AU_MODULE_FAST_FN("cos", au_std_math_cos, 1, D_D, cos),
+    AU_MODULE_FAST_FN("tan", au_std_math_tan, 1, D_D, tan),
+    AU_MODULE_FAST_FN("asin", au_std_math_asin, 1, D_D, asin),
+    AU_MODULE_FAST_FN("acos", au_std_math_acos, 1, D_D, acos),
+    AU_MODULE_FAST_FN("atan", au_std_math_atan, 1, D_D, atan),
+    AU_MODULE_FAST_FN("atan2", au_std_math_atan2, 2, D_DD, atan2),
+    AU_MODULE_FAST_FN("sinh", au_std_math_sinh, 1, D_D, sinh),
+    AU_MODULE_FAST_FN("cosh", au_std_math_cosh, 1, D_D, cosh),
+    AU_MODULE_FAST_FN("tanh", au_std_math_tanh, 1, D_D, tanh),
+    AU_MODULE_FAST_FN("asinh", au_std_math_asinh, 1, D_D, asinh),
+    AU_MODULE_FAST_FN("acosh", au_std_math_acosh, 1, D_D, acosh),
+    AU_MODULE_FAST_FN("atanh", au_std_math_atanh, 1, D_D, atanh),
+    AU_MODULE_FAST_FN("erf", au_std_math_erf, 1, D_D, erf),
+    AU_MODULE_FAST_FN("erfc", au_std_math_erfc, 1, D_D, erfc),
+    AU_MODULE_FAST_FN("lgamma", au_std_math_lgamma, 1, D_D, lgamma),
+    AU_MODULE_FAST_FN("tgamma", au_std_math_tgamma, 1, D_D, tgamma),
+    AU_MODULE_FAST_FN("ceil", au_std_math_ceil, 1, D_D, ceil),
+    AU_MODULE_FAST_FN("floor", au_std_math_floor, 1, D_D, floor),
+    AU_MODULE_FAST_FN("trunc", au_std_math_trunc, 1, D_D, trunc),
+    AU_MODULE_FAST_FN("round", au_std_math_round, 1, D_D, round),
     AU_MODULE_FN("is_finite", au_std_math_is_finite, 1),
     AU_MODULE_FN("is_infinite", au_std_math_is_infinite, 1),
     AU_MODULE_FN("is_nan", au_std_math_is_nan, 1),
     AU_MODULE_FN("is_normal", au_std_math_is_normal, 1),
+    AU_MODULE_FN("sum", au_std_math_sum, 1),
+    AU_MODULE_FN("dot", au_std_math_dot, 2),
+    AU_MODULE_FN("max_of", au_std_math_max_of, 1),
+    AU_MODULE_FN("min_of", au_std_math_min_of, 1),
+    AU_MODULE_FN("map_sqrt", au_std_math_map_sqrt, 1),
+    AU_MODULE_FN("elementwise_add", au_std_math_elementwise_add, 2),
+    AU_MODULE_FN("elementwise_mul", au_std_math_elementwise_mul, 2),
 };
 #endif
 
@@ -144,12 +178,18 @@ static const struct std_module_fn str_fns[] = {
     AU_MODULE_FN("ord", au_std_str_ord, 1),
     AU_MODULE_FN("bytes", au_std_str_bytes, 1),
     AU_MODULE_FN("code_points", au_std_str_code_points, 1),
+    AU_MODULE_FN("slice", au_std_str_slice, 3),
     AU_MODULE_FN("index_of", au_std_str_index_of, 2),
     AU_MODULE_FN("contains", au_std_str_contains, 2),
     AU_MODULE_FN("starts_with", au_std_str_starts_with, 2),
     AU_MODULE_FN("ends_with", au_std_str_ends_with, 2),
     AU_MODULE_FN("is_space", au_std_str_is_space, 1),
     AU_MODULE_FN("is_digit", au_std_str_is_digit, 1),
+    AU_MODULE_FN("split", au_std_str_split, 2),
+    AU_MODULE_FN("join", au_std_str_join, 2),
+    AU_MODULE_FN("replace", au_std_str_replace, 3),
+    AU_MODULE_FN("trim", au_std_str_trim, 1),
+    AU_MODULE_FN("repeat", au_std_str_repeat, 2),
 };
 
 // * sys.h *
@@ -161,6 +201,10 @@ static const struct std_module_fn sys_fns[] = {
 static const struct std_module_fn test_fns[] = {
     AU_MODULE_FN("test1", au_std_test_1, 1),
     AU_MODULE_FN("test2", au_std_test_2, 2),
+    AU_MODULE_FAST_FN("max", au_std_test_max, 2, I_II,
+                      au_std_test_max_fast),
+    AU_MODULE_FAST_FN("twice", au_std_test_twice, 1, I_I,
+                      au_std_test_twice_fast),
 };
 #endif
 
@@ -225,6 +269,9 @@ au_extern_module_t au_stdlib_module(size_t idx) {
             .func = std_fn->func,
             .name = std_fn->name,
             .symbol = std_fn->symbol,
+            .fast_sig = std_fn->fast_sig,
+            .fast_func = std_fn->fast_func,
+            .fast_symbol = std_fn->fast_symbol,
         };
         const au_hm_var_value_t fn_idx = module->fns.len;
         au_hm_vars_init(&module->fn_map);
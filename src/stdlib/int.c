@@ -5,6 +5,7 @@
 // See LICENSE.txt for license information
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "core/rt/extern_fn.h"
 #include "core/rt/value.h"
@@ -20,6 +21,17 @@ AU_EXTERN_FUNC_DECL(au_std_int_is) {
     return retval;
 }
 
+/// Converts a number into the nearest integer that fits in a value
+static int64_t clamp_int(double num) {
+    if (num != num)
+        return 0;
+    if (num <= (double)AU_INT_MIN)
+        return AU_INT_MIN;
+    if (num >= (double)AU_INT_MAX)
+        return AU_INT_MAX;
+    return (int64_t)num;
+}
+
 AU_EXTERN_FUNC_DECL(au_std_int_into) {
     const au_value_t value = _args[0];
     switch (au_value_get_type(value)) {
@@ -27,19 +39,19 @@ AU_EXTERN_FUNC_DECL(au_std_int_into) {
         return value;
     }
     case AU_VALUE_DOUBLE: {
-        return au_value_int((int)au_value_get_double(value));
+        return au_value_int(clamp_int(au_value_get_double(value)));
     }
     case AU_VALUE_STR: {
         const struct au_string *header = au_value_get_string(value);
-        int32_t num;
+        int64_t num;
         if (header->len < MAX_SMALL_STRING) {
             char string[MAX_SMALL_STRING] = {0};
             memcpy(string, header->data, header->len);
             string[header->len] = 0;
-            num = atoi(string);
+            num = clamp_int((double)strtoll(string, 0, 10));
         } else {
             char *string = au_data_strndup(header->data, header->len);
-            num = atoi(string);
+            num = clamp_int((double)strtoll(string, 0, 10));
             au_data_free(string);
         }
         return au_value_int(num);
@@ -19,6 +19,8 @@ AU_EXTERN_FUNC_DECL(au_std_int_is);
 /// * For *float* inputs, the result is its integer equivalent.\n
 /// * For *string* inputs, the result is the base-10 conversion of the
 /// string.\n
+/// * Numbers outside the range of integers are clamped to the smallest
+/// or the largest integer.\n
 /// * For *boolean* inputs, the result is 1 if `true`, 0 if `false`.\n
 /// * For all other inputs, the result is 0.
 /// @name int::into
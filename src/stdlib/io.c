@@ -5,7 +5,15 @@
 // See LICENSE.txt for license information
 
 #include <stdio.h>
+#include <sys/stat.h>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "core/rt/au_array.h"
 #include "core/rt/extern_fn.h"
 #include "core/rt/malloc.h"
 #include "core/rt/struct/coerce.h"
@@ -18,6 +26,9 @@ AU_EXTERN_FUNC_DECL(au_std_io_input) {
     int ch = -1;
     struct au_string_builder builder;
     au_string_builder_init(&builder);
+    // stdout is fully buffered when it isn't a terminal, so prompts are
+    // written out before waiting for input
+    fflush(stdout);
     while ((ch = fgetc(stdin)) != EOF) {
         if (ch == '\n')
             break;
@@ -50,14 +61,18 @@ static size_t _test_fwrite(const void *ptr, size_t size, size_t count,
 
 static AU_THREAD_LOCAL int nread = 0;
 #define TEST_NREAD_MAX 10
-static int _test_fgetc(FILE *stream) {
+static size_t _test_fread(void *ptr, size_t size, size_t count,
+                          FILE *stream) {
+    char *bytes = (char *)ptr;
+    const size_t num_bytes = size * count;
     (void)stream;
-    fprintf(stderr, "getc\n");
-    if (nread < TEST_NREAD_MAX) {
+    fprintf(stderr, "fread\n");
+    size_t i = 0;
+    for (; i < num_bytes && nread < TEST_NREAD_MAX; i++) {
+        bytes[i] = 'a';
         nread++;
-        return 'a';
     }
-    return EOF;
+    return i / size;
 }
 
 static int _test_fflush(FILE *stream) {
@@ -68,7 +83,6 @@ static int _test_fflush(FILE *stream) {
 
 #define fopen _test_fopen
 #define fclose _test_fclose
-#define fgetc _test_fgetc
 #define fread _test_fread
 #define fwrite _test_fwrite
 #define fflush _test_fflush
@@ -80,6 +94,12 @@ struct au_std_io {
     struct au_struct header;
     FILE *f;
     int can_close;
+    /// Read buffer used by io::read_line, or NULL. Bytes from buf_pos to
+    ///     buf_len have been read from the file but not returned yet.
+    char *buf;
+    size_t buf_pos;
+    size_t buf_len;
+    size_t buf_cap;
 };
 
 static void io_close(struct au_std_io *io) {
@@ -89,10 +109,17 @@ static void io_close(struct au_std_io *io) {
         }
         io->f = NULL;
     }
+    if (io->buf != NULL) {
+        au_data_free(io->buf);
+        io->buf = NULL;
+    }
+    io->buf_pos = 0;
+    io->buf_len = 0;
+    io->buf_cap = 0;
 }
 
-static AU_THREAD_LOCAL struct au_struct_vdata io_vdata;
-static AU_THREAD_LOCAL int io_vdata_inited = 0;
+static struct au_struct_vdata io_vdata;
+static int io_vdata_inited = 0;
 static void io_vdata_init() {
     if (!io_vdata_inited) {
         io_vdata = (struct au_struct_vdata){
@@ -105,42 +132,38 @@ static void io_vdata_init() {
     }
 }
 
-#define MAX_SMALL_PATH 256
-
-AU_EXTERN_FUNC_DECL(au_std_io_stdout) {
+static struct au_std_io *io_new(FILE *f, int can_close) {
     struct au_std_io *io =
         au_obj_malloc(sizeof(struct au_std_io), (au_obj_del_fn_t)io_close);
     io_vdata_init();
-    io->header = (struct au_struct){
-        .vdata = &io_vdata,
+    *io = (struct au_std_io){
+        .header =
+            (struct au_struct){
+                .vdata = &io_vdata,
+            },
+        .f = f,
+        .can_close = can_close,
+        .buf = NULL,
+        .buf_pos = 0,
+        .buf_len = 0,
+        .buf_cap = 0,
     };
-    io->f = stdout;
-    io->can_close = 0;
-    return au_value_struct((struct au_struct *)io);
+    return io;
+}
+
+#define MAX_SMALL_PATH 256
+#define WRITE_BUFFER_SIZE 65536
+
+AU_EXTERN_FUNC_DECL(au_std_io_stdout) {
+    return au_value_struct((struct au_struct *)io_new(stdout, 0));
 }
 
 AU_EXTERN_FUNC_DECL(au_std_io_stdin) {
-    struct au_std_io *io =
-        au_obj_malloc(sizeof(struct au_std_io), (au_obj_del_fn_t)io_close);
-    io_vdata_init();
-    io->header = (struct au_struct){
-        .vdata = &io_vdata,
-    };
-    io->f = stdin;
-    io->can_close = 0;
-    return au_value_struct((struct au_struct *)io);
+    return au_value_struct((struct au_struct *)io_new(stdin, 0));
 }
 
 AU_EXTERN_FUNC_DECL(au_std_io_stderr) {
-    struct au_std_io *io =
-        au_obj_malloc(sizeof(struct au_std_io), (au_obj_del_fn_t)io_close);
-    io_vdata_init();
-    io->header = (struct au_struct){
-        .vdata = &io_vdata,
-    };
-    io->f = stderr;
-    io->can_close = 0;
-    return au_value_struct((struct au_struct *)io);
+    return au_value_struct((struct au_struct *)io_new(stderr, 0));
 }
 
 AU_EXTERN_FUNC_DECL(au_std_io_open) {
@@ -189,16 +212,15 @@ AU_EXTERN_FUNC_DECL(au_std_io_open) {
 
     if (f == 0)
         goto fail;
+#ifndef AU_TEST
+    // Writes go through a larger buffer than stdio's default, so that
+    // writing many short strings takes few system calls
+    if (mode[0] != 'r')
+        setvbuf(f, 0, _IOFBF, WRITE_BUFFER_SIZE);
+#endif
 
-    io =
-        au_obj_malloc(sizeof(struct au_std_io), (au_obj_del_fn_t)io_close);
-    io_vdata_init();
-    io->header = (struct au_struct){
-        .vdata = &io_vdata,
-    };
-    io->f = f;
+    io = io_new(f, 1);
     f = 0;
-    io->can_close = 1;
 
     au_value_deref(path_value);
     au_value_deref(mode_value);
@@ -226,6 +248,206 @@ AU_EXTERN_FUNC_DECL(au_std_io_close) {
     return au_value_none();
 }
 
+#define READ_CHUNK_SIZE 65536
+
+/// Returns the number of bytes between the current position and the end
+///     of a regular file, or -1 if it can't be determined
+static int64_t io_remaining_size(FILE *f) {
+#ifdef AU_TEST
+    (void)f;
+    return -1;
+#else
+#ifdef _WIN32
+    const int fd = _fileno(f);
+#else
+    const int fd = fileno(f);
+#endif
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+        return -1;
+    const long pos = ftell(f);
+    if (pos < 0)
+        return -1;
+    if ((int64_t)st.st_size < (int64_t)pos)
+        return 0;
+    return (int64_t)st.st_size - (int64_t)pos;
+#endif
+}
+
+/// Reads from a file in chunks until EOF or until max_len bytes are
+///     read, and copies the bytes into a new string
+/// @param buf buffer allocated with au_data_malloc, whose first len bytes
+///     have already been read. The buffer is freed by this function.
+static struct au_string *io_read_chunks(FILE *f, char *buf, size_t len,
+                                        size_t cap, size_t max_len) {
+    while (len < max_len) {
+        if (len == cap) {
+            cap *= 2;
+            buf = au_data_realloc(buf, cap);
+        }
+        size_t want = cap - len;
+        if (want > max_len - len)
+            want = max_len - len;
+        const size_t got = fread(&buf[len], 1, want, f);
+        len += got;
+        if (got < want)
+            break;
+    }
+    struct au_string *str =
+        au_obj_malloc(sizeof(struct au_string) + len, 0);
+    str->len = len;
+    memcpy(str->data, buf, len);
+    au_data_free(buf);
+    return str;
+}
+
+/// Reads up to max_len bytes from a file into a new string
+static struct au_string *io_read_string(FILE *f, size_t max_len) {
+    if (max_len > UINT32_MAX)
+        max_len = UINT32_MAX;
+
+    const int64_t remaining = io_remaining_size(f);
+    if (remaining >= 0) {
+        // The string is allocated with the size of the rest of the file
+        // and filled by a single fread. If the whole file is to be read,
+        // an extra byte is requested to find out if the file has grown
+        // since its size was checked.
+        const size_t size =
+            (uint64_t)remaining < max_len ? (size_t)remaining : max_len;
+        const size_t want = size < max_len ? size + 1 : size;
+        struct au_string *str =
+            au_obj_malloc(sizeof(struct au_string) + want, 0);
+        const size_t got = fread(str->data, 1, want, f);
+        if (got < want || got == max_len) {
+            str->len = got;
+            return str;
+        }
+        char *buf = au_data_malloc(got * 2);
+        memcpy(buf, str->data, got);
+        au_obj_free(str);
+        return io_read_chunks(f, buf, got, got * 2, max_len);
+    }
+
+    const size_t cap = max_len < READ_CHUNK_SIZE && max_len > 0
+                           ? max_len
+                           : READ_CHUNK_SIZE;
+    return io_read_chunks(f, au_data_malloc(cap), 0, cap, max_len);
+}
+
+/// Reads up to max_len bytes from a file object into a new string,
+///     starting with the bytes left in its read buffer
+static struct au_string *io_read_buffered(struct au_std_io *io,
+                                          size_t max_len) {
+    const size_t pending = io->buf_len - io->buf_pos;
+    if (pending == 0)
+        return io_read_string(io->f, max_len);
+
+    if (max_len > UINT32_MAX)
+        max_len = UINT32_MAX;
+    if (pending >= max_len) {
+        struct au_string *str =
+            au_obj_malloc(sizeof(struct au_string) + max_len, 0);
+        str->len = max_len;
+        memcpy(str->data, &io->buf[io->buf_pos], max_len);
+        io->buf_pos += max_len;
+        return str;
+    }
+
+    const size_t cap = pending + READ_CHUNK_SIZE;
+    char *buf = au_data_malloc(cap);
+    memcpy(buf, &io->buf[io->buf_pos], pending);
+    io->buf_pos = 0;
+    io->buf_len = 0;
+    return io_read_chunks(io->f, buf, pending, cap, max_len);
+}
+
+/// Checks if a file is a terminal, which is read from one line at a time
+///     so that io::read_line doesn't wait for more input than needed
+static int io_is_interactive(FILE *f) {
+#ifdef AU_TEST
+    (void)f;
+    return 0;
+#elif defined(_WIN32)
+    return _isatty(_fileno(f));
+#else
+    return isatty(fileno(f));
+#endif
+}
+
+/// Moves the unread bytes of the read buffer to its start and reads more
+///     bytes from the file after them
+/// @return the number of bytes read
+static size_t io_fill_buffer(struct au_std_io *io) {
+    if (io->buf_pos > 0) {
+        memmove(io->buf, &io->buf[io->buf_pos],
+                io->buf_len - io->buf_pos);
+        io->buf_len -= io->buf_pos;
+        io->buf_pos = 0;
+    }
+    if (io->buf_len == io->buf_cap) {
+        io->buf_cap = io->buf_cap == 0 ? READ_CHUNK_SIZE : io->buf_cap * 2;
+        io->buf = au_data_realloc(io->buf, io->buf_cap);
+    }
+
+    if (io->f == stdin)
+        fflush(stdout);
+    if (io_is_interactive(io->f)) {
+        size_t got = 0;
+        int ch;
+        while (io->buf_len + got < io->buf_cap &&
+               (ch = fgetc(io->f)) != EOF) {
+            io->buf[io->buf_len + got] = (char)ch;
+            got++;
+            if (ch == '\n')
+                break;
+        }
+        io->buf_len += got;
+        return got;
+    }
+
+    const size_t got =
+        fread(&io->buf[io->buf_len], 1, io->buf_cap - io->buf_len, io->f);
+    io->buf_len += got;
+    return got;
+}
+
+/// Reads a line from a file object, without its newline character
+/// @return the line, or NULL if the end of the file has been reached
+static struct au_string *io_read_line(struct au_std_io *io) {
+    // Number of bytes after buf_pos that are known not to contain a
+    // newline character
+    size_t scanned = 0;
+    while (1) {
+        const char *start = &io->buf[io->buf_pos];
+        const size_t avail = io->buf_len - io->buf_pos;
+        const char *newline = NULL;
+        if (avail > scanned)
+            newline = memchr(&start[scanned], '\n', avail - scanned);
+        size_t line_len, consumed;
+        if (newline != NULL) {
+            line_len = newline - start;
+            consumed = line_len + 1;
+        } else if (avail >= UINT32_MAX) {
+            line_len = UINT32_MAX;
+            consumed = line_len;
+        } else {
+            scanned = avail;
+            if (io_fill_buffer(io) != 0)
+                continue;
+            if (avail == 0)
+                return NULL;
+            line_len = avail;
+            consumed = avail;
+        }
+        struct au_string *str =
+            au_obj_malloc(sizeof(struct au_string) + line_len, 0);
+        str->len = line_len;
+        memcpy(str->data, &io->buf[io->buf_pos], line_len);
+        io->buf_pos += consumed;
+        return str;
+    }
+}
+
 AU_EXTERN_FUNC_DECL(au_std_io_read) {
     const au_value_t io_valueue = _args[0];
     struct au_struct *io_struct = au_struct_coerce(io_valueue);
@@ -233,14 +455,9 @@ AU_EXTERN_FUNC_DECL(au_std_io_read) {
         goto fail;
     struct au_std_io *io = (struct au_std_io *)io_struct;
 
-    int ch = -1;
-    struct au_string_builder builder;
-    au_string_builder_init(&builder);
-    while ((ch = fgetc(io->f)) != EOF) {
-        au_string_builder_add(&builder, ch);
-    }
+    struct au_string *str = io_read_buffered(io, SIZE_MAX);
     au_value_deref(io_valueue);
-    return au_value_string(au_string_builder_into_string(&builder));
+    return au_value_string(str);
 
 fail:
     au_value_deref(io_valueue);
@@ -260,18 +477,12 @@ AU_EXTERN_FUNC_DECL(au_std_io_read_up_to) {
     n_value = _args[1];
     if (au_value_get_type(n_value) != AU_VALUE_INT)
         goto fail;
-    const int32_t n = au_value_get_int(n_value);
+    const int64_t n = au_value_get_int(n_value);
 
-    struct au_string_builder builder;
-    au_string_builder_init(&builder);
-    for (int i = 0; i < n; i++) {
-        int ch = fgetc(io->f);
-        if (ch == EOF)
-            break;
-        au_string_builder_add(&builder, ch);
-    }
+    struct au_string *str =
+        io_read_buffered(io, n > 0 ? (size_t)n : 0);
     au_value_deref(io_value);
-    return au_value_string(au_string_builder_into_string(&builder));
+    return au_value_string(str);
 
 fail:
     au_value_deref(io_value);
@@ -279,6 +490,47 @@ fail:
     return au_value_error();
 }
 
+AU_EXTERN_FUNC_DECL(au_std_io_read_line) {
+    const au_value_t io_value = _args[0];
+    struct au_struct *io_struct = au_struct_coerce(io_value);
+    if (io_struct == NULL || io_struct->vdata != &io_vdata)
+        goto fail;
+    struct au_std_io *io = (struct au_std_io *)io_struct;
+    if (io->f == NULL)
+        goto fail;
+
+    struct au_string *str = io_read_line(io);
+    au_value_deref(io_value);
+    if (str == NULL)
+        return au_value_none();
+    return au_value_string(str);
+
+fail:
+    au_value_deref(io_value);
+    return au_value_error();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_io_lines) {
+    const au_value_t io_value = _args[0];
+    struct au_struct *io_struct = au_struct_coerce(io_value);
+    if (io_struct == NULL || io_struct->vdata != &io_vdata)
+        goto fail;
+    struct au_std_io *io = (struct au_std_io *)io_struct;
+    if (io->f == NULL)
+        goto fail;
+
+    struct au_obj_array *array = au_obj_array_new(1);
+    struct au_string *str;
+    while ((str = io_read_line(io)) != NULL)
+        au_obj_array_push(array, au_value_string(str));
+    au_value_deref(io_value);
+    return au_value_struct((struct au_struct *)array);
+
+fail:
+    au_value_deref(io_value);
+    return au_value_error();
+}
+
 AU_EXTERN_FUNC_DECL(au_std_io_write) {
     au_value_t io_value = au_value_none();
     au_value_t out_value = au_value_none();
@@ -65,3 +65,18 @@ AU_EXTERN_FUNC_DECL(au_std_io_read_up_to);
 /// @param string string to read to file
 /// @return string bytes written
 AU_EXTERN_FUNC_DECL(au_std_io_write);
+
+/// [func-au] Reads a line from a file. Lines are read through a buffer
+/// kept by the file object, so files of any size can be processed one
+/// line at a time.
+/// @name io::read_line
+/// @param file file object to read from
+/// @return the line without its newline character, or nil if the end
+///     of the file has been reached
+AU_EXTERN_FUNC_DECL(au_std_io_read_line);
+
+/// [func-au] Reads the remaining lines of a file
+/// @name io::lines
+/// @param file file object to read from
+/// @return array of lines without their newline characters
+AU_EXTERN_FUNC_DECL(au_std_io_lines);
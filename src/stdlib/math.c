@@ -4,8 +4,12 @@
 // Licensed under Apache License v2.0 with Runtime Library Exception
 // See LICENSE.txt for license information
 
-#include "core/rt/extern_fn.h"
 #include <math.h>
+#include <string.h>
+
+#include "core/rt/au_array.h"
+#include "core/rt/extern_fn.h"
+#include "core/rt/malloc.h"
 
 #ifdef AU_FEAT_MATH_LIB
 
@@ -15,7 +19,7 @@ AU_EXTERN_FUNC_DECL(au_std_math_abs) {
     case AU_VALUE_DOUBLE:
         return au_value_double(fabs(au_value_get_double(value)));
     case AU_VALUE_INT:
-        return au_value_int(abs(au_value_get_int(value)));
+        return au_value_int(llabs(au_value_get_int(value)));
     default: {
         return value;
     }
@@ -81,7 +85,7 @@ MIN_MAX_FUNC(au_std_math_min, <)
 #define TWO_ARG_DOUBLE_FUNC(NAME, LIBC_FUNC)                              \
     AU_EXTERN_FUNC_DECL(NAME) {                                           \
         const au_value_t v1 = _args[0];                                   \
-        const au_value_t v2 = _args[0];                                   \
+        const au_value_t v2 = _args[1];                                   \
         double d1 = 0, d2 = 0;                                            \
         switch (au_value_get_type(v1)) {                                  \
         case AU_VALUE_INT:                                                \
@@ -182,4 +186,360 @@ CLASSIFY_FUNC(au_std_math_is_infinite, isinf)
 CLASSIFY_FUNC(au_std_math_is_nan, isnan)
 CLASSIFY_FUNC(au_std_math_is_normal, isnormal)
 
+// ** Array kernels **
+
+// Arrays of floats are processed 4 lanes at a time using the compiler's
+// vector extensions, which lower to SSE/AVX or NEON instructions.
+#ifdef __GNUC__
+#define VECTOR_KERNELS
+typedef double vec4d __attribute__((vector_size(4 * sizeof(double))));
+#define VEC_LOAD(DEST, SRC) memcpy(&(DEST), (SRC), sizeof(vec4d))
+#define VEC_STORE(DEST, SRC) memcpy((DEST), &(SRC), sizeof(vec4d))
+#endif
+
+/// The types of the elements of an array
+enum array_kind {
+    ARRAY_INT,
+    ARRAY_DOUBLE,
+    ARRAY_NUMBER,
+    ARRAY_OTHER,
+};
+
+static enum array_kind array_kind(const struct au_value_array *array) {
+    int has_int = 0, has_double = 0;
+    for (size_t i = 0; i < array->len; i++) {
+        switch (au_value_get_type(array->data[i])) {
+        case AU_VALUE_INT:
+            has_int = 1;
+            break;
+        case AU_VALUE_DOUBLE:
+            has_double = 1;
+            break;
+        default:
+            return ARRAY_OTHER;
+        }
+    }
+    if (has_double)
+        return has_int ? ARRAY_NUMBER : ARRAY_DOUBLE;
+    return ARRAY_INT;
+}
+
+/// Gets the elements of a numeric array as floats. With NaN tagging, the
+/// elements of an array of floats are already stored as doubles and are
+/// read in place. Otherwise, they are converted into *buf, which must be
+/// freed with au_data_free.
+static const double *array_doubles(const struct au_value_array *array,
+                                   enum array_kind kind, double **buf) {
+    *buf = 0;
+#ifdef AU_USE_NAN_TAGGING
+    if (kind == ARRAY_DOUBLE)
+        return (const double *)array->data;
+#else
+    (void)kind;
+#endif
+    *buf = au_data_malloc(sizeof(double) * (array->len + 1));
+    for (size_t i = 0; i < array->len; i++) {
+        const au_value_t value = array->data[i];
+        if (au_value_get_type(value) == AU_VALUE_INT)
+            (*buf)[i] = (double)au_value_get_int(value);
+        else
+            (*buf)[i] = au_value_get_double(value);
+    }
+    return *buf;
+}
+
+/// Creates an array of len floats, and returns the buffer that its
+/// elements are written into. The elements are boxed by
+/// array_box_doubles once they're written.
+static struct au_obj_array *array_new_doubles(size_t len, double **out) {
+    struct au_obj_array *array = au_obj_array_new(len);
+    array->array.len = len;
+#ifdef AU_USE_NAN_TAGGING
+    *out = (double *)array->array.data;
+#else
+    *out = au_data_malloc(sizeof(double) * (len + 1));
+#endif
+    return array;
+}
+
+static au_value_t array_box_doubles(struct au_obj_array *array,
+                                    double *out) {
+    // au_value_double canonicalizes NaNs so that they aren't mistaken
+    // for boxed values
+    for (size_t i = 0; i < array->array.len; i++)
+        array->array.data[i] = au_value_double(out[i]);
+#ifndef AU_USE_NAN_TAGGING
+    au_data_free(out);
+#endif
+    return au_value_struct((struct au_struct *)array);
+}
+
+static double kernel_sum(const double *a, size_t len) {
+    size_t i = 0;
+    double sum = 0.0;
+#ifdef VECTOR_KERNELS
+    vec4d acc = {0.0, 0.0, 0.0, 0.0};
+    for (; i + 4 <= len; i += 4) {
+        vec4d va;
+        VEC_LOAD(va, &a[i]);
+        acc += va;
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < len; i++)
+        sum += a[i];
+    return sum;
+}
+
+static double kernel_dot(const double *a, const double *b, size_t len) {
+    size_t i = 0;
+    double sum = 0.0;
+#ifdef VECTOR_KERNELS
+    vec4d acc = {0.0, 0.0, 0.0, 0.0};
+    for (; i + 4 <= len; i += 4) {
+        vec4d va, vb;
+        VEC_LOAD(va, &a[i]);
+        VEC_LOAD(vb, &b[i]);
+        acc += va * vb;
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < len; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static void kernel_sqrt(double *out, const double *a, size_t len) {
+    // The loop is simple enough for the compiler to vectorize by itself
+    for (size_t i = 0; i < len; i++)
+        out[i] = sqrt(a[i]);
+}
+
+#define ELEMENTWISE_KERNEL(NAME, OP)                                      \
+    static void NAME(double *out, const double *a, const double *b,       \
+                     size_t len) {                                        \
+        size_t i = 0;                                                     \
+        VECTOR_LOOP(OP)                                                   \
+        for (; i < len; i++)                                              \
+            out[i] = a[i] OP b[i];                                        \
+    }
+#ifdef VECTOR_KERNELS
+#define VECTOR_LOOP(OP)                                                   \
+    for (; i + 4 <= len; i += 4) {                                        \
+        vec4d va, vb;                                                     \
+        VEC_LOAD(va, &a[i]);                                              \
+        VEC_LOAD(vb, &b[i]);                                              \
+        const vec4d vr = va OP vb;                                        \
+        VEC_STORE(&out[i], vr);                                           \
+    }
+#else
+#define VECTOR_LOOP(OP)
+#endif
+ELEMENTWISE_KERNEL(kernel_add, +)
+ELEMENTWISE_KERNEL(kernel_mul, *)
+#undef VECTOR_LOOP
+#undef ELEMENTWISE_KERNEL
+
+AU_EXTERN_FUNC_DECL(au_std_math_sum) {
+    const au_value_t array_value = _args[0];
+    const struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    const enum array_kind kind = array_kind(&array->array);
+    au_value_t retval;
+    switch (kind) {
+    case ARRAY_INT: {
+        int64_t sum = 0;
+        for (size_t i = 0; i < array->array.len; i++) {
+            if (au_platform_iadd_overflow(
+                    sum, au_value_get_int(array->array.data[i]), &sum))
+                goto fail;
+        }
+        retval = au_value_int(sum);
+        break;
+    }
+    case ARRAY_DOUBLE:
+    case ARRAY_NUMBER: {
+        double *buf;
+        const double *a = array_doubles(&array->array, kind, &buf);
+        retval = au_value_double(kernel_sum(a, array->array.len));
+        au_data_free(buf);
+        break;
+    }
+    default:
+        goto fail;
+    }
+    au_value_deref(array_value);
+    return retval;
+fail:
+    au_value_deref(array_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_math_dot) {
+    const au_value_t left_value = _args[0];
+    const au_value_t right_value = _args[1];
+    const struct au_obj_array *left = au_obj_array_coerce(left_value);
+    const struct au_obj_array *right = au_obj_array_coerce(right_value);
+    if (left == 0 || right == 0 || left->array.len != right->array.len)
+        goto fail;
+    const enum array_kind left_kind = array_kind(&left->array);
+    const enum array_kind right_kind = array_kind(&right->array);
+    if (left_kind == ARRAY_OTHER || right_kind == ARRAY_OTHER)
+        goto fail;
+    au_value_t retval;
+    if (left_kind == ARRAY_INT && right_kind == ARRAY_INT) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < left->array.len; i++) {
+            int64_t product;
+            if (au_platform_imul_overflow(
+                    au_value_get_int(left->array.data[i]),
+                    au_value_get_int(right->array.data[i]), &product) ||
+                au_platform_iadd_overflow(sum, product, &sum))
+                goto fail;
+        }
+        retval = au_value_int(sum);
+    } else {
+        double *left_buf, *right_buf;
+        const double *a =
+            array_doubles(&left->array, left_kind, &left_buf);
+        const double *b =
+            array_doubles(&right->array, right_kind, &right_buf);
+        retval = au_value_double(kernel_dot(a, b, left->array.len));
+        au_data_free(left_buf);
+        au_data_free(right_buf);
+    }
+    au_value_deref(left_value);
+    au_value_deref(right_value);
+    return retval;
+fail:
+    au_value_deref(left_value);
+    au_value_deref(right_value);
+    return au_value_none();
+}
+
+#define REDUCE_FUNC(NAME, COMPARISON)                                     \
+    AU_EXTERN_FUNC_DECL(NAME) {                                           \
+        const au_value_t array_value = _args[0];                          \
+        const struct au_obj_array *array =                                \
+            au_obj_array_coerce(array_value);                             \
+        if (array == 0 || array->array.len == 0)                          \
+            goto fail;                                                    \
+        const enum array_kind kind = array_kind(&array->array);           \
+        au_value_t retval;                                                \
+        if (kind == ARRAY_INT) {                                          \
+            int64_t result = au_value_get_int(array->array.data[0]);      \
+            for (size_t i = 1; i < array->array.len; i++) {               \
+                const int64_t n = au_value_get_int(array->array.data[i]); \
+                result = n COMPARISON result ? n : result;                \
+            }                                                             \
+            retval = au_value_int(result);                                \
+        } else if (kind != ARRAY_OTHER) {                                 \
+            double *buf;                                                  \
+            const double *a = array_doubles(&array->array, kind, &buf);   \
+            /* Independent lanes let the compiler vectorize the loop */   \
+            double lanes[4] = {a[0], a[0], a[0], a[0]};                   \
+            size_t i = 0;                                                 \
+            for (; i + 4 <= array->array.len; i += 4) {                   \
+                for (int j = 0; j < 4; j++)                               \
+                    lanes[j] = a[i + j] COMPARISON lanes[j] ? a[i + j]    \
+                                                            : lanes[j];   \
+            }                                                             \
+            for (; i < array->array.len; i++)                             \
+                lanes[0] = a[i] COMPARISON lanes[0] ? a[i] : lanes[0];    \
+            for (int j = 1; j < 4; j++)                                   \
+                lanes[0] =                                                \
+                    lanes[j] COMPARISON lanes[0] ? lanes[j] : lanes[0];   \
+            retval = au_value_double(lanes[0]);                           \
+            au_data_free(buf);                                            \
+        } else {                                                          \
+            goto fail;                                                    \
+        }                                                                 \
+        au_value_deref(array_value);                                      \
+        return retval;                                                    \
+    fail:                                                                 \
+        au_value_deref(array_value);                                      \
+        return au_value_none();                                           \
+    }
+REDUCE_FUNC(au_std_math_max_of, >)
+REDUCE_FUNC(au_std_math_min_of, <)
+#undef REDUCE_FUNC
+
+AU_EXTERN_FUNC_DECL(au_std_math_map_sqrt) {
+    const au_value_t array_value = _args[0];
+    const struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0)
+        goto fail;
+    const enum array_kind kind = array_kind(&array->array);
+    if (kind == ARRAY_OTHER)
+        goto fail;
+    double *buf, *out;
+    const double *a = array_doubles(&array->array, kind, &buf);
+    struct au_obj_array *result =
+        array_new_doubles(array->array.len, &out);
+    kernel_sqrt(out, a, array->array.len);
+    au_data_free(buf);
+    au_value_deref(array_value);
+    return array_box_doubles(result, out);
+fail:
+    au_value_deref(array_value);
+    return au_value_none();
+}
+
+#define ELEMENTWISE_FUNC(NAME, INT_FN, KERNEL)                            \
+    AU_EXTERN_FUNC_DECL(NAME) {                                           \
+        const au_value_t left_value = _args[0];                           \
+        const au_value_t right_value = _args[1];                          \
+        const struct au_obj_array *left =                                 \
+            au_obj_array_coerce(left_value);                              \
+        const struct au_obj_array *right =                                \
+            au_obj_array_coerce(right_value);                             \
+        if (left == 0 || right == 0 ||                                    \
+            left->array.len != right->array.len)                          \
+            goto fail;                                                    \
+        const size_t len = left->array.len;                               \
+        const enum array_kind left_kind = array_kind(&left->array);       \
+        const enum array_kind right_kind = array_kind(&right->array);     \
+        if (left_kind == ARRAY_OTHER || right_kind == ARRAY_OTHER)        \
+            goto fail;                                                    \
+        au_value_t retval;                                                \
+        if (left_kind == ARRAY_INT && right_kind == ARRAY_INT) {          \
+            struct au_obj_array *result = au_obj_array_new(len);          \
+            for (size_t i = 0; i < len; i++) {                            \
+                int64_t n;                                                \
+                if (INT_FN(au_value_get_int(left->array.data[i]),         \
+                           au_value_get_int(right->array.data[i]), &n)) { \
+                    au_obj_deref(result);                                 \
+                    goto fail;                                            \
+                }                                                         \
+                result->array.data[i] = au_value_int(n);                  \
+            }                                                             \
+            result->array.len = len;                                      \
+            retval = au_value_struct((struct au_struct *)result);         \
+        } else {                                                          \
+            double *left_buf, *right_buf, *out;                           \
+            const double *a =                                             \
+                array_doubles(&left->array, left_kind, &left_buf);        \
+            const double *b =                                             \
+                array_doubles(&right->array, right_kind, &right_buf);     \
+            struct au_obj_array *result = array_new_doubles(len, &out);   \
+            KERNEL(out, a, b, len);                                       \
+            au_data_free(left_buf);                                       \
+            au_data_free(right_buf);                                      \
+            retval = array_box_doubles(result, out);                      \
+        }                                                                 \
+        au_value_deref(left_value);                                       \
+        au_value_deref(right_value);                                      \
+        return retval;                                                    \
+    fail:                                                                 \
+        au_value_deref(left_value);                                       \
+        au_value_deref(right_value);                                      \
+        return au_value_none();                                           \
+    }
+ELEMENTWISE_FUNC(au_std_math_elementwise_add, au_platform_iadd_overflow,
+                 kernel_add)
+ELEMENTWISE_FUNC(au_std_math_elementwise_mul, au_platform_imul_overflow,
+                 kernel_mul)
+#undef ELEMENTWISE_FUNC
+
 #endif
\ No newline at end of file
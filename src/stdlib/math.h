@@ -166,3 +166,60 @@ AU_EXTERN_FUNC_DECL(au_std_math_is_nan);
 /// [func-au]
 /// @name math::is_normal
 AU_EXTERN_FUNC_DECL(au_std_math_is_normal);
+
+// ** Array kernels **
+
+/// [func-au] Returns the sum of the elements of an array
+/// @name math::sum
+/// @param array an array of numbers (integers/floats)
+/// @return an integer if every element is an integer, a float otherwise.
+///     Returns nil if an element isn't a number or the integer sum
+///     overflows.
+AU_EXTERN_FUNC_DECL(au_std_math_sum);
+
+/// [func-au] Returns the dot product of 2 arrays
+/// @name math::dot
+/// @param a an array of numbers (integers/floats)
+/// @param b an array of numbers with the same length as `a`
+/// @return an integer if every element is an integer, a float otherwise.
+///     Returns nil if the lengths differ, an element isn't a number or
+///     the integer result overflows.
+AU_EXTERN_FUNC_DECL(au_std_math_dot);
+
+/// [func-au] Returns the largest element of an array
+/// @name math::max_of
+/// @param array a non-empty array of numbers (integers/floats)
+/// @return an integer if every element is an integer, a float otherwise.
+///     Returns nil if the array is empty or an element isn't a number.
+AU_EXTERN_FUNC_DECL(au_std_math_max_of);
+
+/// [func-au] Returns the smallest element of an array
+/// @name math::min_of
+/// @param array a non-empty array of numbers (integers/floats)
+/// @return an integer if every element is an integer, a float otherwise.
+///     Returns nil if the array is empty or an element isn't a number.
+AU_EXTERN_FUNC_DECL(au_std_math_min_of);
+
+/// [func-au] Returns the square roots of the elements of an array
+/// @name math::map_sqrt
+/// @param array an array of numbers (integers/floats)
+/// @return a new array of floats, or nil if an element isn't a number
+AU_EXTERN_FUNC_DECL(au_std_math_map_sqrt);
+
+/// [func-au] Adds the elements of 2 arrays pairwise
+/// @name math::elementwise_add
+/// @param a an array of numbers (integers/floats)
+/// @param b an array of numbers with the same length as `a`
+/// @return a new array of integers if every element is an integer, of
+///     floats otherwise. Returns nil if the lengths differ, an element
+///     isn't a number or an integer result overflows.
+AU_EXTERN_FUNC_DECL(au_std_math_elementwise_add);
+
+/// [func-au] Multiplies the elements of 2 arrays pairwise
+/// @name math::elementwise_mul
+/// @param a an array of numbers (integers/floats)
+/// @param b an array of numbers with the same length as `a`
+/// @return a new array of integers if every element is an integer, of
+///     floats otherwise. Returns nil if the lengths differ, an element
+///     isn't a number or an integer result overflows.
+AU_EXTERN_FUNC_DECL(au_std_math_elementwise_mul);
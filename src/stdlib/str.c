@@ -12,6 +12,7 @@
 #include "core/utf8.h"
 #include "core/vm/vm.h"
 #include "lib/string_builder.h"
+#include "platform/fmt.h"
 
 // ** Implementation **
 
@@ -34,42 +35,14 @@ AU_EXTERN_FUNC_DECL(au_std_str_into) {
         return au_value_string(au_string_from_const(repr, strlen(repr)));
     }
     case AU_VALUE_INT: {
-        int32_t abs_num = au_value_get_int(value);
-        struct au_string *header =
-            au_obj_malloc(sizeof(struct au_string) + 1, 0);
-        header->len = 1;
-        uint32_t pos = 0, cap = 1;
-        int is_neg = 0;
-        if (abs_num < 0) {
-            is_neg = 1;
-            abs_num = -abs_num;
-        }
-        while (abs_num != 0) {
-            if (pos == cap) {
-                cap *= 2;
-                header =
-                    au_obj_realloc(header, sizeof(struct au_string) + cap);
-            }
-            header->data[pos] = ((abs_num % 10) + '0');
-            pos++;
-            abs_num /= 10;
-        }
-        if (is_neg) {
-            if (pos == cap) {
-                cap *= 2;
-                header =
-                    au_obj_realloc(header, sizeof(struct au_string) + cap);
-            }
-            header->data[pos] = '-';
-            pos++;
-        }
-        for (int i = 0, j = pos - 1; i < j; i++, j--) {
-            char c = header->data[i];
-            header->data[i] = header->data[j];
-            header->data[j] = c;
-        }
-        header->len = pos;
-        return au_value_string(header);
+        char buf[AU_FMT_INT_MAX_LEN];
+        const size_t len = au_fmt_int(au_value_get_int(value), buf);
+        return au_value_string(au_string_from_const(buf, len));
+    }
+    case AU_VALUE_DOUBLE: {
+        char buf[AU_FMT_DOUBLE_MAX_LEN];
+        const size_t len = au_fmt_double(au_value_get_double(value), buf);
+        return au_value_string(au_string_from_const(buf, len));
     }
     default: {
         au_value_deref(value);
@@ -86,10 +59,7 @@ AU_EXTERN_FUNC_DECL(au_std_str_char) {
 
     // FIXME: support Unicode characters
 
-    struct au_string_builder builder = {0};
-    au_string_builder_init(&builder);
-    au_string_builder_add(&builder, (char)char_point);
-    return au_value_string(au_string_builder_into_string(&builder));
+    return au_value_string(au_string_from_byte((char)char_point));
 fail:
     au_value_deref(char_value);
     return au_value_none();
@@ -140,6 +110,12 @@ AU_EXTERN_FUNC_DECL(au_std_str_code_points) {
     const char *str_max = &str->data[str->len];
 
     while ((str_next = utf8_next(str_cur, str_max, &str_cur_size)) != 0) {
+        if (str_cur_size == 1) {
+            au_obj_array_push(array, au_value_string(
+                                         au_string_from_byte(str_cur[0])));
+            str_cur = str_next;
+            continue;
+        }
         struct au_string_builder builder = {0};
         au_string_builder_init(&builder);
         for (int i = 0; i < str_cur_size; i++) {
@@ -274,6 +250,33 @@ not_found:
     return au_value_bool(0);
 }
 
+AU_EXTERN_FUNC_DECL(au_std_str_slice) {
+    const au_value_t str_value = _args[0];
+    const au_value_t start_value = _args[1];
+    const au_value_t end_value = _args[2];
+    if (au_value_get_type(str_value) != AU_VALUE_STR ||
+        au_value_get_type(start_value) != AU_VALUE_INT ||
+        au_value_get_type(end_value) != AU_VALUE_INT)
+        goto fail;
+    const struct au_string *str = au_value_get_string(str_value);
+    const int64_t start = au_value_get_int(start_value);
+    const int64_t end = au_value_get_int(end_value);
+    if (start < 0 || start > end || (size_t)end > str->len)
+        goto fail;
+    if (start == 0 && (size_t)end == str->len)
+        return str_value;
+
+    struct au_string *slice =
+        au_string_from_const(&str->data[start], (size_t)(end - start));
+    au_value_deref(str_value);
+    return au_value_string(slice);
+fail:
+    au_value_deref(str_value);
+    au_value_deref(start_value);
+    au_value_deref(end_value);
+    return au_value_none();
+}
+
 #define CHAR_TYPE_FN(NAME, COND)                                          \
     AU_EXTERN_FUNC_DECL(NAME) {                                           \
         const au_value_t str_value = _args[0];                            \
@@ -292,9 +295,249 @@ is_false:                                                                 \
         return au_value_bool(0);                                          \
     }
 
-CHAR_TYPE_FN(au_std_str_is_space,
-             (str->data[0] == ' ' || str->data[0] == '\t' ||
-              str->data[0] == '\r' || str->data[0] == '\n'))
+static int is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+CHAR_TYPE_FN(au_std_str_is_space, is_space(str->data[0]))
 
 CHAR_TYPE_FN(au_std_str_is_digit,
              ('0' <= str->data[0] && str->data[0] <= '9'))
+
+// ** Building strings **
+
+/// A string of a known length whose bytes are written by the caller.
+/// Strings of at most one byte are written into a local buffer, so that
+/// the interned strings are returned for them.
+struct sized_string {
+    struct au_string *str;
+    char *data;
+    size_t len;
+    char short_data[1];
+};
+
+static void sized_string_init(struct sized_string *sized, size_t len) {
+    sized->len = len;
+    if (len <= 1) {
+        sized->str = 0;
+        sized->data = sized->short_data;
+        return;
+    }
+    sized->str = au_obj_malloc(sizeof(struct au_string) + len, 0);
+    sized->str->len = len;
+    sized->data = sized->str->data;
+}
+
+static struct au_string *sized_string_finish(struct sized_string *sized) {
+    if (sized->str == 0)
+        return au_string_from_const(sized->short_data, sized->len);
+    return sized->str;
+}
+
+/// Finds the next occurrence of a non-empty needle in the range [pos,
+/// end of str)
+static const char *find_next(const struct au_string *str, const char *pos,
+                             const struct au_string *needle) {
+    return utf8_str(pos, &str->data[str->len], needle->data,
+                    &needle->data[needle->len]);
+}
+
+/// Counts the non-overlapping occurrences of a non-empty needle
+static size_t count_matches(const struct au_string *str,
+                            const struct au_string *needle) {
+    size_t count = 0;
+    const char *found = str->data;
+    while ((found = find_next(str, found, needle)) != 0) {
+        count++;
+        found += needle->len;
+    }
+    return count;
+}
+
+AU_EXTERN_FUNC_DECL(au_std_str_split) {
+    const au_value_t str_value = _args[0];
+    const au_value_t sep_value = _args[1];
+    if (au_value_get_type(str_value) != AU_VALUE_STR ||
+        au_value_get_type(sep_value) != AU_VALUE_STR)
+        goto fail;
+    const struct au_string *str = au_value_get_string(str_value);
+    const struct au_string *sep = au_value_get_string(sep_value);
+    if (sep->len == 0)
+        goto fail;
+
+    struct au_obj_array *array =
+        au_obj_array_new(count_matches(str, sep) + 1);
+    const char *start = str->data;
+    const char *found;
+    while ((found = find_next(str, start, sep)) != 0) {
+        au_value_t part = au_value_string(
+            au_string_from_const(start, (size_t)(found - start)));
+        au_obj_array_push(array, part);
+        au_value_deref(part);
+        start = found + sep->len;
+    }
+    au_value_t part = au_value_string(au_string_from_const(
+        start, (size_t)(&str->data[str->len] - start)));
+    au_obj_array_push(array, part);
+    au_value_deref(part);
+
+    au_value_deref(str_value);
+    au_value_deref(sep_value);
+    return au_value_struct((struct au_struct *)array);
+fail:
+    au_value_deref(str_value);
+    au_value_deref(sep_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_str_join) {
+    const au_value_t array_value = _args[0];
+    const au_value_t sep_value = _args[1];
+    struct au_obj_array *array = au_obj_array_coerce(array_value);
+    if (array == 0 || au_value_get_type(sep_value) != AU_VALUE_STR)
+        goto fail;
+    const struct au_string *sep = au_value_get_string(sep_value);
+    const size_t num_parts = array->array.len;
+
+    uint64_t len = 0;
+    for (size_t i = 0; i < num_parts; i++) {
+        if (au_value_get_type(array->array.data[i]) != AU_VALUE_STR)
+            goto fail;
+        len += au_value_get_string(array->array.data[i])->len;
+    }
+    if (num_parts > 0)
+        len += (uint64_t)sep->len * (num_parts - 1);
+    if (len > UINT32_MAX)
+        goto fail;
+
+    struct sized_string joined;
+    sized_string_init(&joined, (size_t)len);
+    char *out = joined.data;
+    for (size_t i = 0; i < num_parts; i++) {
+        if (i > 0) {
+            memcpy(out, sep->data, sep->len);
+            out += sep->len;
+        }
+        const struct au_string *part =
+            au_value_get_string(array->array.data[i]);
+        memcpy(out, part->data, part->len);
+        out += part->len;
+    }
+
+    au_value_deref(array_value);
+    au_value_deref(sep_value);
+    return au_value_string(sized_string_finish(&joined));
+fail:
+    au_value_deref(array_value);
+    au_value_deref(sep_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_str_replace) {
+    const au_value_t str_value = _args[0];
+    const au_value_t from_value = _args[1];
+    const au_value_t to_value = _args[2];
+    if (au_value_get_type(str_value) != AU_VALUE_STR ||
+        au_value_get_type(from_value) != AU_VALUE_STR ||
+        au_value_get_type(to_value) != AU_VALUE_STR)
+        goto fail;
+    const struct au_string *str = au_value_get_string(str_value);
+    const struct au_string *from = au_value_get_string(from_value);
+    const struct au_string *to = au_value_get_string(to_value);
+
+    const size_t count = from->len == 0 ? 0 : count_matches(str, from);
+    if (count == 0) {
+        au_value_deref(from_value);
+        au_value_deref(to_value);
+        return str_value;
+    }
+    const uint64_t len = (uint64_t)str->len - (uint64_t)count * from->len +
+                         (uint64_t)count * to->len;
+    if (len > UINT32_MAX)
+        goto fail;
+
+    struct sized_string replaced;
+    sized_string_init(&replaced, (size_t)len);
+    char *out = replaced.data;
+    const char *start = str->data;
+    const char *found;
+    while ((found = find_next(str, start, from)) != 0) {
+        memcpy(out, start, (size_t)(found - start));
+        out += found - start;
+        memcpy(out, to->data, to->len);
+        out += to->len;
+        start = found + from->len;
+    }
+    memcpy(out, start, (size_t)(&str->data[str->len] - start));
+
+    au_value_deref(str_value);
+    au_value_deref(from_value);
+    au_value_deref(to_value);
+    return au_value_string(sized_string_finish(&replaced));
+fail:
+    au_value_deref(str_value);
+    au_value_deref(from_value);
+    au_value_deref(to_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_str_trim) {
+    const au_value_t str_value = _args[0];
+    if (au_value_get_type(str_value) != AU_VALUE_STR)
+        goto fail;
+    const struct au_string *str = au_value_get_string(str_value);
+    size_t start = 0, end = str->len;
+    while (start < end && is_space(str->data[start]))
+        start++;
+    while (end > start && is_space(str->data[end - 1]))
+        end--;
+    if (start == 0 && end == str->len)
+        return str_value;
+
+    struct au_string *trimmed =
+        au_string_from_const(&str->data[start], end - start);
+    au_value_deref(str_value);
+    return au_value_string(trimmed);
+fail:
+    au_value_deref(str_value);
+    return au_value_none();
+}
+
+AU_EXTERN_FUNC_DECL(au_std_str_repeat) {
+    const au_value_t str_value = _args[0];
+    const au_value_t times_value = _args[1];
+    if (au_value_get_type(str_value) != AU_VALUE_STR ||
+        au_value_get_type(times_value) != AU_VALUE_INT)
+        goto fail;
+    const struct au_string *str = au_value_get_string(str_value);
+    const int64_t times = au_value_get_int(times_value);
+    if (times < 0)
+        goto fail;
+    if (times == 1) {
+        return str_value;
+    } else if (times == 0 || str->len == 0) {
+        au_value_deref(str_value);
+        return au_value_string(au_string_from_const("", 0));
+    }
+    if ((uint64_t)times > UINT32_MAX / str->len)
+        goto fail;
+
+    // The repeated bytes are doubled with each copy
+    const size_t len = str->len * (size_t)times;
+    struct sized_string repeated;
+    sized_string_init(&repeated, len);
+    memcpy(repeated.data, str->data, str->len);
+    size_t filled = str->len;
+    while (filled < len) {
+        const size_t n = filled < len - filled ? filled : len - filled;
+        memcpy(&repeated.data[filled], repeated.data, n);
+        filled += n;
+    }
+
+    au_value_deref(str_value);
+    return au_value_string(sized_string_finish(&repeated));
+fail:
+    au_value_deref(str_value);
+    au_value_deref(times_value);
+    return au_value_none();
+}
@@ -44,6 +44,14 @@ AU_EXTERN_FUNC_DECL(au_std_str_code_points);
 /// @return The array of code points inside the string
 AU_EXTERN_FUNC_DECL(au_std_str_bytes);
 
+/// [func-au] Copies a range of bytes of a string into a new string
+/// @name str::slice
+/// @param input the string
+/// @param start index of the first byte
+/// @param end index after the last byte
+/// @return The new string, or nil if the range is out of bounds
+AU_EXTERN_FUNC_DECL(au_std_str_slice);
+
 AU_EXTERN_FUNC_DECL(au_std_str_index_of);
 
 AU_EXTERN_FUNC_DECL(au_std_str_contains);
@@ -55,3 +63,42 @@ AU_EXTERN_FUNC_DECL(au_std_str_ends_with);
 AU_EXTERN_FUNC_DECL(au_std_str_is_space);
 
 AU_EXTERN_FUNC_DECL(au_std_str_is_digit);
+
+/// [func-au] Splits a string at every occurrence of a separator
+/// @name str::split
+/// @param input the string
+/// @param separator the separator
+/// @return The array of the parts of the string between separators, or
+/// nil if the separator is empty
+AU_EXTERN_FUNC_DECL(au_std_str_split);
+
+/// [func-au] Joins an array of strings, with a separator between each
+/// string
+/// @name str::join
+/// @param array the array of strings
+/// @param separator the separator
+/// @return The joined string, or nil if an element isn't a string
+AU_EXTERN_FUNC_DECL(au_std_str_join);
+
+/// [func-au] Replaces every occurrence of a substring
+/// @name str::replace
+/// @param input the string
+/// @param from the substring that is replaced
+/// @param to the replacement
+/// @return The new string. If `from` is empty or isn't found, the string
+/// is returned unchanged.
+AU_EXTERN_FUNC_DECL(au_std_str_replace);
+
+/// [func-au] Removes the spaces, tabs and line breaks at the start and
+/// the end of a string
+/// @name str::trim
+/// @param input the string
+/// @return The trimmed string
+AU_EXTERN_FUNC_DECL(au_std_str_trim);
+
+/// [func-au] Repeats a string
+/// @name str::repeat
+/// @param input the string
+/// @param times how many times the string is repeated
+/// @return The repeated string, or nil if times is negative
+AU_EXTERN_FUNC_DECL(au_std_str_repeat);
@@ -20,4 +20,32 @@ AU_EXTERN_FUNC_DECL(au_std_test_2) {
     au_value_deref(_args[0]);
     au_value_deref(_args[1]);
     return au_value_int(1);
-}
\ No newline at end of file
+}
+
+int64_t au_std_test_max_fast(int64_t lhs, int64_t rhs) {
+    return lhs > rhs ? lhs : rhs;
+}
+
+AU_EXTERN_FUNC_DECL(au_std_test_max) {
+    const au_value_t lhs = _args[0];
+    const au_value_t rhs = _args[1];
+    if (au_value_get_type(lhs) != AU_VALUE_INT ||
+        au_value_get_type(rhs) != AU_VALUE_INT) {
+        au_value_deref(lhs);
+        au_value_deref(rhs);
+        return au_value_int(-1);
+    }
+    return au_value_int(au_std_test_max_fast(au_value_get_int(lhs),
+                                             au_value_get_int(rhs)));
+}
+
+int64_t au_std_test_twice_fast(int64_t n) { return n * 2; }
+
+AU_EXTERN_FUNC_DECL(au_std_test_twice) {
+    const au_value_t value = _args[0];
+    if (au_value_get_type(value) != AU_VALUE_INT) {
+        au_value_deref(value);
+        return au_value_int(-1);
+    }
+    return au_value_int(au_std_test_twice_fast(au_value_get_int(value)));
+}
@@ -11,4 +11,8 @@
 #ifdef AU_TEST
 AU_EXTERN_FUNC_DECL(au_std_test_1);
 AU_EXTERN_FUNC_DECL(au_std_test_2);
+AU_EXTERN_FUNC_DECL(au_std_test_max);
+int64_t au_std_test_max_fast(int64_t lhs, int64_t rhs);
+AU_EXTERN_FUNC_DECL(au_std_test_twice);
+int64_t au_std_test_twice_fast(int64_t n);
 #endif
\ No newline at end of file